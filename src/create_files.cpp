@@ -1,41 +1,27 @@
+#include <algorithm>
+#include <buffer.hpp>
+#include <file_buffering.hpp>
+#include <filesystem>
+#include <format>
 #include <fstream>
+#include <generator.hpp>
 #include <iostream>
-#include <random>
+#include <page_format.hpp>
 #include <record.hpp>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "util/create_options.hpp"
 
-std::default_random_engine rng{std::random_device{}()};
-
-std::string generateRandomString(int maxLength, bool numOnly = false) {
-    std::uniform_int_distribution<int> lenDist(1, maxLength);
-    // ASCII printable characters are in rage [32,126]
-    // but whe start from 33 as (char)32 is space.
-    // NOTE: (char)33 == '!'; (char)126 == '~';
-    std::uniform_int_distribution<int> allCharDist(33, 126);
-    std::uniform_int_distribution<int> numDist('0', '9');
-
-    auto charDist = numOnly ? numDist : allCharDist;
-
-    int length = lenDist(rng);
-    std::string random_string;
-    random_string.reserve(length);
-    for (int i = 0; i < length; ++i) {
-        random_string += static_cast<char>(charDist(rng));
-    }
-    return random_string;
-}
-
-void manualMode(std::vector<std::string>& lines) {
+void manualMode(std::vector<std::string>& lines, size_t recordWidth) {
     std::string line;
     // clang-format off
     std::cout << 
         std::format(
             "Enter lines of text (up to {} characters)."
             " Type '!q' to finish.",
-            Record::maxLen
+            recordWidth
         ) << std::endl;
     // clang-format on
 
@@ -46,13 +32,13 @@ void manualMode(std::vector<std::string>& lines) {
             break;
         }
 
-        if (line.length() > Record::maxLen) {
+        if (line.length() > recordWidth) {
             // clang-format off
             std::cout << 
                 std::format(
                     "Error: String exceeds {} characters. "
                     "Please try again.",
-                    Record::maxLen
+                    recordWidth
                 ) << std::endl;
             // clang-format on
         }
@@ -61,22 +47,104 @@ void manualMode(std::vector<std::string>& lines) {
     }
 }
 
-void autoMode(
-    std::vector<std::string>& lines, size_t numStrings, bool numOnly = false
+// Writes every record passed by `produce` to its callback as pages of the
+// variable format, replacing the file
+template <size_t RecordLen, typename F>
+void writeVariableFile(
+    const std::string& fileName, size_t blockingFactor, F&& produce
 ) {
-    for (size_t i = 0; i < numStrings; ++i) {
-        lines.push_back(generateRandomString(Record::maxLen, numOnly));
+    std::filesystem::path dir = std::filesystem::path(fileName).parent_path();
+    if (!dir.empty()) {
+        std::filesystem::create_directories(dir);
     }
-    std::cout << numStrings << " random strings generated." << std::endl;
+    // The old content may not even be in the variable format
+    std::filesystem::remove(fileName);
+
+    BasicBufferedFile<RecordLen> f(
+        fileName, blockingFactor, PageFormat::VARIABLE, "output"
+    );
+    {
+        BasicBuffer<RecordLen> out(f.pages());
+        produce([&](std::string_view r) {
+            out.append(BasicRecord<RecordLen>(r));
+        });
+    }
+    f.flush();
 }
 
-void writeLine(std::ofstream& file, const std::string& data) {
+void writeGeneratedVariableFile(
+    const CreateOptions& options, const RecordGenerator& generator
+) {
+    const size_t width = generator.getRecordWidth();
+    const size_t recordCount = generator.getConfig().recordCount;
+
+    dispatchRecordWidth(width, [&]<size_t RecordLen>() {
+        writeVariableFile<RecordLen>(
+            options.getFileName(),
+            options.getBlockingFactor(),
+            [&](auto&& append) {
+                std::vector<char> block(generator.getBlockBytes());
+                for (size_t first = 0, blockIndex = 0; first < recordCount;
+                     first += RecordGenerator::blockRecords, blockIndex++) {
+                    size_t count = std::min(
+                        RecordGenerator::blockRecords, recordCount - first
+                    );
+                    generator.fillBlock(blockIndex, count, block.data());
+                    for (size_t i = 0; i < count; i++) {
+                        append(std::string_view(block.data() + i * width, width)
+                        );
+                    }
+                }
+            }
+        );
+    });
+}
+
+void autoMode(const CreateOptions& options) {
+    GeneratorConfig config{
+        .recordWidth = options.getRecordWidth(),
+        .recordCount = options.getRandomCount(),
+        .numbersOnly = options.isNumbersOnly(),
+        .seed = options.getSeed().value_or(randomSeed()),
+        .distribution = options.getDistribution(),
+        .perturbPercent = options.getPerturbPercent(),
+        .distinctCount = options.getDistinctCount(),
+        .zipfSkew = options.getZipfSkew(),
+    };
+    RecordGenerator generator(config);
+
+    if (options.getPageFormat() == PageFormat::VARIABLE) {
+        // NOTE: Pages are packed one after the other, so a single thread
+        // writes them
+        writeGeneratedVariableFile(options, generator);
+    } else {
+        writeGeneratedFile(
+            options.getFileName(), generator, options.getThreadCount()
+        );
+    }
+
+    std::cout << std::format(
+                     "{} {} strings generated (seed: {}).",
+                     config.recordCount,
+                     distributionName(config.distribution),
+                     config.seed
+                 )
+              << std::endl;
+    std::cout << "Data saved to " << options.getFileName() << std::endl;
+}
+
+void writeLine(
+    std::ofstream& file, const std::string& data, size_t recordWidth
+) {
     std::string tempStr = data;
-    tempStr.resize(Record::maxLen, '\0');
-    file.write(tempStr.data(), Record::maxLen);
+    tempStr.resize(recordWidth, '\0');
+    file.write(tempStr.data(), recordWidth);
 }
 
-void saveFile(std::vector<std::string>& lines, const std::string& filename) {
+void saveFile(
+    std::vector<std::string>& lines, const std::string& filename,
+    size_t recordWidth
+) {
     std::filesystem::path p = filename;
     std::filesystem::path dir = p.parent_path();
     std::filesystem::create_directories(dir);
@@ -84,7 +152,7 @@ void saveFile(std::vector<std::string>& lines, const std::string& filename) {
     std::ofstream outfile(filename, std::ios::out | std::ios::binary);
     if (outfile.is_open()) {
         for (const auto& line : lines) {
-            writeLine(outfile, line);
+            writeLine(outfile, line, recordWidth);
         }
         std::cout << "Data saved to " << filename << std::endl;
     } else {
@@ -94,16 +162,32 @@ void saveFile(std::vector<std::string>& lines, const std::string& filename) {
 
 int main(int argc, char** argv) {
     CreateOptions options(argc, argv);
-    std::vector<std::string> lines;
 
     if (options.isInteractiveMode()) {
-        manualMode(lines);
+        std::vector<std::string> lines;
+        manualMode(lines, options.getRecordWidth());
+        if (lines.empty()) {
+            return 0;
+        }
+        if (options.getPageFormat() == PageFormat::VARIABLE) {
+            dispatchRecordWidth(options.getRecordWidth(), [&]<size_t W>() {
+                writeVariableFile<W>(
+                    options.getFileName(),
+                    options.getBlockingFactor(),
+                    [&](auto&& append) {
+                        for (const auto& line : lines) {
+                            append(line);
+                        }
+                    }
+                );
+            });
+            std::cout << "Data saved to " << options.getFileName()
+                      << std::endl;
+        } else {
+            saveFile(lines, options.getFileName(), options.getRecordWidth());
+        }
     } else if (options.isRandomMode()) {
-        autoMode(lines, options.getRandomCount(), options.isNumbersOnly());
-    }
-
-    if (!lines.empty()) {
-        saveFile(lines, options.getFileName());
+        autoMode(options);
     }
 
     return 0;
@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <exception>
+#include <fence_index.hpp>
+#include <file_buffering.hpp>
+#include <format>
+#include <iostream>
+#include <lookup_options.hpp>
+#include <metrics.hpp>
+#include <record.hpp>
+#include <vector>
+
+template <size_t RecordLen>
+static int runLookup(const LookupOptions& options) {
+    using Record = BasicRecord<RecordLen>;
+    using FenceIndex = BasicFenceIndex<RecordLen>;
+
+    auto loaded = FenceIndex::load(options.getIndexFileName());
+    BasicBufferedFile<RecordLen> f(
+        options.getFileName(), loaded.recordsPerPage, loaded.format, "input"
+    );
+    if (f.getPageCount() != loaded.index.getPageCount()) {
+        std::cerr << std::format(
+            "Error: {} has {} pages but its index {}, sort it again\n",
+            options.getFileName(),
+            f.getPageCount(),
+            loaded.index.getPageCount()
+        );
+        return 2;
+    }
+
+    // Opening the file already loads its first page
+    auto opened = f.getMetrics().snapshot();
+
+    Record low(options.getLowKey());
+    Record high(options.getHighKey());
+    auto [first, last] = loaded.index.pagesFor(low, high);
+
+    size_t found = 0;
+    auto report = [&](const Record& r) {
+        found++;
+        if (!options.isCountOnly()) {
+            std::cout << r.str() << '\n';
+        }
+    };
+    auto isMatch = [&](const Record& r) { return !(r < low || r > high); };
+
+    // NOTE: Records equal to `low` may end the pages before the first one if
+    // it starts with `low`. They are read backwards without evicting the
+    // cached first page, and every match among them equals `low`.
+    auto startsWithLow = [&](const std::vector<Record>& page) {
+        return !page.empty() && page.front() == low;
+    };
+    if (first < last && first > 0 && startsWithLow(f.readPage(first))) {
+        size_t matchesBefore = 0;
+        size_t pageIndex = first;
+        std::vector<Record> page;
+        do {
+            f.readPageInto(--pageIndex, page);
+            matchesBefore += std::ranges::count_if(page, isMatch);
+        } while (pageIndex > 0 && startsWithLow(page));
+        for (size_t i = 0; i < matchesBefore; i++) {
+            report(low);
+        }
+    }
+    for (size_t pageIndex = first; pageIndex < last; pageIndex++) {
+        for (const auto& r : f.readPage(pageIndex)) {
+            if (isMatch(r)) {
+                report(r);
+            }
+        }
+    }
+
+    auto io = f.getMetrics().snapshot() - opened;
+    std::cout << std::format(
+        "Found {} records in {} page reads\n", found, io.pageReads
+    ) << std::flush;
+    return found != 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    LookupOptions options(argc, argv);
+
+    try {
+        size_t width = readFenceIndexRecordWidth(options.getIndexFileName());
+        return dispatchRecordWidth(width, [&]<size_t RecordLen>() {
+            return runLookup<RecordLen>(options);
+        });
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 2;
+    }
+}
@@ -0,0 +1,264 @@
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <bench_options.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <generator.hpp>
+#include <iostream>
+#include <metrics.hpp>
+#include <sorter.hpp>
+#include <string>
+#include <vector>
+
+// One configuration of the sweep
+struct BenchCase {
+    size_t recordCount;
+    size_t blockingFactor;
+    size_t bufferCount;
+    Distribution distribution;
+    size_t threadCount;
+    size_t recordWidth;
+};
+
+// Everything measured during a single sort. It is sent from the child
+// process back to the parent, so it must stay trivially copyable.
+struct BenchResult {
+    double wallMs = 0;
+    double cpuMs = 0;
+    size_t pageReads = 0;
+    size_t pageWrites = 0;
+    size_t bytesMoved = 0;
+    size_t runCount = 0;
+    size_t phaseCount = 0;
+    long peakRssKb = 0;
+    bool ok = false;
+};
+
+template <size_t RecordLen>
+static BenchResult measureSort(
+    const std::string& fileName, const BenchCase& c
+) {
+    using BufferedFile = BasicBufferedFile<RecordLen>;
+
+    SortConfig config{
+        .bufferCount = c.bufferCount,
+        .blockingFactor = c.blockingFactor,
+        .recordWidth = c.recordWidth,
+        .threadCount = c.threadCount,
+        .logging = false,
+    };
+
+    BenchResult result;
+    Metrics::instance().reset();
+
+    auto wallStart = std::chrono::steady_clock::now();
+    double cpuStart = processCpuTimeMs();
+    SortStats stats;
+    {
+        BufferedFile f(fileName, c.blockingFactor, PageFormat::FIXED, "input");
+        stats = sortFile(f, config);
+    }
+    result.cpuMs = processCpuTimeMs() - cpuStart;
+    result.wallMs = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - wallStart
+    )
+                        .count();
+
+    IoSnapshot io = Metrics::instance().totals();
+    result.pageReads = io.pageReads;
+    result.pageWrites = io.pageWrites;
+    result.bytesMoved = io.bytesRead + io.bytesWritten;
+    result.runCount = stats.runCount;
+    result.phaseCount = stats.phaseCount;
+    result.ok = true;
+    return result;
+}
+
+// Sorts in a forked child so that every run starts with a fresh heap and its
+// peak RSS is not shadowed by earlier, larger runs
+static BenchResult runCase(const std::string& fileName, const BenchCase& c) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return {};
+    }
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        BenchResult result = dispatchRecordWidth(
+            c.recordWidth,
+            [&]<size_t RecordLen>() {
+                return measureSort<RecordLen>(fileName, c);
+            }
+        );
+        ssize_t written = write(fds[1], &result, sizeof(result));
+        _exit(written == sizeof(result) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    BenchResult result;
+    if (pid < 0 || read(fds[0], &result, sizeof(result)) != sizeof(result)) {
+        result = {};
+    }
+    close(fds[0]);
+
+    if (pid > 0) {
+        int status = 0;
+        rusage usage{};
+        wait4(pid, &status, 0, &usage);
+        result.peakRssKb = usage.ru_maxrss;
+        result.ok = result.ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+    return result;
+}
+
+static std::vector<BenchCase> buildCases(const BenchOptions& options) {
+    std::vector<BenchCase> cases;
+    for (size_t w : options.getRecordWidths()) {
+        for (Distribution d : options.getDistributions()) {
+            for (size_t r : options.getRecordCounts()) {
+                for (size_t b : options.getBlockingFactors()) {
+                    for (size_t n : options.getBufferCounts()) {
+                        for (size_t t : options.getThreadCounts()) {
+                            cases.push_back({r, b, n, d, t, w});
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return cases;
+}
+
+static void printHeader(std::ostream& out, BenchOptions::Format format) {
+    if (format == BenchOptions::Format::CSV) {
+        out << "records,blocking_factor,buffers,distribution,threads,"
+               "record_width,repeat,ok,wall_ms,cpu_ms,page_reads,page_writes,"
+               "bytes_moved,runs,phases,peak_rss_kb\n";
+    } else {
+        out << "[\n";
+    }
+}
+
+static void printRow(
+    std::ostream& out, BenchOptions::Format format, const BenchCase& c,
+    size_t repeat, const BenchResult& r, bool first
+) {
+    if (format == BenchOptions::Format::CSV) {
+        out << std::format(
+            "{},{},{},{},{},{},{},{},{:.3f},{:.3f},{},{},{},{},{},{}\n",
+            c.recordCount,
+            c.blockingFactor,
+            c.bufferCount,
+            distributionName(c.distribution),
+            c.threadCount,
+            c.recordWidth,
+            repeat,
+            r.ok,
+            r.wallMs,
+            r.cpuMs,
+            r.pageReads,
+            r.pageWrites,
+            r.bytesMoved,
+            r.runCount,
+            r.phaseCount,
+            r.peakRssKb
+        );
+    } else {
+        out << (first ? "" : ",\n")
+            << std::format(
+                   "  {{\"records\": {}, \"blocking_factor\": {}, "
+                   "\"buffers\": {}, \"distribution\": \"{}\", "
+                   "\"threads\": {}, \"record_width\": {}, \"repeat\": {}, "
+                   "\"ok\": {}, \"wall_ms\": {:.3f}, \"cpu_ms\": {:.3f}, "
+                   "\"page_reads\": {}, \"page_writes\": {}, "
+                   "\"bytes_moved\": {}, \"runs\": {}, \"phases\": {}, "
+                   "\"peak_rss_kb\": {}}}",
+                   c.recordCount,
+                   c.blockingFactor,
+                   c.bufferCount,
+                   distributionName(c.distribution),
+                   c.threadCount,
+                   c.recordWidth,
+                   repeat,
+                   r.ok,
+                   r.wallMs,
+                   r.cpuMs,
+                   r.pageReads,
+                   r.pageWrites,
+                   r.bytesMoved,
+                   r.runCount,
+                   r.phaseCount,
+                   r.peakRssKb
+               );
+    }
+    out.flush();
+}
+
+static void printFooter(std::ostream& out, BenchOptions::Format format) {
+    if (format == BenchOptions::Format::JSON) {
+        out << "\n]\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options(argc, argv);
+
+    std::ofstream outFile;
+    if (!options.getOutputFile().empty()) {
+        outFile.open(options.getOutputFile());
+    }
+    std::ostream& out = outFile.is_open() ? outFile : std::cout;
+
+    std::filesystem::create_directories(options.getWorkDir());
+    std::string inputFile =
+        std::filesystem::path(options.getWorkDir()) / "bench_input";
+
+    auto cases = buildCases(options);
+    printHeader(out, options.getFormat());
+
+    bool first = true;
+    for (size_t i = 0; i < cases.size(); i++) {
+        const BenchCase& c = cases[i];
+        GeneratorConfig genConfig{
+            .recordWidth = c.recordWidth,
+            .recordCount = c.recordCount,
+            .seed = options.getSeed(),
+            .distribution = c.distribution,
+        };
+        RecordGenerator generator(genConfig);
+
+        for (size_t repeat = 0; repeat < options.getRepeatCount(); repeat++) {
+            std::cerr << std::format(
+                             "[{}/{}] records={} b={} n={} dist={} t={} w={} "
+                             "repeat={}",
+                             i + 1,
+                             cases.size(),
+                             c.recordCount,
+                             c.blockingFactor,
+                             c.bufferCount,
+                             distributionName(c.distribution),
+                             c.threadCount,
+                             c.recordWidth,
+                             repeat
+                         )
+                      << std::endl;
+
+            // The sort works in place, so every repeat needs a fresh input
+            writeGeneratedFile(inputFile, generator, 1);
+            BenchResult result = runCase(inputFile, c);
+            printRow(out, options.getFormat(), c, repeat, result, first);
+            first = false;
+        }
+    }
+
+    printFooter(out, options.getFormat());
+    std::filesystem::remove(inputFile);
+    return 0;
+}
@@ -1,245 +1,286 @@
-#include <algorithm>
-#include <buffer.hpp>
 #include <cmath>
 #include <cstddef>
+#include <exception>
+#include <external_sorter.hpp>
 #include <file_buffering.hpp>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <metrics.hpp>
 #include <ostream>
-#include <queue>
-#include <ranges>
+#include <perf_counters.hpp>
+#include <shard_sort.hpp>
+#include <sorter.hpp>
+#include <temp_file.hpp>
+#include <trace.hpp>
 #include <vector>
 
-#include "temp_file.hpp"
 #include "util/sort_options.hpp"
 
-void createRunsInFile(BufferedFile& f, const SortOptions& options);
-void mergeRuns(BufferedFile& f, const SortOptions& options, size_t& phaseCount);
+template <size_t RecordLen>
+int runSort(const SortOptions& options);
+template <size_t RecordLen>
+int runStream(const SortOptions& options);
 
-int main(int argc, char** argv) {
-    SortOptions options(argc, argv);
-    BufferedFile::setRecordsPerPage(options.getBlockingFactor());
-
-    BufferedFile f(options.getFileName());
-    std::cout << "Loaded file: " << options.getFileName() << std::endl;
-    f.printFileContent();
+static void printCounters(
+    const std::string& name,
+    const PerfCounters::Counts& counters,
+    uint64_t records
+) {
+    if (!counters.any()) {
+        return;
+    }
+    std::cout << "Counters " << name << ":";
+    for (size_t i = 0; i < PerfCounters::COUNTER_COUNT; i++) {
+        if (!counters.available[i]) {
+            continue;
+        }
+        std::cout << " "
+                  << PerfCounters::counterName(PerfCounters::Counter(i))
+                  << "=" << counters.values[i];
+        if (records != 0) {
+            std::cout << " ("
+                      << static_cast<double>(counters.values[i]) / records
+                      << "/record)";
+        }
+    }
     std::cout << std::endl;
-
-    createRunsInFile(f, options);
-
-    size_t phaseCount = 0;
-    mergeRuns(f, options, phaseCount);
-
-    std::cout << "\nFinished" << std::endl;
-    std::cout << "Write Count: " << BufferedFile::writeCount << std::endl;
-    std::cout << "Read Count: " << BufferedFile::readCout << std::endl;
-
-    auto N = static_cast<double>(f.getRecordCount());
-    auto b = static_cast<double>(options.getBlockingFactor());
-    auto n = static_cast<double>(options.getBufferCount());
-
-    double theoryAccess = std::floor((2 * N) / (b * log(n)) * log(N / b));
-
-    double theoryPhase = std::ceil(log(N / b) / log(n) - 1);
-
-    std::cout << "Phases Needed Actual: " << phaseCount << std::endl;
-    std::cout << "Phases Needed Theory: " << theoryPhase << std::endl;
-    std::cout << "Disk accesses in practice: "
-              << BufferedFile::readCout + BufferedFile::writeCount << std::endl;
-    std::cout << "Disk accesses in theory:" << theoryAccess << std::endl;
-    std::cout << "Sorted contents: " << std::endl;
-    f.printFileContent();
-    return 0;
 }
 
-void createRunsInFile(BufferedFile& f, const SortOptions& options) {
-    if (options.isLogging()) {
-        std::cout << "Stage 1: Divide into runs" << std::endl;
-    }
-
-    std::vector<std::vector<Record>> buffers(options.getBufferCount());
-
-    auto cmp = [&](auto& a, auto& b) {
-        return buffers[a.first][a.second] > buffers[b.first][b.second];
-    };
-    std::priority_queue<
-        std::pair<size_t, size_t>,
-        std::vector<std::pair<size_t, size_t>>,
-        decltype(cmp)>
-        pq(cmp);
-
-    auto [fBegin, fEnd] = f.pages();
-    bool isFileEmpty = false;
-
-    Buffer outBuf;
-    outBuf = f.pages();
-
-    size_t runCount = 0;
+int main(int argc, char** argv) {
+    SortOptions options(argc, argv);
 
-    while (!isFileEmpty) {
-        // NOTE: Fill all buffers
-        for (auto& b : buffers) {
-            if (fBegin == fEnd) {
-                isFileEmpty = true;
-                break;
-            }
-            b = *fBegin++;
-        }
-        if (std::ranges::all_of(buffers, [](auto& b) { return b.empty(); })) {
-            break;
+    try {
+        if (!options.getTempDirectories().empty()) {
+            setTempDirectories(
+                {options.getTempDirectories().begin(),
+                 options.getTempDirectories().end()},
+                options.getTempPlacement()
+            );
         }
-
-        // NOTE: Sort:
-        for (auto& b : buffers) {
-            std::ranges::sort(b);
+        if (options.isStreaming()) {
+            std::ios::sync_with_stdio(false);
+            return dispatchRecordWidth(
+                options.getRecordWidth(),
+                [&]<size_t RecordLen>() {
+                    return runStream<RecordLen>(options);
+                }
+            );
         }
+        return dispatchRecordWidth(
+            options.getRecordWidth(),
+            [&]<size_t RecordLen>() { return runSort<RecordLen>(options); }
+        );
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
 
-        // NOTE: Initialize pg with first element from each nonempty buffer
-        for (size_t i = 0; i < buffers.size(); i++) {
-            if (!buffers[i].empty()) {
-                pq.push({i, 0});
-            }
+// Files to merge. With --sort-inputs an unsorted input is merged from a
+// sorted temporary copy, the files given are only ever read.
+template <size_t RecordLen>
+struct MergeInputs {
+    std::vector<std::unique_ptr<BasicBufferedFile<RecordLen>>> opened;
+    std::vector<std::unique_ptr<BasicTempFile<RecordLen>>> sortedCopies;
+    std::vector<BasicBufferedFile<RecordLen>*> files;
+};
+
+// Opens the files to merge, sorting copies of the unsorted ones with
+// --sort-inputs
+template <size_t RecordLen>
+static MergeInputs<RecordLen> openInputs(const SortOptions& options) {
+    using BufferedFile = BasicBufferedFile<RecordLen>;
+
+    MergeInputs<RecordLen> inputs;
+    for (const auto& name : options.getInputFileNames()) {
+        auto& in = inputs.opened.emplace_back(std::make_unique<BufferedFile>(
+            name,
+            options.getBlockingFactor(),
+            options.getPageFormat(),
+            "input"
+        ));
+        std::cout << "Loaded file: " << name << std::endl;
+        std::cout << "Records: " << in->getRecordCount() << std::endl;
+        if (!options.isSortingInputs() || isSorted(*in, options.getOrder())) {
+            inputs.files.push_back(in.get());
+            continue;
         }
+        std::cout << "Sorting " << name << " into a temporary copy first"
+                  << std::endl;
+        auto& copy = inputs.sortedCopies.emplace_back(
+            sortIntoTempFile(*in, options.getSortConfig())
+        );
+        inputs.files.push_back(&static_cast<BufferedFile&>(*copy));
+    }
+    return inputs;
+}
 
-        // NOTE: K-way merge
-        while (!pq.empty()) {
-            auto [bufIdx, elemIdx] = pq.top();
-            pq.pop();
-
-            outBuf.append(buffers[bufIdx][elemIdx]);
+template <size_t RecordLen>
+int runSort(const SortOptions& options) {
+    using BufferedFile = BasicBufferedFile<RecordLen>;
 
-            // Add next element from same buffer
-            if (elemIdx + 1 < buffers[bufIdx].size()) {
-                pq.push({bufIdx, elemIdx + 1});
-            }
-        }
+    MergeInputs<RecordLen> inputs;
+    if (options.isMerging()) {
+        inputs = openInputs<RecordLen>(options);
+        // NOTE: An old file of another layout would not even open
+        std::filesystem::remove(options.getFileName());
+    }
 
-        for (auto& b : buffers) {
-            b.clear();
+    BufferedFile f(
+        options.getFileName(),
+        options.getBlockingFactor(),
+        options.getPageFormat(),
+        options.isMerging() ? "output" : "input"
+    );
+    size_t recordCount = 0;
+    if (options.isMerging()) {
+        for (auto* in : inputs.files) {
+            recordCount += in->getRecordCount();
         }
-
-        if (options.isLogging()) {
-            std::cout << "Run " << ++runCount << ":" << std::endl;
-            std::cout << "File contents:" << std::endl;
+        std::cout << "Merging " << inputs.files.size() << " files into "
+                  << options.getFileName() << std::endl;
+    } else {
+        std::cout << "Loaded file: " << options.getFileName() << std::endl;
+        recordCount = f.getRecordCount();
+        if (options.isDumpingContents()) {
             f.printFileContent();
-            std::cout << std::endl;
         }
     }
-}
-
-void mergeRuns(
-    BufferedFile& f, const SortOptions& options, size_t& phaseCount
-) {
-    if (options.isLogging()) {
-        std::cout << "Stage 2: Merging runs\n" << std::endl;
-    }
-    std::vector<Buffer> buffers(options.getBufferCount());
-
-    TempFile t;
-    BufferedFile* src = &f;
-    BufferedFile* dest = &static_cast<BufferedFile&>(t);
-
-    size_t totalPageCount = f.getPageCount();
-    size_t runLenInPages = options.getBufferCount();
-
-    auto cmp = [&](auto& a, auto& b) {
-        return buffers[a.first][a.second] > buffers[b.first][b.second];
-    };
-    std::priority_queue<
-        std::pair<size_t, size_t>,
-        std::vector<std::pair<size_t, size_t>>,
-        decltype(cmp)>
-        pq(cmp);
-
-    // NOTE: Do until one run remains
-    while (runLenInPages < totalPageCount) {
-        auto srcPages = src->pages();
-        auto dstPages = dest->pages();
-        size_t readPages = 0;
-        phaseCount++;
-
-        if (options.isLogging()) {
-            std::cout << "Phase " << phaseCount << std::endl;
-            std::cout << "Merging " << options.getBufferCount() - 1
-                      << " runs of lenght "
-                      << runLenInPages * BufferedFile::recordsPerPage
-                      << std::endl;
-
-            std::cout << "dest = "
-                      << (dest == &f ? options.getFileName() : t.getFileName())
-                      << std::endl;
-            std::cout << "src = "
-                      << (src == &f ? options.getFileName() : t.getFileName())
-                      << std::endl;
-        }
-
-        // NOTE: Do one merge pass
-        while (readPages < totalPageCount) {
-            buffers.clear();
-            size_t inputBuffersUsed = 0;
-
-            // NOTE: Fill all input buffers
-            for (size_t i = 0; i < options.getBufferCount() - 1; i++) {
-                if (srcPages.empty()) {
-                    break;
-                }
+    std::cout << "Records: " << recordCount << std::endl;
+    std::cout << std::endl;
 
-                size_t pagesInThisRun =
-                    std::min(srcPages.size(), runLenInPages);
+    if (options.usePerfCounters() && !PerfCounters::instance().open()) {
+        std::cerr << "Warning: Hardware counters unavailable, "
+                  << PerfCounters::instance().getError() << std::endl;
+    }
 
-                auto runBegin = srcPages.begin();
-                auto runEnd = std::ranges::next(runBegin, pagesInThisRun);
+    bool tracing = !options.getTraceFile().empty();
+    if (tracing) {
+#ifndef ENABLE_TRACING
+        std::cerr << "Warning: Built without ENABLE_TRACING, the trace will "
+                     "be empty"
+                  << std::endl;
+#endif
+        Tracer::instance().start();
+    }
 
-                buffers.emplace_back(runBegin, runEnd);
-                inputBuffersUsed++;
+    SortStats stats;
+    if (options.isMerging()) {
+        stats = mergeFiles(inputs.files, f, options.getSortConfig());
+    } else if (options.isSharding()) {
+        stats = sortSharded(
+            f, options.getSortConfig(), options.getShardConfig()
+        );
+    } else {
+        stats = sortAppended(
+            f, options.getSortedPages(), options.getSortConfig()
+        );
+    }
 
-                srcPages = {runEnd, srcPages.end()};
-            }
+    if (tracing) {
+        Tracer::instance().stop();
+        std::ofstream traceFile(options.getTraceFile());
+        Tracer::instance().writeJson(traceFile);
+        if (!traceFile) {
+            std::cerr << "Error: Could not write " << options.getTraceFile()
+                      << std::endl;
+            return 1;
+        }
+    }
 
-            readPages = totalPageCount - std::ranges::distance(srcPages);
+    IoSnapshot io = Metrics::instance().totals();
 
-            if (inputBuffersUsed == 0) {
-                break;
-            }
+    std::cout << "\nFinished" << std::endl;
+    std::cout << "Write Count: " << io.pageWrites << std::endl;
+    std::cout << "Read Count: " << io.pageReads << std::endl;
 
-            // Setup output buffer
-            buffers.emplace_back(dstPages);
+    if (options.getDedupMode() != DedupMode::NONE) {
+        std::cout << "Distinct records: " << stats.outputCount << std::endl;
+    } else if (options.getLimit().has_value()) {
+        std::cout << "Records kept: " << stats.outputCount << std::endl;
+    }
+    if (options.getDedupMode() == DedupMode::COUNT) {
+        std::cout << "Counts written to " << countsPath(options.getFileName())
+                  << std::endl;
+    }
 
-            // NOTE: Initialize pg with first element from each nonempty buffer
-            for (size_t i = 0; i < inputBuffersUsed; i++) {
-                if (!buffers[i].empty()) {
-                    pq.push({i, 0});
-                }
-            }
+    auto N = static_cast<double>(recordCount);
+    auto b = static_cast<double>(options.getBlockingFactor());
+    auto n = static_cast<double>(options.getBufferCount());
 
-            // NOTE: K-way merge
-            while (!pq.empty()) {
-                auto [bufIdx, elemIdx] = pq.top();
-                pq.pop();
+    double theoryAccess = std::floor((2 * N) / (b * log(n)) * log(N / b));
 
-                buffers.back().append(buffers[bufIdx][elemIdx]);
+    double theoryPhase = std::ceil(log(N / b) / log(n) - 1);
 
-                // Add next element from same buffer
-                if (elemIdx + 1 < buffers[bufIdx].size()) {
-                    pq.push({bufIdx, elemIdx + 1});
-                }
-            }
+    std::cout << "Phases Needed Actual: " << stats.phaseCount << std::endl;
+    std::cout << "Phases Needed Theory: " << theoryPhase << std::endl;
+    std::cout << "Disk accesses in practice: "
+              << io.pageReads + io.pageWrites << std::endl;
+    // NOTE: Every worker counts its own I/O, only its phases are read back
+    if (options.isSharding()) {
+        std::cout << "Disk accesses of the shard workers are not included"
+                  << std::endl;
+    }
+    std::cout << "Disk accesses in theory:" << theoryAccess << std::endl;
+    std::cout << "Peak disk usage: " << Metrics::instance().getPeakDiskUsage()
+              << " bytes" << std::endl;
+    for (const auto& phase : Metrics::instance().getPhases()) {
+        printCounters(phase.name, phase.counters, phase.records);
+    }
+    for (const auto& section : Metrics::instance().getSections()) {
+        printCounters(section.name, section.counters, section.records);
+        // NOTE: The counters of a pipeline's sorter thread are only added to
+        // those of the process once it is joined, within the phase
+        if (section.uncountedCalls != 0) {
+            std::cout << "Counters " << section.name << ": "
+                      << section.uncountedCalls << " of " << section.calls
+                      << " calls not counted, they ran on another thread"
+                      << std::endl;
         }
+    }
+    if (options.isDumpingContents()) {
+        std::cout << "Sorted contents: " << std::endl;
+        f.printFileContent();
+    }
 
-        if (options.isLogging()) {
-            std::cout << "File contents:" << std::endl;
-            dest->printFileContent();
+    if (!options.getStatsJsonFile().empty()) {
+        std::ofstream statsFile(options.getStatsJsonFile());
+        Metrics::instance().writeJson(statsFile);
+        if (!statsFile) {
+            std::cerr << "Error: Could not write "
+                      << options.getStatsJsonFile() << std::endl;
+            return 1;
         }
-
-        runLenInPages *= (options.getBufferCount() - 1);
-
-        BufferedFile* temp = dest;
-        dest = src;
-        src = temp;
     }
+    return 0;
+}
 
-    // This is a little bit counterintuitive, as we want to copy the contents of
-    // the last written destination to the source, thus: src->copyFrom(*dest)
-    // We actually need to do the reverse as we switch dest and src right before
-    // exiting the loop
-    dest->copyFrom(*src);
+template <size_t RecordLen>
+int runStream(const SortOptions& options) {
+    BasicExternalSorter<RecordLen> sorter(options.getExternalSorterOptions());
+    sorter.addStream(std::cin, options.getStreamFormat());
+    SortStats stats = sorter.sort(std::cout, options.getStreamFormat());
+
+    // NOTE: stdout holds the records, so the summary goes to stderr
+    IoSnapshot io = Metrics::instance().totals();
+    std::cerr << "Records written: " << stats.outputCount << std::endl;
+    std::cerr << "Runs: " << stats.runCount << std::endl;
+    std::cerr << "Phases: " << stats.phaseCount << std::endl;
+    std::cerr << "Temporary file accesses: " << io.pageReads + io.pageWrites
+              << std::endl;
+    std::cerr << "Peak disk usage: " << Metrics::instance().getPeakDiskUsage()
+              << " bytes" << std::endl;
+
+    if (!options.getStatsJsonFile().empty()) {
+        std::ofstream statsFile(options.getStatsJsonFile());
+        Metrics::instance().writeJson(statsFile);
+        if (!statsFile) {
+            std::cerr << "Error: Could not write "
+                      << options.getStatsJsonFile() << std::endl;
+            return 1;
+        }
+    }
+    return 0;
 }
@@ -0,0 +1,263 @@
+#include <algorithm>
+#include <buffer.hpp>
+#include <chrono>
+#include <cstddef>
+#include <file_buffering.hpp>
+#include <filesystem>
+#include <format>
+#include <functional>
+#include <generator.hpp>
+#include <iostream>
+#include <ranges>
+#include <storage_bench_options.hpp>
+#include <string>
+#include <vector>
+
+// Keeps the compiler from dropping reads whose result is otherwise unused
+static volatile size_t sink = 0;
+
+struct MicroResult {
+    std::string name;
+    size_t recordWidth;
+    size_t blockingFactor;
+    // Records (or calls for getRecordCount) processed by one iteration
+    size_t records;
+    double nsPerRecord;
+    double mbPerSecond;
+};
+
+class StorageBench {
+   public:
+    StorageBench(const StorageBenchOptions& options) : options(options) {}
+
+    template <size_t RecordLen>
+    void runAll(size_t blockingFactor);
+
+    const std::vector<MicroResult>& getResults() const { return results; }
+
+   private:
+    // Runs `body` at least minIterations times and records the fastest one.
+    // `body` returns the number of records it processed.
+    void measure(
+        const std::string& name, size_t recordWidth, size_t blockingFactor,
+        size_t bytesPerRecord, const std::function<size_t()>& body
+    );
+
+    const StorageBenchOptions& options;
+    std::vector<MicroResult> results;
+};
+
+void StorageBench::measure(
+    const std::string& name, size_t recordWidth, size_t blockingFactor,
+    size_t bytesPerRecord, const std::function<size_t()>& body
+) {
+    if (!options.getFilter().empty() &&
+        name.find(options.getFilter()) == std::string::npos) {
+        return;
+    }
+
+    double bestNs = -1;
+    size_t records = 0;
+    for (size_t i = 0; i < options.getMinIterations(); i++) {
+        auto start = std::chrono::steady_clock::now();
+        records = body();
+        double ns = std::chrono::duration<double, std::nano>(
+                        std::chrono::steady_clock::now() - start
+        )
+                        .count();
+        if (bestNs < 0 || ns < bestNs) {
+            bestNs = ns;
+        }
+    }
+
+    double nsPerRecord = records == 0 ? 0 : bestNs / records;
+    double mbPerSecond =
+        bestNs <= 0 ? 0 : (records * bytesPerRecord) / (bestNs / 1e9) / 1e6;
+    results.push_back(
+        {name, recordWidth, blockingFactor, records, nsPerRecord, mbPerSecond}
+    );
+}
+
+template <size_t RecordLen>
+void StorageBench::runAll(size_t b) {
+    using BufferedFile = BasicBufferedFile<RecordLen>;
+    using Buffer = BasicBuffer<RecordLen>;
+    using Record = BasicRecord<RecordLen>;
+
+    const size_t w = RecordLen;
+    const size_t stride = options.getStride();
+    const std::filesystem::path dir = options.getWorkDir();
+    const std::string inputName = dir / "storage_bench_input";
+    const std::string outputName = dir / "storage_bench_output";
+
+    GeneratorConfig config{
+        .recordWidth = w, .recordCount = options.getRecordCount(), .seed = 1
+    };
+    writeGeneratedFile(inputName, RecordGenerator(config), 1);
+
+    BufferedFile f(inputName, b);
+    const size_t n = f.getRecordCount();
+    const size_t pageCount = f.getPageCount();
+    const Record record("storage_bench");
+
+    measure("readPage/sequential", w, b, w, [&]() {
+        for (size_t p = 0; p < pageCount; p++) {
+            sink = sink + f.readPage(p).size();
+        }
+        return pageCount * b;
+    });
+
+    measure("readPage/strided", w, b, w, [&]() {
+        for (size_t k = 0; k < pageCount; k++) {
+            sink = sink + f.readPage((k * stride) % pageCount).size();
+        }
+        return pageCount * b;
+    });
+
+    measure("readPage/hit", w, b, w, [&]() {
+        for (size_t k = 0; k < pageCount; k++) {
+            sink = sink + f.readPage(0).size();
+        }
+        return pageCount * b;
+    });
+
+    measure("read/sequential", w, b, w, [&]() {
+        for (size_t i = 0; i < n; i++) {
+            sink = sink + f.read(i).data()[0];
+        }
+        return n;
+    });
+
+    // Every access lands on another page, so each one is a page miss
+    measure("read/strided", w, b, w, [&]() {
+        for (size_t k = 0; k < n; k++) {
+            sink = sink + f.read((k * (stride * b + 1)) % n).data()[0];
+        }
+        return n;
+    });
+
+    measure("getRecordCount", w, b, 0, [&]() {
+        for (size_t k = 0; k < pageCount; k++) {
+            sink = sink + f.getRecordCount();
+        }
+        return pageCount;
+    });
+
+    measure("PageIterator/traversal", w, b, w, [&]() {
+        for (auto page : f.pages()) {
+            std::vector<Record> records = page;
+            sink = sink + records.size();
+        }
+        return pageCount * b;
+    });
+
+    measure("Buffer/operator[]", w, b, w, [&]() {
+        auto pages = f.pages();
+        Buffer in(pages.begin(), std::ranges::next(pages.begin(), pageCount));
+        for (size_t i = 0; i < in.size(); i++) {
+            sink = sink + in[i].data()[0];
+        }
+        return in.size();
+    });
+
+    std::filesystem::remove(outputName);
+    BufferedFile out(outputName, b);
+
+    measure("write/sequential", w, b, w, [&]() {
+        for (size_t i = 0; i < n; i++) {
+            out.write(i, record);
+        }
+        out.flush();
+        return n;
+    });
+
+    measure("writePage/sequential", w, b, w, [&]() {
+        std::vector<Record> page(b, record);
+        for (size_t p = 0; p < pageCount; p++) {
+            out.writePage(p, page);
+        }
+        out.flush();
+        return pageCount * b;
+    });
+
+    // Dirties one record of every page and flushes it, a whole page is
+    // written per flush
+    measure("flush", w, b, w, [&]() {
+        for (size_t p = 0; p < pageCount; p++) {
+            out.write(p * b, record);
+            out.flush();
+        }
+        return pageCount * b;
+    });
+
+    measure("Buffer/append", w, b, w, [&]() {
+        Buffer outBuf(out.pages());
+        for (size_t i = 0; i < n; i++) {
+            outBuf.append(record);
+        }
+        return n;
+    });
+
+    std::filesystem::remove(inputName);
+    std::filesystem::remove(outputName);
+}
+
+static void printResults(
+    const std::vector<MicroResult>& results, StorageBenchOptions::Format format
+) {
+    if (format == StorageBenchOptions::Format::CSV) {
+        std::cout << "name,record_width,blocking_factor,records,"
+                     "ns_per_record,mb_per_s\n";
+        for (const auto& r : results) {
+            std::cout << std::format(
+                "{},{},{},{},{:.2f},{:.2f}\n",
+                r.name,
+                r.recordWidth,
+                r.blockingFactor,
+                r.records,
+                r.nsPerRecord,
+                r.mbPerSecond
+            );
+        }
+        return;
+    }
+
+    std::cout << "[\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto& r = results[i];
+        std::cout << std::format(
+            "  {{\"name\": \"{}\", \"record_width\": {}, "
+            "\"blocking_factor\": {}, \"records\": {}, "
+            "\"ns_per_record\": {:.2f}, \"mb_per_s\": {:.2f}}}{}\n",
+            r.name,
+            r.recordWidth,
+            r.blockingFactor,
+            r.records,
+            r.nsPerRecord,
+            r.mbPerSecond,
+            i + 1 < results.size() ? "," : ""
+        );
+    }
+    std::cout << "]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    StorageBenchOptions options(argc, argv);
+    std::filesystem::create_directories(options.getWorkDir());
+
+    StorageBench bench(options);
+    for (size_t w : options.getRecordWidths()) {
+        for (size_t b : options.getBlockingFactors()) {
+            std::cerr << std::format(
+                             "record width {}, blocking factor {}", w, b
+                         )
+                      << std::endl;
+            dispatchRecordWidth(w, [&]<size_t RecordLen>() {
+                bench.runAll<RecordLen>(b);
+            });
+        }
+    }
+
+    printResults(bench.getResults(), options.getFormat());
+    return 0;
+}
@@ -0,0 +1,214 @@
+#include "bench_options.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+BenchOptions::BenchOptions(int argc, char** argv) : scriptName(argv[0]) {
+    parse(argc, argv);
+    checkConstraints();
+}
+
+void BenchOptions::parse(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        parseArgument(argv[i], i, argc, argv);
+    }
+}
+
+void BenchOptions::parseArgument(
+    const std::string& arg, int& i, int argc, char** argv
+) {
+    if (arg.starts_with('-')) {
+        handleFlag(arg, i, argc, argv);
+    } else {
+        std::cerr << "Error: Unexpected argument '" << arg << "'\n";
+        printHelpAndExit();
+    }
+}
+
+void BenchOptions::handleFlag(
+    const std::string& flag, int& i, int argc, char** argv
+) {
+    if ((flag == "-h") || (flag == "--help")) {
+        printHelpAndExit(0);
+    } else if ((flag == "-r") || (flag == "--records")) {
+        recordCounts = parseSizeList(i, argc, argv);
+    } else if ((flag == "-b") || (flag == "--blocking-factors")) {
+        blockingFactors = parseSizeList(i, argc, argv);
+    } else if ((flag == "-n") || (flag == "--buffers")) {
+        bufferCounts = parseSizeList(i, argc, argv);
+    } else if ((flag == "-d") || (flag == "--distributions")) {
+        parseDistributions(i, argc, argv);
+    } else if ((flag == "-t") || (flag == "--threads")) {
+        threadCounts = parseSizeList(i, argc, argv);
+    } else if ((flag == "-w") || (flag == "--record-widths")) {
+        recordWidths = parseSizeList(i, argc, argv);
+    } else if (flag == "--repeat") {
+        parseRepeatCount(i, argc, argv);
+    } else if ((flag == "-s") || (flag == "--seed")) {
+        parseSeed(i, argc, argv);
+    } else if (flag == "--format") {
+        parseFormat(i, argc, argv);
+    } else if ((flag == "-o") || (flag == "--output")) {
+        outputFile = getVal(i, argc, argv);
+    } else if (flag == "--dir") {
+        workDir = getVal(i, argc, argv);
+    } else {
+        std::cerr << "Error: Unknown argument '" << flag << "'\n";
+        printHelpAndExit();
+    }
+}
+
+std::string BenchOptions::getVal(int& i, int argc, char** argv) {
+    if (i + 1 >= argc) {
+        std::cerr << "Error: " << argv[i] << " requires a value.\n";
+        printHelpAndExit();
+    }
+    return argv[++i];
+}
+
+std::vector<size_t> BenchOptions::parseSizeList(
+    int& i, int argc, char** argv
+) {
+    auto val = getVal(i, argc, argv);
+    std::vector<size_t> values;
+    std::stringstream ss(val);
+    std::string item;
+    try {
+        while (std::getline(ss, item, ',')) {
+            values.push_back(std::stoul(item));
+        }
+    } catch (const std::exception& e) {
+        values.clear();
+    }
+    if (values.empty()) {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+    return values;
+}
+
+void BenchOptions::parseDistributions(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    distributions.clear();
+    std::stringstream ss(val);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        auto parsed = parseDistribution(item);
+        if (!parsed.has_value()) {
+            std::cerr << "Error: Invalid value for " << argv[i - 1] << ": "
+                      << item << std::endl;
+            printHelpAndExit();
+        }
+        distributions.push_back(*parsed);
+    }
+}
+
+void BenchOptions::parseRepeatCount(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    try {
+        repeatCount = std::stoul(val);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+}
+
+void BenchOptions::parseSeed(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    try {
+        seed = std::stoull(val);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+}
+
+void BenchOptions::parseFormat(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    if (val == "csv") {
+        format = Format::CSV;
+    } else if (val == "json") {
+        format = Format::JSON;
+    } else {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+}
+
+void BenchOptions::checkConstraints() const {
+    for (size_t n : bufferCounts) {
+        if (n < 3) {
+            std::cerr << "Error: Every buffer count must be at least 3."
+                      << std::endl;
+            printHelpAndExit();
+        }
+    }
+
+    for (const auto* values :
+         {&recordCounts, &blockingFactors, &threadCounts}) {
+        if (std::ranges::find(*values, 0) != values->end()) {
+            std::cerr << "Error: Record counts, blocking factors and thread "
+                         "counts must be at least 1."
+                      << std::endl;
+            printHelpAndExit();
+        }
+    }
+
+    for (size_t w : recordWidths) {
+        if (!isSupportedRecordWidth(w)) {
+            std::cerr << "Error: Unsupported record width " << w << std::endl;
+            printHelpAndExit();
+        }
+    }
+
+    if (distributions.empty()) {
+        std::cerr << "Error: At least one distribution is required."
+                  << std::endl;
+        printHelpAndExit();
+    }
+
+    if (repeatCount == 0) {
+        std::cerr << "Error: --repeat must be at least 1." << std::endl;
+        printHelpAndExit();
+    }
+}
+
+void BenchOptions::printHelpAndExit(int exitCode) const {
+    // clang-format off
+    std::cout <<
+        "Usage: " << scriptName << " [options]\n\n"
+        "Runs sort_files for every combination of the given values and\n"
+        "reports one row per run. Lists are comma separated.\n\n"
+        "Options:\n"
+        "\t-h, --help\t\tShow this help message\n\n"
+        "\t-r, --records <list>\n"
+        "\t\tRecord counts (default: 10000,100000).\n\n"
+        "\t-b, --blocking-factors <list>\n"
+        "\t\tBlocking factors (default: 10,50).\n\n"
+        "\t-n, --buffers <list>\n"
+        "\t\tBuffer counts, each at least 3 (default: 5,10).\n\n"
+        "\t-d, --distributions <list>\n"
+        "\t\tInput distributions, see create_files -h (default: uniform).\n\n"
+        "\t-t, --threads <list>\n"
+        "\t\tSorting threads (default: 1).\n\n"
+        "\t-w, --record-widths <list>\n"
+        "\t\tRecord widths (default: 30).\n\n"
+        "\t--repeat <count>\n"
+        "\t\tRuns of every configuration (default: 3).\n\n"
+        "\t-s, --seed <value>\n"
+        "\t\tSeed of the generated inputs (default: 1).\n\n"
+        "\t--format <csv|json>\n"
+        "\t\tOutput format (default: csv).\n\n"
+        "\t-o, --output <filename>\n"
+        "\t\tWrite the results to a file instead of stdout.\n\n"
+        "\t--dir <directory>\n"
+        "\t\tWhere the inputs are generated (default: temp/bench).\n";
+    // clang-format on
+    exit(exitCode);
+}
@@ -0,0 +1,73 @@
+#ifndef BENCH_OPTIONS_HPP
+#define BENCH_OPTIONS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "generator.hpp"
+#include "record.hpp"
+
+class BenchOptions {
+   public:
+    enum class Format { CSV, JSON };
+
+    BenchOptions(int argc, char** argv);
+
+    const std::vector<size_t>& getRecordCounts() const { return recordCounts; }
+    const std::vector<size_t>& getBlockingFactors() const {
+        return blockingFactors;
+    }
+    const std::vector<size_t>& getBufferCounts() const { return bufferCounts; }
+    const std::vector<Distribution>& getDistributions() const {
+        return distributions;
+    }
+    const std::vector<size_t>& getThreadCounts() const { return threadCounts; }
+    const std::vector<size_t>& getRecordWidths() const { return recordWidths; }
+    size_t getRepeatCount() const { return repeatCount; }
+    uint64_t getSeed() const { return seed; }
+    Format getFormat() const { return format; }
+    const std::string& getOutputFile() const { return outputFile; }
+    const std::string& getWorkDir() const { return workDir; }
+
+   private:
+    void parse(int argc, char** argv);
+    void parseArgument(const std::string& arg, int& i, int argc, char** argv);
+    void handleFlag(const std::string& flag, int& i, int argc, char** argv);
+
+    /**
+     * Tries to get the next argument
+     *
+     * Returns it as string
+     *
+     * If the argument is missing, exits with a error message:
+     * `"Error: " << argv[i] << " requires a value.\n"`
+     */
+    std::string getVal(int& i, int argc, char** argv);
+
+    // Parses a comma separated list of positive numbers, e.g. `10,50,100`
+    std::vector<size_t> parseSizeList(int& i, int argc, char** argv);
+    void parseDistributions(int& i, int argc, char** argv);
+    void parseRepeatCount(int& i, int argc, char** argv);
+    void parseSeed(int& i, int argc, char** argv);
+    void parseFormat(int& i, int argc, char** argv);
+
+    void checkConstraints() const;
+    void printHelpAndExit(int exitCode = 1) const;
+
+    std::vector<size_t> recordCounts = {10000, 100000};
+    std::vector<size_t> blockingFactors = {10, 50};
+    std::vector<size_t> bufferCounts = {5, 10};
+    std::vector<Distribution> distributions = {Distribution::UNIFORM};
+    std::vector<size_t> threadCounts = {1};
+    std::vector<size_t> recordWidths = {Record::maxLen};
+    size_t repeatCount = 3;
+    uint64_t seed = 1;
+    Format format = Format::CSV;
+    std::string outputFile;
+    std::string workDir = "temp/bench";
+    std::string scriptName;
+};
+
+#endif  // !BENCH_OPTIONS_HPP
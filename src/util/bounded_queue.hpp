@@ -0,0 +1,63 @@
+#ifndef BOUNDED_QUEUE_HPP
+#define BOUNDED_QUEUE_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+// Hands items from one thread of a pipeline to the next, holding at most
+// `capacity` of them. Closing it wakes every waiting thread, so a stage that
+// is done or failed stops the stages on both of its sides.
+template <typename T>
+class BoundedQueue {
+   public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity) {}
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // Waits while the queue is full, returns false and drops `item` once the
+    // queue is closed
+    bool push(T item) {
+        std::unique_lock lock(mutex);
+        changed.wait(lock, [&] { return closed || items.size() < capacity; });
+        if (closed) {
+            return false;
+        }
+        items.push_back(std::move(item));
+        changed.notify_all();
+        return true;
+    }
+
+    // Waits while the queue is empty, std::nullopt once it is also closed.
+    // Items pushed before it was closed are still handed out.
+    std::optional<T> pop() {
+        std::unique_lock lock(mutex);
+        changed.wait(lock, [&] { return closed || !items.empty(); });
+        if (items.empty()) {
+            return std::nullopt;
+        }
+        T item = std::move(items.front());
+        items.pop_front();
+        changed.notify_all();
+        return item;
+    }
+
+    void close() {
+        std::lock_guard lock(mutex);
+        closed = true;
+        changed.notify_all();
+    }
+
+   private:
+    const size_t capacity;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<T> items;
+    bool closed = false;
+};
+
+#endif  // !BOUNDED_QUEUE_HPP
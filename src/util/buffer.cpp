@@ -1,44 +1,60 @@
 #include "buffer.hpp"
 
+#include <iterator>
 #include <stdexcept>
 
 #include "error.hpp"
 #include "file_buffering.hpp"
+#include "trace.hpp"
 
-Buffer::Buffer() : mode(Mode::UNINITIALIZED) {}
+template <size_t RecordLen>
+BasicBuffer<RecordLen>::BasicBuffer() : mode(Mode::UNINITIALIZED) {}
 
-Buffer::Buffer(BufferedFile::PageIterator begin, BufferedFile::PageIterator end)
+template <size_t RecordLen>
+BasicBuffer<RecordLen>::BasicBuffer(PageIterator begin, PageIterator end)
     : mode(Mode::INPUT),
+      recordsPerPage(begin.get_file()->getRecordsPerPage()),
+      codec(&begin.get_file()->getCodec()),
       itBegin(begin),
       itCurrent(begin),
       itEnd(end),
       currentPageIndex(0) {
-    if (*itBegin != *itEnd) {
-        page = **itCurrent;
+    if (*itBegin == *itEnd) {
+        recordCount = 0;
+        return;
+    }
+
+    page = **itCurrent;
+    if (codec->isFixed()) {
         size_t pageCount = *itEnd - *itBegin;
-        recordCount = pageCount * BufferedFile::recordsPerPage;
+        recordCount = pageCount * recordsPerPage;
     } else {
-        recordCount = 0;
+        // Skip empty pages so empty() can tell without loading anything
+        advanceTo(0);
     }
 }
 
-Buffer::Buffer(
-    std::ranges::subrange<
-        BufferedFile::PageIterator, BufferedFile::PageSentinel>
-        range
+template <size_t RecordLen>
+BasicBuffer<RecordLen>::BasicBuffer(
+    std::ranges::subrange<PageIterator, PageSentinel> range
 )
-    : mode(Mode::OUTPUT), outIter(range.begin()) {
-    page.reserve(BufferedFile::recordsPerPage);
+    : mode(Mode::OUTPUT),
+      recordsPerPage(range.begin().get_file()->getRecordsPerPage()),
+      codec(&range.begin().get_file()->getCodec()),
+      outIter(range.begin()) {
+    page.reserve(recordsPerPage);
 }
 
-bool Buffer::empty() const {
+template <size_t RecordLen>
+bool BasicBuffer<RecordLen>::empty() const {
     if (mode == Mode::INPUT) {
-        return recordCount == 0;
+        return codec->isFixed() ? recordCount == 0 : page.empty();
     }
     return true;
 }
 
-Record Buffer::operator[](size_t index) {
+template <size_t RecordLen>
+auto BasicBuffer<RecordLen>::operator[](size_t index) -> Record {
     if (mode != Mode::INPUT || !itBegin.has_value()) {
         THROW_FORMATTED(
             std::logic_error,
@@ -46,12 +62,24 @@ Record Buffer::operator[](size_t index) {
         );
     }
 
-    size_t pageToLoad = index / BufferedFile::recordsPerPage;
-    size_t indexInPage = index % BufferedFile::recordsPerPage;
+    if (!codec->isFixed()) {
+        if (!advanceTo(index)) {
+            THROW_FORMATTED(
+                std::out_of_range,
+                "Record {} is not in the buffer or was already passed",
+                index
+            );
+        }
+        return page[index - pageStart];
+    }
+
+    size_t pageToLoad = index / recordsPerPage;
+    size_t indexInPage = index % recordsPerPage;
 
     if (pageToLoad != currentPageIndex) {
         itCurrent = *itBegin;
         std::advance(*itCurrent, pageToLoad);
+        releaseBefore(itCurrent->get_page_index());
         page = **itCurrent;
         currentPageIndex = pageToLoad;
     }
@@ -59,7 +87,59 @@ Record Buffer::operator[](size_t index) {
     return page[indexInPage];
 }
 
-void Buffer::append(const Record& r) {
+template <size_t RecordLen>
+bool BasicBuffer<RecordLen>::has(size_t index) {
+    if (mode != Mode::INPUT) {
+        return false;
+    }
+    if (codec->isFixed()) {
+        return index < recordCount;
+    }
+    return advanceTo(index);
+}
+
+template <size_t RecordLen>
+bool BasicBuffer<RecordLen>::advanceTo(size_t index) {
+    if (index < pageStart) {
+        return false;
+    }
+    while (index >= pageStart + page.size()) {
+        if (*itCurrent == *itEnd || std::next(*itCurrent) == *itEnd) {
+            return false;
+        }
+        pageStart += page.size();
+        ++(*itCurrent);
+        releaseBefore(itCurrent->get_page_index());
+        page = **itCurrent;
+    }
+    return true;
+}
+
+template <size_t RecordLen>
+void BasicBuffer<RecordLen>::releaseConsumedPages() {
+    if (mode != Mode::INPUT) {
+        THROW_FORMATTED(
+            std::logic_error, "Only an input buffer can release its pages"
+        );
+    }
+    releasing = true;
+    releasedPage = itBegin->get_page_index();
+}
+
+template <size_t RecordLen>
+void BasicBuffer<RecordLen>::releaseBefore(size_t pageIndex) {
+    if (!releasing || pageIndex <= releasedPage) {
+        return;
+    }
+    File* file = itBegin->get_file();
+    if ((pageIndex - releasedPage) * file->getPageSize() >=
+        File::releaseBatchBytes) {
+        releasedPage = file->releasePages(releasedPage, pageIndex);
+    }
+}
+
+template <size_t RecordLen>
+void BasicBuffer<RecordLen>::append(const Record& r) {
     if (mode != Mode::OUTPUT) {
         THROW_FORMATTED(
             std::logic_error,
@@ -67,28 +147,68 @@ void Buffer::append(const Record& r) {
         );
     }
 
+    // A record that does not fit starts a new page, where it may cost more
+    // as it no longer shares a prefix with the record before it
+    size_t cost = codec->recordCost(r, page.empty() ? nullptr : &page.back());
+    if (!page.empty() && pageBytesUsed + cost > codec->capacity()) {
+        flush();
+        cost = codec->recordCost(r);
+    }
+
     page.push_back(r);
     writtenRecordsInPage++;
+    pageBytesUsed += cost;
 
-    if (writtenRecordsInPage == BufferedFile::recordsPerPage) {
+    if (pageBytesUsed == codec->capacity()) {
         flush();
     }
 }
 
-size_t Buffer::size() const {
+template <size_t RecordLen>
+size_t BasicBuffer<RecordLen>::pageCount() const {
+    return writtenPages + (page.empty() ? 0 : 1);
+}
+
+template <size_t RecordLen>
+void BasicBuffer<RecordLen>::setFenceIndex(BasicFenceIndex<RecordLen>* index) {
+    fenceIndex = index;
+}
+
+template <size_t RecordLen>
+size_t BasicBuffer<RecordLen>::size() const {
+    if (mode == Mode::INPUT && !codec->isFixed()) {
+        THROW_FORMATTED(
+            std::logic_error,
+            "The size of a variable format buffer is not known upfront"
+        );
+    }
     if (mode == Mode::INPUT) {
         return recordCount;
     }
     return 0;
 }
 
-Buffer::~Buffer() { flush(); }
+template <size_t RecordLen>
+BasicBuffer<RecordLen>::~BasicBuffer() {
+    flush();
+}
 
-void Buffer::flush() {
+template <size_t RecordLen>
+void BasicBuffer<RecordLen>::flush() {
     if (mode == Mode::OUTPUT && !page.empty() && outIter.has_value()) {
+        TRACE_SPAN("Buffer::flush");
+        if (fenceIndex != nullptr) {
+            fenceIndex->addPage(outIter->get_page_index(), page.front());
+        }
         **outIter = page;
         ++(*outIter);
+        writtenPages++;
         page.clear();
         writtenRecordsInPage = 0;
+        pageBytesUsed = 0;
     }
 }
+
+#define INSTANTIATE_BUFFER(W) template class BasicBuffer<W>;
+FOR_EACH_RECORD_WIDTH(INSTANTIATE_BUFFER)
+#undef INSTANTIATE_BUFFER
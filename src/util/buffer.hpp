@@ -6,46 +6,85 @@
 #include <ranges>
 #include <vector>
 
+#include "fence_index.hpp"
 #include "file_buffering.hpp"
 #include "record.hpp"
 
-class Buffer {
+template <size_t RecordLen>
+class BasicBuffer {
    public:
+    using File = BasicBufferedFile<RecordLen>;
+    using Record = typename File::Record;
+    using PageIterator = typename File::PageIterator;
+    using PageSentinel = typename File::PageSentinel;
+
     // TODO: Rename to mode
     enum class Mode { UNINITIALIZED, INPUT, OUTPUT };
 
-    Buffer();
+    BasicBuffer();
 
-    Buffer(BufferedFile::PageIterator begin, BufferedFile::PageIterator end);
-    Buffer(
-        std::ranges::subrange<
-            BufferedFile::PageIterator, BufferedFile::PageSentinel>
-            range
-    );
+    BasicBuffer(PageIterator begin, PageIterator end);
+    BasicBuffer(std::ranges::subrange<PageIterator, PageSentinel> range);
 
     bool empty() const;
+    // Input only. Unless the format is PageFormat::FIXED the pages hold
+    // different numbers of records, so records must be visited in increasing
+    // order and the number of records is only known at the end.
     Record operator[](size_t index);
+    // Whether the input holds a record with this index
+    bool has(size_t index);
     void append(const Record& r);
+    // Output only. Pages written so far, counting the partial page that is
+    // written once the buffer is destroyed.
+    size_t pageCount() const;
+    // Output only. Every page written from now on is added to `index`.
+    void setFenceIndex(BasicFenceIndex<RecordLen>* index);
+    // Number of input records, only known upfront with PageFormat::FIXED
     size_t size() const;
-    ~Buffer();
+    // Input only. The pages before the loaded one are released from the
+    // file as records are read, so records must be read in increasing order
+    // and only once. See BasicBufferedFile::releasePages.
+    void releaseConsumedPages();
+    ~BasicBuffer();
 
    private:
     void flush();
+    // Loads pages of a variable input until one holds `index`
+    bool advanceTo(size_t index);
+    // Releases the pages before `pageIndex` of the file once enough of them
+    // were consumed
+    void releaseBefore(size_t pageIndex);
 
     Mode mode = Mode::UNINITIALIZED;
+    size_t recordsPerPage = 0;
+    const PageCodec<RecordLen>* codec = nullptr;
 
     // For input
-    std::optional<BufferedFile::PageIterator> itBegin;
-    std::optional<BufferedFile::PageIterator> itCurrent;
-    std::optional<BufferedFile::PageIterator> itEnd;
+    std::optional<PageIterator> itBegin;
+    std::optional<PageIterator> itCurrent;
+    std::optional<PageIterator> itEnd;
     size_t recordCount = 0;
     size_t currentPageIndex = -1;
+    // Index of the first record of the loaded page, variable format only
+    size_t pageStart = 0;
+    bool releasing = false;
+    // First page of the file that is not released yet
+    size_t releasedPage = 0;
 
     // For output
-    std::optional<BufferedFile::PageIterator> outIter;
+    std::optional<PageIterator> outIter;
     size_t writtenRecordsInPage = 0;
+    size_t pageBytesUsed = 0;
+    size_t writtenPages = 0;
+    BasicFenceIndex<RecordLen>* fenceIndex = nullptr;
 
     std::vector<Record> page;
 };
 
+#define DECLARE_BUFFER(W) extern template class BasicBuffer<W>;
+FOR_EACH_RECORD_WIDTH(DECLARE_BUFFER)
+#undef DECLARE_BUFFER
+
+using Buffer = BasicBuffer<Record::maxLen>;
+
 #endif  // !BUFFER_HPP
@@ -0,0 +1,194 @@
+#include "checkpoint.hpp"
+
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+
+#include "error.hpp"
+
+// A checkpoint is a text file of one "key value" line per field, starting
+// with the version, so it can be read when a sort has to be cleaned up by
+// hand. Paths take the rest of their line, the run starts are separated by
+// spaces.
+static constexpr std::string_view header = "checkpoint";
+static constexpr size_t version = 1;
+
+std::string checkpointPath(const std::string& fileName) {
+    return fileName + ".ckpt";
+}
+
+void Checkpoint::save(const std::string& fileName) const {
+    std::string newFileName = fileName + ".new";
+    {
+        std::ofstream out(newFileName, std::ios::trunc);
+        if (!out.is_open()) {
+            THROW_FORMATTED(
+                std::runtime_error, "Could not open {} for writing", newFileName
+            );
+        }
+        out << header << ' ' << version << '\n'
+            << "record_width " << recordWidth << '\n'
+            << "records_per_page " << recordsPerPage << '\n'
+            << "page_format " << pageFormatName(pageFormat) << '\n'
+            << "run_format " << pageFormatName(runFormat) << '\n'
+            << "order " << recordOrderName(order) << '\n'
+            << "run_count " << runCount << '\n'
+            << "phase_count " << phaseCount << '\n'
+            << "page_count " << runs.pageCount << '\n'
+            << "run_starts";
+        for (size_t start : runs.runStarts) {
+            out << ' ' << start;
+        }
+        out << '\n';
+        for (const auto& workFile : workFiles) {
+            out << "work_file " << workFile << '\n';
+        }
+        // NOTE: Last, so a checkpoint cut short has no run file
+        out << "run_file " << runFile << '\n';
+        out.flush();
+        if (!out) {
+            THROW_FORMATTED(
+                std::runtime_error, "Writing {} failed", newFileName
+            );
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(newFileName, fileName, error);
+    if (error) {
+        THROW_FORMATTED(
+            std::runtime_error,
+            "Replacing {} failed: {}",
+            fileName,
+            error.message()
+        );
+    }
+}
+
+// Parses the whole of `value` as a number
+static size_t parseCount(
+    const std::string& value, std::string_view key, const std::string& fileName
+) {
+    size_t pos = 0;
+    size_t count = 0;
+    try {
+        count = std::stoul(value, &pos);
+    } catch (const std::exception&) {
+        pos = 0;
+    }
+    if (pos == 0 || pos != value.size()) {
+        THROW_FORMATTED(
+            std::runtime_error,
+            "Checkpoint {} has an invalid {}: '{}'",
+            fileName,
+            key,
+            value
+        );
+    }
+    return count;
+}
+
+static PageFormat parseFormat(
+    const std::string& value, std::string_view key, const std::string& fileName
+) {
+    auto format = parsePageFormat(value);
+    if (!format.has_value()) {
+        THROW_FORMATTED(
+            std::runtime_error,
+            "Checkpoint {} has an invalid {}: '{}'",
+            fileName,
+            key,
+            value
+        );
+    }
+    return *format;
+}
+
+std::optional<Checkpoint> Checkpoint::load(const std::string& fileName) {
+    if (!std::filesystem::exists(fileName)) {
+        return std::nullopt;
+    }
+    std::ifstream in(fileName);
+    if (!in.is_open()) {
+        THROW_FORMATTED(
+            std::runtime_error, "Could not open checkpoint {}", fileName
+        );
+    }
+
+    std::string line;
+    if (!std::getline(in, line) ||
+        line != std::format("{} {}", header, version)) {
+        THROW_FORMATTED(
+            std::runtime_error,
+            "{} is not a checkpoint of version {}",
+            fileName,
+            version
+        );
+    }
+
+    Checkpoint checkpoint;
+    while (std::getline(in, line)) {
+        size_t space = line.find(' ');
+        std::string key = line.substr(0, space);
+        std::string value =
+            space == std::string::npos ? "" : line.substr(space + 1);
+
+        if (key == "record_width") {
+            checkpoint.recordWidth = parseCount(value, key, fileName);
+        } else if (key == "records_per_page") {
+            checkpoint.recordsPerPage = parseCount(value, key, fileName);
+        } else if (key == "page_format") {
+            checkpoint.pageFormat = parseFormat(value, key, fileName);
+        } else if (key == "run_format") {
+            checkpoint.runFormat = parseFormat(value, key, fileName);
+        } else if (key == "order") {
+            auto order = parseRecordOrder(value);
+            if (!order.has_value()) {
+                THROW_FORMATTED(
+                    std::runtime_error,
+                    "Checkpoint {} has an invalid {}: '{}'",
+                    fileName,
+                    key,
+                    value
+                );
+            }
+            checkpoint.order = *order;
+        } else if (key == "run_count") {
+            checkpoint.runCount = parseCount(value, key, fileName);
+        } else if (key == "phase_count") {
+            checkpoint.phaseCount = parseCount(value, key, fileName);
+        } else if (key == "page_count") {
+            checkpoint.runs.pageCount = parseCount(value, key, fileName);
+        } else if (key == "run_starts") {
+            std::istringstream starts(value);
+            std::string start;
+            while (starts >> start) {
+                checkpoint.runs.runStarts.push_back(
+                    parseCount(start, key, fileName)
+                );
+            }
+        } else if (key == "work_file") {
+            checkpoint.workFiles.push_back(value);
+        } else if (key == "run_file") {
+            checkpoint.runFile = value;
+        } else {
+            THROW_FORMATTED(
+                std::runtime_error,
+                "Checkpoint {} has an unknown field '{}'",
+                fileName,
+                key
+            );
+        }
+    }
+
+    if (checkpoint.runFile.empty() || checkpoint.runs.runStarts.empty()) {
+        THROW_FORMATTED(
+            std::runtime_error, "Checkpoint {} is incomplete", fileName
+        );
+    }
+    return checkpoint;
+}
@@ -0,0 +1,46 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "page_format.hpp"
+#include "record_order.hpp"
+#include "sorter.hpp"
+
+// Sidecar file with the progress of the sort of `fileName`
+std::string checkpointPath(const std::string& fileName);
+
+// Progress of a sort as of the last completed stage, written after run
+// generation and after every merge phase. The runs it names are complete and
+// are not written again by the phase after it, so a sort that is killed in
+// that phase can pick up from here.
+struct Checkpoint {
+    size_t recordWidth = 0;
+    size_t recordsPerPage = 0;
+    PageFormat pageFormat = PageFormat::FIXED;
+    PageFormat runFormat = PageFormat::FIXED;
+    RecordOrder order;
+    // Runs written by run generation and merge phases completed so far
+    size_t runCount = 0;
+    size_t phaseCount = 0;
+    // The file holding the runs, either the sorted file or one of the
+    // temporary files
+    std::string runFile;
+    RunLayout runs;
+    // Every temporary file of the sort, so the ones that do not hold the
+    // runs can be removed on resume
+    std::vector<std::string> workFiles;
+
+    // The checkpoint is written next to its final name and renamed over it,
+    // so a crash leaves either the old or the new one. Throws
+    // std::runtime_error if it can not be written.
+    void save(const std::string& fileName) const;
+    // std::nullopt if there is no checkpoint, throws std::runtime_error if
+    // it can not be read
+    static std::optional<Checkpoint> load(const std::string& fileName);
+};
+
+#endif  // !CHECKPOINT_HPP
@@ -37,6 +37,24 @@ void CreateOptions::handleFlag(
         numbersOnly = true;
     } else if ((flag == "-f") || (flag == "--file")) {
         parseFileName(i, argc, argv);
+    } else if ((flag == "-w") || (flag == "--record-width")) {
+        parseRecordWidth(i, argc, argv);
+    } else if (flag == "--page-format") {
+        parsePageFormat(i, argc, argv);
+    } else if ((flag == "-b") || (flag == "--blocking-factor")) {
+        parseBlockingFactor(i, argc, argv);
+    } else if ((flag == "-s") || (flag == "--seed")) {
+        parseSeed(i, argc, argv);
+    } else if ((flag == "-t") || (flag == "--threads")) {
+        parseThreadCount(i, argc, argv);
+    } else if ((flag == "-d") || (flag == "--distribution")) {
+        parseDistribution(i, argc, argv);
+    } else if (flag == "--perturb") {
+        parsePerturbPercent(i, argc, argv);
+    } else if (flag == "--distinct") {
+        parseDistinctCount(i, argc, argv);
+    } else if (flag == "--skew") {
+        parseZipfSkew(i, argc, argv);
     } else if ((flag == "-i") || (flag == "--interactive")) {
         interactiveMode = true;
     } else {
@@ -68,6 +86,105 @@ void CreateOptions::parseRandomCount(int& i, int argc, char** argv) {
     }
 }
 
+void CreateOptions::parseRecordWidth(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    try {
+        recordWidth = std::stoul(val);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+}
+
+void CreateOptions::parseSeed(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    try {
+        seed = std::stoull(val);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+}
+
+void CreateOptions::parsePageFormat(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    auto parsed = ::parsePageFormat(val);
+    if (!parsed.has_value()) {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+    pageFormat = *parsed;
+}
+
+void CreateOptions::parseBlockingFactor(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    try {
+        blockingFactor = std::stoul(val);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+}
+
+void CreateOptions::parseThreadCount(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    try {
+        threadCount = std::stoul(val);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+}
+
+void CreateOptions::parseDistribution(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    auto parsed = ::parseDistribution(val);
+    if (!parsed.has_value()) {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+    distribution = *parsed;
+}
+
+void CreateOptions::parsePerturbPercent(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    try {
+        perturbPercent = std::stod(val);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+}
+
+void CreateOptions::parseDistinctCount(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    try {
+        distinctCount = std::stoul(val);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+}
+
+void CreateOptions::parseZipfSkew(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    try {
+        zipfSkew = std::stod(val);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+}
+
 void CreateOptions::checkConstraints() const {
     if (interactiveMode && randomMode) {
         std::cerr << "Error: -i (--interactive) and -r (--random) flags are "
@@ -89,6 +206,48 @@ void CreateOptions::checkConstraints() const {
                   << std::endl;
         printHelpAndExit();
     }
+
+    if (seed.has_value() && !randomMode) {
+        std::cerr << "Error: -s (--seed) can only be used with -r "
+                     "(--random)."
+                  << std::endl;
+        printHelpAndExit();
+    }
+
+    if (distribution != Distribution::UNIFORM && !randomMode) {
+        std::cerr << "Error: -d (--distribution) can only be used with -r "
+                     "(--random)."
+                  << std::endl;
+        printHelpAndExit();
+    }
+
+    if (perturbPercent < 0 || perturbPercent > 100) {
+        std::cerr << "Error: --perturb must be a percentage in [0, 100]."
+                  << std::endl;
+        printHelpAndExit();
+    }
+
+    if (distinctCount == 0) {
+        std::cerr << "Error: --distinct must be at least 1." << std::endl;
+        printHelpAndExit();
+    }
+
+    if (threadCount == 0) {
+        std::cerr << "Error: -t (--threads) must be at least 1." << std::endl;
+        printHelpAndExit();
+    }
+
+    if (blockingFactor == 0) {
+        std::cerr << "Error: -b (--blocking-factor) must be at least 1."
+                  << std::endl;
+        printHelpAndExit();
+    }
+
+    if (!isSupportedRecordWidth(recordWidth)) {
+        std::cerr << "Error: Unsupported record width " << recordWidth
+                  << std::endl;
+        printHelpAndExit();
+    }
 }
 
 void CreateOptions::printHelpAndExit(int exitCode) const {
@@ -102,6 +261,28 @@ void CreateOptions::printHelpAndExit(int exitCode) const {
         "\t\tGenerate only numbers (only with -r).\n\n"
         "\t-f, --file <filename>\n"
         "\t\tSet output file (default: data/data.bin).\n\n"
+        "\t-w, --record-width <bytes>\n"
+        "\t\tSet record width (16, 30 or 64, default: 30).\n\n"
+        "\t--page-format <fixed|variable>\n"
+        "\t\tWrite plain records or slotted pages of length prefixed\n"
+        "\t\trecords (default: fixed).\n\n"
+        "\t-b, --blocking-factor <value>\n"
+        "\t\tRecords per page of the variable format, must match the\n"
+        "\t\tone used to sort the file (default: 10).\n\n"
+        "\t-s, --seed <value>\n"
+        "\t\tSeed the generator for a reproducible file (only with -r).\n\n"
+        "\t-d, --distribution <name>\n"
+        "\t\tShape of the generated data (only with -r), one of:\n"
+        "\t\tuniform (default), sorted, reverse, nearly-sorted,\n"
+        "\t\tduplicates, zipf, prefix, fixed.\n\n"
+        "\t--perturb <percent>\n"
+        "\t\tShare of random records in nearly-sorted (default: 5).\n\n"
+        "\t--distinct <count>\n"
+        "\t\tDistinct records in duplicates and zipf (default: 100).\n\n"
+        "\t--skew <value>\n"
+        "\t\tExponent of the zipf distribution (default: 1.0).\n\n"
+        "\t-t, --threads <count>\n"
+        "\t\tNumber of generator threads (default: all cores).\n\n"
         "\t-i, --interactive\n"
         "\t\tEnter interactive mode to write records.\n";
     // clang-format on
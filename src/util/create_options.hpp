@@ -1,8 +1,16 @@
 #ifndef CREATE_OPTIONS_HPP
 #define CREATE_OPTIONS_HPP
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <optional>
 #include <string>
+#include <thread>
+
+#include "generator.hpp"
+#include "page_format.hpp"
+#include "record.hpp"
 
 class CreateOptions {
    public:
@@ -12,6 +20,15 @@ class CreateOptions {
     size_t getRandomCount() const { return randomCount; }
     bool isNumbersOnly() const { return numbersOnly; }
     bool isInteractiveMode() const { return interactiveMode; }
+    size_t getRecordWidth() const { return recordWidth; }
+    PageFormat getPageFormat() const { return pageFormat; }
+    size_t getBlockingFactor() const { return blockingFactor; }
+    const std::optional<uint64_t>& getSeed() const { return seed; }
+    size_t getThreadCount() const { return threadCount; }
+    Distribution getDistribution() const { return distribution; }
+    double getPerturbPercent() const { return perturbPercent; }
+    size_t getDistinctCount() const { return distinctCount; }
+    double getZipfSkew() const { return zipfSkew; }
     const std::string& getFileName() const { return fileName; }
 
    private:
@@ -31,6 +48,15 @@ class CreateOptions {
 
     void parseRandomCount(int& i, int argc, char** argv);
     void parseFileName(int& i, int argc, char** argv);
+    void parseRecordWidth(int& i, int argc, char** argv);
+    void parsePageFormat(int& i, int argc, char** argv);
+    void parseBlockingFactor(int& i, int argc, char** argv);
+    void parseSeed(int& i, int argc, char** argv);
+    void parseThreadCount(int& i, int argc, char** argv);
+    void parseDistribution(int& i, int argc, char** argv);
+    void parsePerturbPercent(int& i, int argc, char** argv);
+    void parseDistinctCount(int& i, int argc, char** argv);
+    void parseZipfSkew(int& i, int argc, char** argv);
 
     void checkConstraints() const;
     void printHelpAndExit(int exitCode = 1) const;
@@ -39,6 +65,16 @@ class CreateOptions {
     size_t randomCount = 0;
     bool numbersOnly = false;
     bool interactiveMode = false;
+    size_t recordWidth = Record::maxLen;
+    PageFormat pageFormat = PageFormat::FIXED;
+    // Records per page, only matters for PageFormat::VARIABLE
+    size_t blockingFactor = 10;
+    std::optional<uint64_t> seed;
+    size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+    Distribution distribution = Distribution::UNIFORM;
+    double perturbPercent = 5.0;
+    size_t distinctCount = 100;
+    double zipfSkew = 1.0;
     std::string fileName = "data/data.bin";
     std::string scriptName;
 };
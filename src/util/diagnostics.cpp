@@ -0,0 +1,67 @@
+#include "diagnostics.hpp"
+
+#include <format>
+#include <ostream>
+
+uint64_t hashRecord(std::string_view data) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+template <size_t RecordLen>
+RunSummary<RecordLen>::RunSummary(size_t sampleSize) : sampleSize(sampleSize) {
+    sample.reserve(sampleSize);
+}
+
+template <size_t RecordLen>
+void RunSummary<RecordLen>::add(const Record& r) {
+    if (count == 0 || r < min) {
+        min = r;
+    }
+    if (count == 0 || r > max) {
+        max = r;
+    }
+    checksum += hashRecord(r.data());
+
+    if (sampleSize != 0 && count % sampleStride == 0) {
+        if (sample.size() == sampleSize) {
+            // Keep the samples at even multiples of the old stride
+            std::erase_if(sample, [&](const auto& s) {
+                return s.first % (2 * sampleStride) != 0;
+            });
+            sampleStride *= 2;
+        }
+        if (count % sampleStride == 0) {
+            sample.emplace_back(count, r);
+        }
+    }
+    count++;
+}
+
+template <size_t RecordLen>
+void RunSummary<RecordLen>::print(std::ostream& os, std::string_view label)
+    const {
+    if (count == 0) {
+        os << std::format("{}: empty\n", label);
+        return;
+    }
+    os << std::format(
+        "{}: count={} min=\"{}\" max=\"{}\" checksum={:016x}\n",
+        label,
+        count,
+        min.str(),
+        max.str(),
+        checksum
+    );
+    for (const auto& [index, r] : sample) {
+        os << std::format("    {}. {}\n", index, r.str());
+    }
+}
+
+#define INSTANTIATE_RUN_SUMMARY(W) template class RunSummary<W>;
+FOR_EACH_RECORD_WIDTH(INSTANTIATE_RUN_SUMMARY)
+#undef INSTANTIATE_RUN_SUMMARY
@@ -0,0 +1,54 @@
+#ifndef DIAGNOSTICS_HPP
+#define DIAGNOSTICS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string_view>
+#include <vector>
+
+#include "record.hpp"
+
+// 64 bit FNV-1a of all bytes of a record, padding included
+uint64_t hashRecord(std::string_view data);
+
+// Constant size description of a run, filled one record at a time while the
+// run is written, so logging never has to read the file back.
+//
+// The checksum is the sum of the record hashes. It does not depend on the
+// order of the records, so every phase of a sort must end with the same one.
+template <size_t RecordLen>
+class RunSummary {
+   public:
+    using Record = BasicRecord<RecordLen>;
+
+    // Keeps at most sampleSize evenly spaced records, 0 keeps none
+    RunSummary(size_t sampleSize = 0);
+
+    void add(const Record& r);
+
+    size_t getCount() const { return count; }
+    uint64_t getChecksum() const { return checksum; }
+
+    // One line with the count, min, max and checksum, followed by one line
+    // per sampled record
+    void print(std::ostream& os, std::string_view label) const;
+
+   private:
+    size_t sampleSize;
+    size_t count = 0;
+    uint64_t checksum = 0;
+    Record min;
+    Record max;
+
+    // Every sampleStride-th record is sampled. When the sample is full every
+    // second one is dropped and the stride doubles.
+    size_t sampleStride = 1;
+    std::vector<std::pair<size_t, Record>> sample;
+};
+
+#define DECLARE_RUN_SUMMARY(W) extern template class RunSummary<W>;
+FOR_EACH_RECORD_WIDTH(DECLARE_RUN_SUMMARY)
+#undef DECLARE_RUN_SUMMARY
+
+#endif  // !DIAGNOSTICS_HPP
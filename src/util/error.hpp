@@ -5,6 +5,7 @@
 #include <format>
 #include <source_location>
 #include <type_traits>
+#include <utility>
 
 // Wierd macro hacking to bypass the warnings that forbids the use of
 // ##__VA_ARGS__ to remove the preceding coma when __VA_ARGS__ is empty -_-
@@ -12,12 +13,17 @@
 // NOTE: THROW_FORMATTED is the only function you should use from this file
 // Arg. 1 is the ErrorType (Must derive from std::exception)
 // Arg. 2 is the string to be formated with std::format
-// Args. 3... are the values that will be inserted into Arg.2
-#define THROW_FORMATTED(...)                                                                 \
-    THROW_FORMATTED_SELECT(__VA_ARGS__, THROW_FORMATTED_WITH_ARGS, THROW_FORMATTED_NO_ARGS)( \
-        __VA_ARGS__                                                                          \
-    )
-#define THROW_FORMATTED_SELECT(_1, _2, _3, NAME, ...) NAME
+// Args. 3... are the values that will be inserted into Arg.2 (at most 4)
+#define THROW_FORMATTED(...)                \
+    THROW_FORMATTED_SELECT(                 \
+        __VA_ARGS__,                        \
+        THROW_FORMATTED_WITH_ARGS,          \
+        THROW_FORMATTED_WITH_ARGS,          \
+        THROW_FORMATTED_WITH_ARGS,          \
+        THROW_FORMATTED_WITH_ARGS,          \
+        THROW_FORMATTED_NO_ARGS             \
+    )(__VA_ARGS__)
+#define THROW_FORMATTED_SELECT(_1, _2, _3, _4, _5, _6, NAME, ...) NAME
 
 #define THROW_FORMATTED_WITH_ARGS(ErrorType, fmt, ...) \
     _throw_formatted<ErrorType>(                       \
@@ -39,7 +45,7 @@ template <typename ErrorType, typename... Args>
         "Passed ErrorType does not derive from std::exception."
     );
 
-    auto msg = std::format(fmt, args...);
+    auto msg = std::format(fmt, std::forward<Args>(args)...);
     msg = std::format(
         "\n{}:{}:\nFunction: {}\n{}",
         sl.file_name(),
@@ -0,0 +1,284 @@
+#include "external_sorter.hpp"
+
+#include <array>
+#include <format>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+#include "buffer.hpp"
+#include "error.hpp"
+#include "file_buffering.hpp"
+#include "metrics.hpp"
+
+namespace {
+
+// Reads the records of a stream a page at a time
+template <size_t RecordLen>
+class StreamSource {
+   public:
+    using Record = BasicRecord<RecordLen>;
+
+    StreamSource(std::istream& in, StreamFormat format)
+        : in(in), format(format) {}
+
+    // Fills `page` with up to `count` records, returns false once the stream
+    // is exhausted
+    bool next(std::vector<Record>& page, size_t count) {
+        page.clear();
+        while (page.size() < count) {
+            if (format == StreamFormat::LINES) {
+                if (!std::getline(in, line)) {
+                    break;
+                }
+                lineNumber++;
+                if (line.size() > RecordLen) {
+                    THROW_FORMATTED(
+                        std::runtime_error,
+                        "Line {} has {} bytes, a record holds at most {}",
+                        lineNumber,
+                        line.size(),
+                        RecordLen
+                    );
+                }
+                page.emplace_back(std::string_view(line));
+                continue;
+            }
+
+            in.read(bytes.data(), RecordLen);
+            size_t got = in.gcount();
+            if (got == 0) {
+                break;
+            }
+            if (got != RecordLen) {
+                THROW_FORMATTED(
+                    std::runtime_error,
+                    "The input ends within a record, after {} of {} bytes",
+                    got,
+                    RecordLen
+                );
+            }
+            page.emplace_back(std::string_view(bytes.data(), RecordLen));
+        }
+        return !page.empty();
+    }
+
+   private:
+    std::istream& in;
+    StreamFormat format;
+    std::string line;
+    size_t lineNumber = 0;
+    std::array<char, RecordLen> bytes{};
+};
+
+// Writes merged records to a stream, the output of a MergeOutput
+template <size_t RecordLen>
+class StreamSink {
+   public:
+    using Record = BasicRecord<RecordLen>;
+
+    StreamSink(std::ostream& out, StreamFormat format)
+        : out(out), format(format) {}
+
+    void append(const Record& r) {
+        if (format == StreamFormat::LINES) {
+            auto str = r.str();
+            out.write(str.data(), str.size());
+            out.put('\n');
+        } else {
+            out.write(r.data().data(), RecordLen);
+        }
+    }
+
+   private:
+    std::ostream& out;
+    StreamFormat format;
+};
+
+}  // namespace
+
+template <size_t RecordLen>
+BasicExternalSorter<RecordLen>::BasicExternalSorter(
+    ExternalSorterOptions options
+)
+    : options(std::move(options)) {
+    const auto& o = this->options;
+    size_t pageBytes = o.recordsPerPage * RecordLen;
+    size_t minPages = o.pipelined ? 9 : 3;
+    if (pageBytes == 0 || o.memoryBudget / pageBytes < minPages) {
+        THROW_FORMATTED(
+            std::invalid_argument,
+            "A memory budget of {} bytes must hold at least {} pages of {} "
+            "records of width {}",
+            o.memoryBudget,
+            minPages,
+            o.recordsPerPage,
+            RecordLen
+        );
+    }
+    if (o.dedup == DedupMode::COUNT) {
+        THROW_FORMATTED(
+            std::invalid_argument,
+            "Counting duplicates needs a sorted file to write the counts to"
+        );
+    }
+}
+
+template <size_t RecordLen>
+void BasicExternalSorter<RecordLen>::addFile(
+    const std::string& fileName, PageFormat format, size_t recordsPerPage
+) {
+    struct State {
+        std::unique_ptr<BasicBufferedFile<RecordLen>> file;
+        size_t pageIndex = 0;
+        size_t pageCount = 0;
+    };
+    auto state = std::make_shared<State>();
+    if (recordsPerPage == 0) {
+        recordsPerPage = options.recordsPerPage;
+    }
+
+    inputs.push_back([=](std::vector<Record>& page) {
+        if (!state->file) {
+            state->file = std::make_unique<BasicBufferedFile<RecordLen>>(
+                fileName, recordsPerPage, format, "input"
+            );
+            state->pageCount = state->file->getPageCount();
+        }
+        if (state->pageIndex == state->pageCount) {
+            // NOTE: The file may be the output of the sort
+            state->file.reset();
+            return false;
+        }
+        page = state->file->readPage(state->pageIndex++);
+        // NOTE: Only the last page is padded
+        if (format == PageFormat::FIXED &&
+            state->pageIndex == state->pageCount) {
+            while (!page.empty() && page.back() == Record::empty) {
+                page.pop_back();
+            }
+        }
+        return true;
+    });
+}
+
+template <size_t RecordLen>
+void BasicExternalSorter<RecordLen>::addStream(
+    std::istream& in, StreamFormat format
+) {
+    auto source = std::make_shared<StreamSource<RecordLen>>(in, format);
+    size_t count = options.recordsPerPage;
+    inputs.push_back([=](std::vector<Record>& page) {
+        return source->next(page, count);
+    });
+}
+
+template <size_t RecordLen>
+void BasicExternalSorter<RecordLen>::addProducer(Producer producer) {
+    size_t count = options.recordsPerPage;
+    inputs.push_back([=](std::vector<Record>& page) {
+        page.clear();
+        Record r;
+        while (page.size() < count && producer(r)) {
+            page.push_back(r);
+        }
+        return !page.empty();
+    });
+}
+
+template <size_t RecordLen>
+void BasicExternalSorter<RecordLen>::setProgressCallback(
+    ProgressCallback callback
+) {
+    progress = std::move(callback);
+}
+
+template <size_t RecordLen>
+SortConfig BasicExternalSorter<RecordLen>::getSortConfig() const {
+    // NOTE: A pipeline holds a run for each of its three stages
+    size_t pageCount =
+        options.memoryBudget / (options.recordsPerPage * RecordLen);
+    return SortConfig{
+        .bufferCount = options.pipelined ? pageCount / 3 : pageCount,
+        .blockingFactor = options.recordsPerPage,
+        .recordWidth = RecordLen,
+        .threadCount = options.threadCount,
+        .pipelined = options.pipelined,
+        .logging = false,
+        .runFormat = options.runFormat,
+        .order = options.order,
+        .dedup = options.dedup,
+        .limit = options.limit,
+        .releaseConsumed = options.releaseConsumed,
+    };
+}
+
+template <size_t RecordLen>
+SortStats BasicExternalSorter<RecordLen>::sort(const Consumer& consumer) {
+    if (!options.tempDirectories.empty()) {
+        setTempDirectories(options.tempDirectories, options.tempPlacement);
+    }
+    Metrics::instance().reset();
+
+    // The next sort starts without inputs, even if this one fails
+    auto sources = std::move(inputs);
+    inputs.clear();
+
+    // NOTE: An input may give pages with nothing but padding, while run
+    // generation stops at the first empty page
+    size_t current = 0;
+    PageSource<RecordLen> source = [&](std::vector<Record>& page) {
+        while (current < sources.size()) {
+            if (!sources[current](page)) {
+                current++;
+            } else if (!page.empty()) {
+                return true;
+            }
+        }
+        return false;
+    };
+    return sortRecords<RecordLen>(
+        source, consumer, options.recordsPerPage, getSortConfig(), progress
+    );
+}
+
+template <size_t RecordLen>
+SortStats BasicExternalSorter<RecordLen>::sort(
+    std::ostream& out, StreamFormat format
+) {
+    StreamSink<RecordLen> sink(out, format);
+    SortStats stats = sort([&](const Record& r) { sink.append(r); });
+    out.flush();
+    if (!out) {
+        THROW_FORMATTED(
+            std::runtime_error, "Writing the sorted records failed"
+        );
+    }
+    return stats;
+}
+
+template <size_t RecordLen>
+SortStats BasicExternalSorter<RecordLen>::sortTo(
+    const std::string& fileName, PageFormat format
+) {
+    BasicBufferedFile<RecordLen> out(
+        fileName, options.recordsPerPage, format, "output"
+    );
+    SortStats stats;
+    size_t pageCount = 0;
+    {
+        BasicBuffer<RecordLen> buffer(out.pages());
+        stats = sort([&](const Record& r) { buffer.append(r); });
+        pageCount = buffer.pageCount();
+    }
+    // Pages of the old content past the sorted records
+    out.truncate(pageCount);
+    return stats;
+}
+
+#define INSTANTIATE_EXTERNAL_SORTER(W) template class BasicExternalSorter<W>;
+FOR_EACH_RECORD_WIDTH(INSTANTIATE_EXTERNAL_SORTER)
+#undef INSTANTIATE_EXTERNAL_SORTER
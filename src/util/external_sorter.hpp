@@ -0,0 +1,132 @@
+#ifndef EXTERNAL_SORTER_HPP
+#define EXTERNAL_SORTER_HPP
+
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "page_format.hpp"
+#include "record.hpp"
+#include "record_order.hpp"
+#include "sort_config.hpp"
+#include "sorter.hpp"
+#include "temp_file.hpp"
+
+// How records are laid out in a stream
+enum class StreamFormat {
+    // Every record takes the full record width, like a fixed format file
+    BINARY,
+    // One record per line, without its padding
+    LINES,
+};
+
+struct ExternalSorterOptions {
+    // Bytes of records held in memory, as pages of recordsPerPage records.
+    // It must hold at least three pages, every page more merges one more run
+    // at a time.
+    size_t memoryBudget = 64 << 20;
+    size_t recordsPerPage = 256;
+    // Threads sorting the pages of a run
+    size_t threadCount = 1;
+    // Reads, sorts and writes runs at the same time, see
+    // SortConfig::pipelined. The memory budget is split between the three
+    // runs in flight, so it must hold at least nine pages and every sort
+    // merges a third as many runs at a time.
+    bool pipelined = false;
+    // Directories of the temporary files, "temp" when empty. They are set for
+    // the whole process once a sort starts, see setTempDirectories.
+    std::vector<std::filesystem::path> tempDirectories;
+    TempPlacement tempPlacement = TempPlacement::ROUND_ROBIN;
+    // Format of the runs in temporary files, PageFormat::PREFIX when not
+    // set. Runs end within a page, so PageFormat::FIXED is rejected.
+    std::optional<PageFormat> runFormat;
+    // The order of the sorted records, the policy for it is chosen once per
+    // sort
+    RecordOrder order;
+    // DedupMode::COUNT writes its counts next to a sorted file, so it is
+    // only available through sortFile
+    DedupMode dedup = DedupMode::NONE;
+    std::optional<size_t> limit;
+    // See SortConfig::releaseConsumed
+    bool releaseConsumed = false;
+};
+
+// Sorts the records of any number of files, streams and callbacks into a
+// callback, a stream or a file, for programs that embed the sort instead of
+// running sort_files. Nothing is logged. A sort takes every input added since
+// the one before it, which it reads through once, and keeps at most the
+// memory budget of records in memory.
+//
+// Every sort starts by resetting the process wide Metrics, so a long running
+// process does not pile up their phases. Sorters may run on several threads
+// at once, but then share the temporary directories and mix their metrics.
+//
+//     BasicExternalSorter<30> sorter({.memoryBudget = 256 << 20});
+//     sorter.addFile("a.bin");
+//     sorter.addProducer([&](auto& r) { return nextRecord(r); });
+//     sorter.sort([&](const auto& r) { consume(r); });
+template <size_t RecordLen>
+class BasicExternalSorter {
+   public:
+    using Record = BasicRecord<RecordLen>;
+    // Sets the next record of an input, returns false once there is none
+    using Producer = std::function<bool(Record&)>;
+    using Consumer = RecordSink<RecordLen>;
+
+    // Throws std::invalid_argument if the memory budget holds less than three
+    // pages, nine when pipelined, or the options ask for DedupMode::COUNT
+    explicit BasicExternalSorter(ExternalSorterOptions options);
+
+    // A file of pages of `recordsPerPage` records, the records per page of
+    // the options if 0. It is opened once the sort starts. The records made
+    // only of '\0' that end the last page of a fixed format file are its
+    // padding and are skipped, empty records anywhere else are kept.
+    void addFile(
+        const std::string& fileName,
+        PageFormat format = PageFormat::FIXED,
+        size_t recordsPerPage = 0
+    );
+    // `in` must outlive the sort, which throws std::runtime_error if it ends
+    // within a record or holds a line longer than a record. When pipelined
+    // it is read on a thread of the sort, as are producers.
+    void addStream(
+        std::istream& in, StreamFormat format = StreamFormat::BINARY
+    );
+    void addProducer(Producer producer);
+    // Called after run generation and after every merge phase
+    void setProgressCallback(ProgressCallback callback);
+
+    // Hands every record of the inputs to `consumer` in order
+    SortStats sort(const Consumer& consumer);
+    // Writes every record of the inputs to `out`, throws std::runtime_error
+    // if that fails
+    SortStats sort(
+        std::ostream& out, StreamFormat format = StreamFormat::BINARY
+    );
+    // Replaces the content of `fileName` with every record of the inputs in
+    // pages of the records per page of the options. The file may be one of
+    // the inputs.
+    SortStats sortTo(
+        const std::string& fileName, PageFormat format = PageFormat::FIXED
+    );
+
+    SortConfig getSortConfig() const;
+
+   private:
+    ExternalSorterOptions options;
+    std::vector<PageSource<RecordLen>> inputs;
+    ProgressCallback progress;
+};
+
+#define DECLARE_EXTERNAL_SORTER(W) \
+    extern template class BasicExternalSorter<W>;
+FOR_EACH_RECORD_WIDTH(DECLARE_EXTERNAL_SORTER)
+#undef DECLARE_EXTERNAL_SORTER
+
+using ExternalSorter = BasicExternalSorter<Record::maxLen>;
+
+#endif  // !EXTERNAL_SORTER_HPP
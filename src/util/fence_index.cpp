@@ -0,0 +1,188 @@
+#include "fence_index.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "error.hpp"
+
+// Layout of an index file, all integers are 64 bit in host byte order:
+// magic, version, record width, records per page, page format, stride,
+// page count, fence count, then every fence as its page index followed by the
+// record width bytes of its first record.
+static constexpr std::array<char, 8> magic = {
+    'F', 'E', 'N', 'C', 'E', 'I', 'D', 'X'
+};
+static constexpr uint64_t version = 1;
+
+std::string fenceIndexPath(const std::string& fileName) {
+    return fileName + ".idx";
+}
+
+static void writeU64(std::ofstream& out, uint64_t value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static uint64_t readU64(std::ifstream& in, const std::string& fileName) {
+    uint64_t value = 0;
+    if (!in.read(reinterpret_cast<char*>(&value), sizeof(value))) {
+        THROW_FORMATTED(
+            std::runtime_error, "Index {} ends unexpectedly", fileName
+        );
+    }
+    return value;
+}
+
+// Opens an index and checks its magic and version
+static std::ifstream openIndex(const std::string& fileName) {
+    std::ifstream in(fileName, std::ios::binary);
+    if (!in.is_open()) {
+        THROW_FORMATTED(std::runtime_error, "Could not open index {}", fileName);
+    }
+
+    std::array<char, magic.size()> header{};
+    in.read(header.data(), header.size());
+    if (!in || header != magic) {
+        THROW_FORMATTED(
+            std::runtime_error, "{} is not a fence index", fileName
+        );
+    }
+    uint64_t fileVersion = readU64(in, fileName);
+    if (fileVersion != version) {
+        THROW_FORMATTED(
+            std::runtime_error,
+            "Index {} has version {}, only {} is supported",
+            fileName,
+            fileVersion,
+            version
+        );
+    }
+    return in;
+}
+
+size_t readFenceIndexRecordWidth(const std::string& fileName) {
+    std::ifstream in = openIndex(fileName);
+    return readU64(in, fileName);
+}
+
+template <size_t RecordLen>
+BasicFenceIndex<RecordLen>::BasicFenceIndex(size_t stride)
+    : stride(std::max<size_t>(stride, 1)) {}
+
+template <size_t RecordLen>
+void BasicFenceIndex<RecordLen>::addPage(
+    size_t pageIndex, const Record& firstRecord
+) {
+    if (pageIndex % stride == 0) {
+        fences.push_back({pageIndex, firstRecord});
+    }
+    pageCount = std::max(pageCount, pageIndex + 1);
+}
+
+template <size_t RecordLen>
+void BasicFenceIndex<RecordLen>::clear() {
+    fences.clear();
+    pageCount = 0;
+}
+
+template <size_t RecordLen>
+std::pair<size_t, size_t> BasicFenceIndex<RecordLen>::pagesFor(
+    const Record& low, const Record& high
+) const {
+    // NOTE: Starting at the last fence strictly below `low` would cover
+    // records equal to it that end earlier pages too, but read a whole extra
+    // stride whenever a fence starts with `low`. The caller reads only the
+    // pages that spill instead.
+    auto pastLow = std::ranges::upper_bound(
+        fences, low, {}, &Fence::firstRecord
+    );
+    size_t first =
+        pastLow == fences.begin() ? 0 : std::prev(pastLow)->pageIndex;
+
+    auto pastHigh = std::ranges::upper_bound(
+        fences, high, {}, &Fence::firstRecord
+    );
+    size_t last = pastHigh == fences.end() ? pageCount : pastHigh->pageIndex;
+    return {first, std::max(first, last)};
+}
+
+template <size_t RecordLen>
+void BasicFenceIndex<RecordLen>::save(
+    const std::string& fileName, size_t recordsPerPage, PageFormat format
+) const {
+    std::ofstream out(fileName, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        THROW_FORMATTED(
+            std::runtime_error, "Could not open {} for writing", fileName
+        );
+    }
+
+    out.write(magic.data(), magic.size());
+    writeU64(out, version);
+    writeU64(out, RecordLen);
+    writeU64(out, recordsPerPage);
+    writeU64(out, static_cast<uint64_t>(format));
+    writeU64(out, stride);
+    writeU64(out, pageCount);
+    writeU64(out, fences.size());
+    for (const auto& fence : fences) {
+        writeU64(out, fence.pageIndex);
+        out.write(fence.firstRecord.data().data(), RecordLen);
+    }
+
+    if (!out) {
+        THROW_FORMATTED(std::runtime_error, "Writing {} failed", fileName);
+    }
+}
+
+template <size_t RecordLen>
+auto BasicFenceIndex<RecordLen>::load(const std::string& fileName) -> Loaded {
+    std::ifstream in = openIndex(fileName);
+
+    uint64_t width = readU64(in, fileName);
+    if (width != RecordLen) {
+        THROW_FORMATTED(
+            std::runtime_error,
+            "Index {} is for records of width {}, not {}",
+            fileName,
+            width,
+            RecordLen
+        );
+    }
+    size_t recordsPerPage = readU64(in, fileName);
+    uint64_t format = readU64(in, fileName);
+    if (format > static_cast<uint64_t>(PageFormat::PREFIX)) {
+        THROW_FORMATTED(
+            std::runtime_error, "Index {} has an unknown page format", fileName
+        );
+    }
+
+    Loaded loaded{
+        .index = BasicFenceIndex(readU64(in, fileName)),
+        .recordsPerPage = recordsPerPage,
+        .format = static_cast<PageFormat>(format),
+    };
+    loaded.index.pageCount = readU64(in, fileName);
+    size_t fenceCount = readU64(in, fileName);
+
+    std::array<char, RecordLen> record{};
+    for (size_t i = 0; i < fenceCount; i++) {
+        size_t pageIndex = readU64(in, fileName);
+        if (!in.read(record.data(), RecordLen)) {
+            THROW_FORMATTED(
+                std::runtime_error, "Index {} ends unexpectedly", fileName
+            );
+        }
+        loaded.index.fences.push_back(
+            {pageIndex, Record(std::string_view(record.data(), RecordLen))}
+        );
+    }
+    return loaded;
+}
+
+#define INSTANTIATE_FENCE_INDEX(W) template class BasicFenceIndex<W>;
+FOR_EACH_RECORD_WIDTH(INSTANTIATE_FENCE_INDEX)
+#undef INSTANTIATE_FENCE_INDEX
@@ -0,0 +1,77 @@
+#ifndef FENCE_INDEX_HPP
+#define FENCE_INDEX_HPP
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "page_format.hpp"
+#include "record.hpp"
+
+// Sidecar file of the sparse index of `fileName`
+std::string fenceIndexPath(const std::string& fileName);
+
+// Sparse index of a sorted file, the first record of every stride-th page.
+// The output buffer of the phase that writes the sorted file fills it as it
+// writes the pages, so building it takes no extra pass.
+template <size_t RecordLen>
+class BasicFenceIndex {
+   public:
+    using Record = BasicRecord<RecordLen>;
+
+    struct Fence {
+        size_t pageIndex;
+        Record firstRecord;
+    };
+
+    BasicFenceIndex(size_t stride = 1);
+
+    // Called for every page in the order they are written
+    void addPage(size_t pageIndex, const Record& firstRecord);
+    void clear();
+
+    size_t getStride() const { return stride; }
+    // Number of pages of the indexed file
+    size_t getPageCount() const { return pageCount; }
+    const std::vector<Fence>& getFences() const { return fences; }
+
+    // Pages [first, last) that hold every record r with low <= r <= high,
+    // from the last fence not above `low` to the first fence above `high`.
+    // If page `first` starts with `low`, records equal to it may also end
+    // the pages before it, back to the first one that starts below `low`.
+    // All other pages may be skipped, so a point query reads at most stride
+    // pages plus the ones its key spills over.
+    std::pair<size_t, size_t> pagesFor(const Record& low, const Record& high)
+        const;
+
+    // The page layout is stored along with the fences so a reader can open
+    // the indexed file without being told how it was written. Both throw
+    // std::runtime_error when the file can not be written or read.
+    void save(
+        const std::string& fileName, size_t recordsPerPage, PageFormat format
+    ) const;
+    struct Loaded;
+    static Loaded load(const std::string& fileName);
+
+   private:
+    size_t stride;
+    size_t pageCount = 0;
+    std::vector<Fence> fences;
+};
+
+template <size_t RecordLen>
+struct BasicFenceIndex<RecordLen>::Loaded {
+    BasicFenceIndex index;
+    size_t recordsPerPage;
+    PageFormat format;
+};
+
+// Record width stored in an index file, to pick the width to load it with
+size_t readFenceIndexRecordWidth(const std::string& fileName);
+
+#define DECLARE_FENCE_INDEX(W) extern template class BasicFenceIndex<W>;
+FOR_EACH_RECORD_WIDTH(DECLARE_FENCE_INDEX)
+#undef DECLARE_FENCE_INDEX
+
+#endif  // !FENCE_INDEX_HPP
@@ -1,17 +1,21 @@
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <algorithm>
+#include <cerrno>
+#include <chrono>
 #include <cmath>
-#include <compare>
 #include <cstddef>
+#include <cstring>
 #include <error.hpp>
 #include <file_buffering.hpp>
 #include <format>
-#include <fstream>
-#include <ios>
-#include <iosfwd>
+#include <iomanip>
 #include <iostream>
-#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <trace.hpp>
 
 #include "record.hpp"
 
@@ -19,34 +23,49 @@
 // BufferedFile
 // ============================================================================
 
-size_t BufferedFile::readCout = 0;
-size_t BufferedFile::writeCount = 0;
-
-size_t BufferedFile::recordsPerPage = 0;
-size_t BufferedFile::pageSize = 0;
-std::once_flag BufferedFile::setRecordsPerPageFlag;
-
-void BufferedFile::setRecordsPerPage(size_t recordsPerPage) {
-    std::call_once(setRecordsPerPageFlag, [&]() {
-        BufferedFile::recordsPerPage = recordsPerPage;
-        BufferedFile::pageSize = recordsPerPage * recordSize;
-    });
-}
-
-BufferedFile::BufferedFile(const std::string fileName)
-    : file(fileName, std::ios::in | std::ios::out) {
+template <size_t RecordLen>
+BasicBufferedFile<RecordLen>::BasicBufferedFile(
+    const std::string fileName,
+    size_t recordsPerPage,
+    PageFormat format,
+    const std::string& role
+)
+    : fileName(fileName),
+      recordsPerPage(recordsPerPage),
+      pageSize(recordsPerPage * recordSize),
+      codec(format, pageSize),
+      metrics(Metrics::instance().registerFile(fileName, role)),
+      pageBytes(pageSize) {
+    if (recordsPerPage == 0) {
+        THROW_FORMATTED(
+            std::invalid_argument,
+            "Opening {} failed. A page must hold at least one record",
+            fileName
+        );
+    }
     // If file does not exist create it
-    if (!file.is_open()) {
-        file.open(fileName, std::ios::out);
-        file.close();
-        file.open(fileName, std::ios::out | std::ios::in);
+    fd = ::open(fileName.c_str(), O_RDWR | O_CREAT, 0644);
+    metrics->recordSyscalls(1);
+    if (fd < 0) {
+        std::string reason = std::strerror(errno);
+        THROW_FORMATTED(
+            std::runtime_error, "Opening {} failed: {}", fileName, reason
+        );
     }
+    measureDiskUsage();
     loadPage(0);
 };
 
-BufferedFile::~BufferedFile() { flush(); }
+template <size_t RecordLen>
+BasicBufferedFile<RecordLen>::~BasicBufferedFile() {
+    flush();
+    ::close(fd);
+    Metrics::instance().addDiskUsage(-static_cast<int64_t>(diskBytes));
+}
 
-Record BufferedFile::read(size_t index) {
+template <size_t RecordLen>
+auto BasicBufferedFile<RecordLen>::read(size_t index) -> Record {
+    requireFixedFormat();
     size_t pageIndex = rIndexToPageIndex(index);
     if (pageIndex >= getPageCount()) {
         THROW_FORMATTED(
@@ -61,7 +80,9 @@ Record BufferedFile::read(size_t index) {
     return page.at(inPageIndex);
 }
 
-void BufferedFile::write(size_t index, Record data) {
+template <size_t RecordLen>
+void BasicBufferedFile<RecordLen>::write(size_t index, Record data) {
+    requireFixedFormat();
     size_t pageIndex = rIndexToPageIndex(index);
 
     if (pageIndex > getPageCount()) {
@@ -77,39 +98,59 @@ void BufferedFile::write(size_t index, Record data) {
     size_t inPageIndex = rIndexToInPageIndex(index);
     loadPage(pageIndex);
 
-    data.resize(recordSize);
-
     page.at(inPageIndex) = data;
     isPageModified = true;
 }
 
-void BufferedFile::flush() {
+template <size_t RecordLen>
+void BasicBufferedFile<RecordLen>::flush() {
     if (!isPageModified) {
         return;
     }
+    TRACE_SPAN_ARG("BufferedFile::flush", "page", currentPageIndex);
+
+    // Serialize the whole page and write it with a single call
+    codec.encode(page, pageBytes);
+    size_t calls = 0;
+    auto start = std::chrono::steady_clock::now();
+    size_t offset = pIndexToOffset(currentPageIndex);
+    pwriteFully(pageBytes.data(), pageSize, offset, calls);
+    metrics->recordPageWrite(
+        pageSize, calls, std::chrono::steady_clock::now() - start
+    );
 
-    std::fstream::off_type offset = pIndexToOffset(currentPageIndex);
-    seekpWithExtend(offset, std::ios::beg);
-
-    // Resize just in case
-    page.resize(recordsPerPage, Record::empty);
-
-    for (const auto& line : page) {
-        file.write(line.data().data(), line.lenght());
+    // NOTE: Pages are appended, pages written within the file only fill a
+    // hole once it was truncated away, which measures the file again
+    if (offset + pageSize > fileSize) {
+        Metrics::instance().addDiskUsage(offset + pageSize - fileSize);
+        diskBytes += offset + pageSize - fileSize;
+        fileSize = offset + pageSize;
     }
 
-    file.flush();
     isPageModified = false;
-    writeCount++;
 }
 
-bool BufferedFile::isCurrentPageEmpty() {
+template <size_t RecordLen>
+void BasicBufferedFile<RecordLen>::sync() {
+    flush();
+    metrics->recordSyscalls(1);
+    if (::fdatasync(fd) != 0) {
+        std::string reason = std::strerror(errno);
+        THROW_FORMATTED(
+            std::runtime_error, "Syncing {} failed: {}", fileName, reason
+        );
+    }
+}
+
+template <size_t RecordLen>
+bool BasicBufferedFile<RecordLen>::isCurrentPageEmpty() {
     return std::ranges::all_of(page, [](auto& s) {
         return s == Record::empty;
     });
 }
 
-BufferedFile::BufferType BufferedFile::readPage(size_t pageIndex) {
+template <size_t RecordLen>
+auto BasicBufferedFile<RecordLen>::readPage(size_t pageIndex) -> BufferType {
     if (pageIndex >= getPageCount()) {
         THROW_FORMATTED(
             std::out_of_range,
@@ -122,305 +163,391 @@ BufferedFile::BufferType BufferedFile::readPage(size_t pageIndex) {
     return page;
 }
 
-BufferedFile::BufferType BufferedFile::readPage() {
+template <size_t RecordLen>
+auto BasicBufferedFile<RecordLen>::readPage() -> BufferType {
     auto temp = readPage(currentPageIndex);
     loadPage(currentPageIndex + 1);
     return temp;
 }
 
-void BufferedFile::resetPageIndex() { loadPage(0); }
-void BufferedFile::setPageIndex(size_t index) { loadPage(index); }
-size_t BufferedFile::getPageIndex() { return currentPageIndex; }
+template <size_t RecordLen>
+void BasicBufferedFile<RecordLen>::readPageInto(
+    size_t pageIndex, BufferType& records
+) {
+    TRACE_SPAN_ARG("BufferedFile::readPageInto", "page", pageIndex);
+    // NOTE: pageBytes belongs to the cached page
+    std::vector<char> bytes(pageSize);
+    size_t calls = 0;
+    auto start = std::chrono::steady_clock::now();
+    size_t got =
+        preadFully(bytes.data(), pageSize, pIndexToOffset(pageIndex), calls);
+    metrics->recordPageRead(
+        got, calls, std::chrono::steady_clock::now() - start
+    );
+    codec.decode(bytes, records);
+}
 
-size_t BufferedFile::getPageCount() {
-    return std::ceil(static_cast<float>(getRecordCount()) / recordsPerPage);
+template <size_t RecordLen>
+void BasicBufferedFile<RecordLen>::resetPageIndex() {
+    loadPage(0);
 }
 
-size_t BufferedFile::getRecordCount() {
-    file.seekg(0, std::ios::end);
-    auto lastPageIndex = static_cast<size_t>(
-        std::floor(static_cast<float>(file.tellg()) / pageSize)
-    );
+template <size_t RecordLen>
+void BasicBufferedFile<RecordLen>::setPageIndex(size_t index) {
+    loadPage(index);
+}
 
-    if (currentPageIndex >= lastPageIndex) {
-        flush();
+template <size_t RecordLen>
+size_t BasicBufferedFile<RecordLen>::getPageIndex() {
+    return currentPageIndex;
+}
+
+template <size_t RecordLen>
+size_t BasicBufferedFile<RecordLen>::getPageCount() {
+    TRACE_SPAN("BufferedFile::getPageCount");
+    return (getWrittenSize() + pageSize - 1) / pageSize;
+}
+
+template <size_t RecordLen>
+size_t BasicBufferedFile<RecordLen>::getRecordCount() {
+    TRACE_SPAN("BufferedFile::getRecordCount");
+    size_t fileSize = getWrittenSize();
+    if (codec.isFixed()) {
+        return (fileSize + recordSize - 1) / recordSize;
     }
 
-    file.seekg(0, std::ios::end);
-    auto lastFileIndex = static_cast<float>(file.tellg());
-    return std::ceil(lastFileIndex / recordSize);
+    // Only the headers are read, they are not counted as page reads
+    size_t pageCount = (fileSize + pageSize - 1) / pageSize;
+    size_t count = 0;
+    char header[PageCodec<RecordLen>::headerSize] = {};
+    for (size_t p = 0; p < pageCount; p++) {
+        size_t calls = 0;
+        auto start = std::chrono::steady_clock::now();
+        size_t got =
+            preadFully(header, sizeof(header), pIndexToOffset(p), calls);
+        metrics->recordRead(
+            got, calls, std::chrono::steady_clock::now() - start
+        );
+        if (got == sizeof(header)) {
+            count += codec.recordCountFromHeader(header);
+        }
+    }
+    return count;
+}
+
+template <size_t RecordLen>
+void BasicBufferedFile<RecordLen>::truncate(size_t pageCount) {
+    if (currentPageIndex != static_cast<size_t>(-1) &&
+        currentPageIndex >= pageCount) {
+        // The cached page is dropped along with the rest
+        isPageModified = false;
+        currentPageIndex = -1;
+    }
+    flush();
+
+    metrics->recordSyscalls(1);
+    if (::ftruncate(fd, static_cast<off_t>(pIndexToOffset(pageCount))) != 0) {
+        std::string reason = std::strerror(errno);
+        THROW_FORMATTED(
+            std::runtime_error, "Truncating {} failed: {}", fileName, reason
+        );
+    }
+    measureDiskUsage();
 }
 
-void BufferedFile::printFileContent() {
-    file.seekg(0);
-    std::size_t count = 0;
-    std::string tmp(Record::maxLen, '\0');
-    while (file.read(tmp.data(), Record::maxLen)) {
-        ++count;
+template <size_t RecordLen>
+size_t BasicBufferedFile<RecordLen>::releasePages(
+    size_t firstPage, size_t lastPage
+) {
+    // Partial blocks at either end of the range stay allocated
+    size_t begin = (pIndexToOffset(firstPage) + blockSize - 1) / blockSize *
+                   blockSize;
+    size_t end = pIndexToOffset(lastPage) / blockSize * blockSize;
+    if (end <= begin) {
+        return firstPage;
     }
-    file.clear();
+    TRACE_SPAN_ARG("BufferedFile::releasePages", "page", firstPage);
+    flush();
 
+    metrics->recordSyscalls(1);
+    if (::fallocate(
+            fd,
+            FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+            static_cast<off_t>(begin),
+            static_cast<off_t>(end - begin)
+        ) != 0) {
+        std::string reason = std::strerror(errno);
+        THROW_FORMATTED(
+            std::runtime_error,
+            "Releasing pages of {} failed: {}",
+            fileName,
+            reason
+        );
+    }
+    // The cached page reads as '\0' now unless it lies past the hole
+    if (currentPageIndex != static_cast<size_t>(-1) &&
+        pIndexToOffset(currentPageIndex + 1) > begin &&
+        pIndexToOffset(currentPageIndex) < end) {
+        currentPageIndex = -1;
+    }
+    measureDiskUsage();
+    return end / pageSize;
+}
+
+template <size_t RecordLen>
+void BasicBufferedFile<RecordLen>::printFileContent() {
+    // A page not flushed yet is not shown
+    struct stat st{};
+    size_t fileSize = ::fstat(fd, &st) == 0 ? st.st_size : 0;
+
+    if (!codec.isFixed()) {
+        // Records are numbered as they are found, there is no count upfront
+        std::vector<char> bytes(pageSize);
+        std::vector<Record> records;
+        size_t i = 0;
+        size_t calls = 0;
+        for (size_t offset = 0; offset < fileSize; offset += pageSize) {
+            std::ranges::fill(bytes, '\0');
+            preadFully(bytes.data(), pageSize, offset, calls);
+            codec.decode(bytes, records);
+            for (const auto& r : records) {
+                std::cout << i++ << ". " << r.data() << '\n';
+            }
+        }
+        std::cout << std::flush;
+        return;
+    }
+
+    // Only whole records are printed
+    size_t count = fileSize / recordSize;
     std::size_t width =
         count == 0
             ? 1
             : static_cast<std::size_t>(std::floor(std::log10(count))) + 1;
 
-    file.seekg(0);
-    std::string emptyStr(recordSize, '\0');
-    std::string currentStr = emptyStr;
+    // Whatever page size, read the file in chunks of whole records
+    size_t chunkRecords = std::max<size_t>(1, (1 << 16) / recordSize);
+    std::string chunk(chunkRecords * recordSize, '\0');
     size_t i = 0;
-    while (file.read(currentStr.data(), Record::maxLen)) {
-        std::cout << std::setw(width) << i++ << ". " << currentStr << '\n';
-        currentStr = emptyStr;
+    size_t calls = 0;
+    while (i < count) {
+        size_t records = std::min(chunkRecords, count - i);
+        size_t got = preadFully(
+            chunk.data(), records * recordSize, i * recordSize, calls
+        );
+        records = got / recordSize;
+        if (records == 0) {
+            break;
+        }
+        for (size_t r = 0; r < records; r++) {
+            std::cout << std::setw(width) << i++ << ". "
+                      << std::string_view(
+                             chunk.data() + r * recordSize, recordSize
+                         )
+                      << '\n';
+        }
     }
     std::cout << std::flush;
-    file.clear();
 }
 
-void BufferedFile::copyFrom(BufferedFile& bf) {
+template <size_t RecordLen>
+void BasicBufferedFile<RecordLen>::copyFrom(
+    BasicBufferedFile& bf, bool releaseCopied
+) {
+    TRACE_SPAN("BufferedFile::copyFrom");
     this->flush();
     bf.flush();
 
-    bf.file.clear();
-    bf.file.seekg(0, std::ios::beg);
-
-    this->file.clear();
-    this->file.seekp(0, std::ios::beg);
+    std::vector<char> chunk(std::max<size_t>(pageSize, 1 << 16));
+    size_t offset = 0;
+    size_t releasedPage = 0;
+    while (true) {
+        size_t readCalls = 0;
+        auto start = std::chrono::steady_clock::now();
+        size_t got = bf.preadFully(chunk.data(), chunk.size(), offset, readCalls);
+        bf.metrics->recordRead(
+            got, readCalls, std::chrono::steady_clock::now() - start
+        );
+        if (got == 0) {
+            break;
+        }
+
+        size_t writeCalls = 0;
+        start = std::chrono::steady_clock::now();
+        pwriteFully(chunk.data(), got, offset, writeCalls);
+        metrics->recordWrite(
+            got, writeCalls, std::chrono::steady_clock::now() - start
+        );
+        offset += got;
+
+        size_t copiedPages = offset / bf.pageSize;
+        if (releaseCopied &&
+            bf.pIndexToOffset(copiedPages - releasedPage) >=
+                releaseBatchBytes) {
+            releasedPage = bf.releasePages(releasedPage, copiedPages);
+        }
+    }
 
-    this->file << bf.file.rdbuf();
-    this->file.flush();
+    // The cached page may no longer match the file
+    currentPageIndex = -1;
 
-    this->file.clear();
+    // Drop whatever this file held past the end of the copy
+    metrics->recordSyscalls(1);
+    if (::ftruncate(fd, static_cast<off_t>(offset)) != 0) {
+        std::string reason = std::strerror(errno);
+        THROW_FORMATTED(
+            std::runtime_error, "Truncating {} failed: {}", fileName, reason
+        );
+    }
+    measureDiskUsage();
 }
 
-size_t BufferedFile::rIndexToPageIndex(size_t index) {
+template <size_t RecordLen>
+size_t BasicBufferedFile<RecordLen>::rIndexToPageIndex(size_t index) {
     return index / recordsPerPage;
 }
 
-size_t BufferedFile::rIndexToInPageIndex(size_t index) {
+template <size_t RecordLen>
+size_t BasicBufferedFile<RecordLen>::rIndexToInPageIndex(size_t index) {
     return (index % recordsPerPage);
 }
 
-size_t BufferedFile::pIndexToOffset(size_t pageIndex) {
+template <size_t RecordLen>
+size_t BasicBufferedFile<RecordLen>::pIndexToOffset(size_t pageIndex) {
     return pageIndex * pageSize;
 }
 
-void BufferedFile::loadPage(size_t pageIndex) {
+template <size_t RecordLen>
+void BasicBufferedFile<RecordLen>::loadPage(size_t pageIndex) {
     if (pageIndex == currentPageIndex) {
         return;
     }
+    TRACE_SPAN_ARG("BufferedFile::loadPage", "page", pageIndex);
     flush();
 
-    size_t offset = pIndexToOffset(pageIndex);
-    file.seekg(offset, std::ios::beg);
-
-    page.clear();
-    size_t i = 0;
-    std::string emptyStr(recordSize, '\0');
-    std::string currentStr = emptyStr;
-
-    while (i < recordsPerPage && file.good()) {
-        file.read(currentStr.data(), recordSize);
-        page.emplace_back(currentStr);
-        currentStr = emptyStr;
-        i++;
-    }
-
-    file.clear();  // Clear flags in case we stumbled upon eof
+    // Read the whole page at once, whatever lies beyond the end of the file
+    // stays '\0' and becomes Record::empty
+    std::ranges::fill(pageBytes, '\0');
+    size_t calls = 0;
+    auto start = std::chrono::steady_clock::now();
+    size_t got = preadFully(
+        pageBytes.data(), pageSize, pIndexToOffset(pageIndex), calls
+    );
+    metrics->recordPageRead(
+        got, calls, std::chrono::steady_clock::now() - start
+    );
 
-    // Fill the page in case we run into the end of the file
-    page.resize(recordsPerPage, Record::empty);
+    codec.decode(pageBytes, page);
 
     currentPageIndex = pageIndex;
-    readCout++;
 }
 
-std::streampos BufferedFile::getFileSize() {
-    file.seekg(0, std::ios::end);
-    return file.tellg();
-}
+template <size_t RecordLen>
+size_t BasicBufferedFile<RecordLen>::getWrittenSize() {
+    size_t fileSize = getFileSize();
 
-void BufferedFile::extendFile(std::streampos size) {
-    auto curentSize = getFileSize();
-    if (curentSize >= size) {
-        return;
-    }
-    file.seekp(0, std::ios::end);
-    auto diffSize = size - curentSize;
-    std::string str;
-    for (auto i = 0; i < diffSize; i += recordSize) {
-        file.write(str.data(), str.length());
+    // The current page may not be in the file yet, flushing it writes a whole
+    // page so the new size is known without asking again
+    if (currentPageIndex >= fileSize / pageSize && isPageModified) {
+        flush();
+        fileSize = std::max(fileSize, pIndexToOffset(currentPageIndex + 1));
     }
+    return fileSize;
 }
 
-void BufferedFile::seekpWithExtend(
-    std::ifstream::off_type offset, std::ios_base::seekdir dir
-) {
-    extendFile(offset + pageSize);
-    file.seekp(offset, dir);
-}
-
-// ============================================================================
-// PageProxy
-// ============================================================================
-
-BufferedFile::PageProxy::PageProxy(BufferedFile* file, size_t pageIndex)
-    : file(file), pageIndex(pageIndex) {}
-
-BufferedFile::PageProxy::operator std::vector<Record>() const {
-    return records();
-}
-
-std::vector<Record> BufferedFile::PageProxy::records() const {
-    auto pageOpt = file->readPage(pageIndex);
-    return pageOpt;
-}
-
-Record BufferedFile::PageProxy::operator[](size_t recordIndexInPage) const {
-    return file->read(pageIndex * recordsPerPage + recordIndexInPage);
-}
-
-// ============================================================================
-// PageIterator
-// ============================================================================
-
-BufferedFile::PageIterator::PageIterator(BufferedFile* file, size_t pageIndex)
-    : file(file), pageIndex(pageIndex) {}
-
-BufferedFile::PageIterator::PageIterator(BufferedFile::PageSentinel ps) {
-    if (ps.file == nullptr) {
+template <size_t RecordLen>
+void BasicBufferedFile<RecordLen>::requireFixedFormat() const {
+    if (!codec.isFixed()) {
         THROW_FORMATTED(
-            std::invalid_argument,
-            "The program tried to make a PageIterator from a PageSentinel "
-            "without initialized file"
+            std::logic_error,
+            "Record access by index needs the fixed page format, {} uses {}",
+            fileName,
+            pageFormatName(codec.getFormat())
         );
     }
 }
 
-BufferedFile::PageIterator::reference
-BufferedFile::PageIterator::operator*() const {
-    return PageProxy(file, pageIndex);
-}
-
-BufferedFile::PageIterator::pointer
-BufferedFile::PageIterator::operator->() const {
-    return PageProxy(file, pageIndex);
-}
-
-BufferedFile::PageIterator& BufferedFile::PageIterator::operator++() {
-    pageIndex++;
-    return *this;
-}
-
-BufferedFile::PageIterator BufferedFile::PageIterator::operator++(int) {
-    PageIterator tmp = *this;
-    ++(*this);
-    return tmp;
-}
-
-BufferedFile::PageIterator& BufferedFile::PageIterator::operator--() {
-    pageIndex--;
-    return *this;
-}
-
-BufferedFile::PageIterator BufferedFile::PageIterator::operator--(int) {
-    PageIterator tmp = *this;
-    --(*this);
-    return tmp;
-}
-
-BufferedFile::PageIterator& BufferedFile::PageIterator::operator+=(
-    difference_type n
-) {
-    pageIndex += n;
-    return *this;
-}
-
-BufferedFile::PageIterator& BufferedFile::PageIterator::operator-=(
-    difference_type n
-) {
-    pageIndex -= n;
-    return *this;
-}
-
-BufferedFile::PageIterator operator+(
-    BufferedFile::PageIterator it, BufferedFile::PageIterator::difference_type n
-) {
-    it += n;
-    return it;
-}
-
-BufferedFile::PageIterator operator+(
-    BufferedFile::PageIterator::difference_type n, BufferedFile::PageIterator it
-) {
-    it += n;
-    return it;
-}
-
-BufferedFile::PageIterator operator-(
-    BufferedFile::PageIterator it, BufferedFile::PageIterator::difference_type n
-) {
-    it -= n;
-    return it;
-}
-
-BufferedFile::PageIterator::difference_type operator-(
-    const BufferedFile::PageIterator& a, const BufferedFile::PageIterator& b
-) {
-    return a.pageIndex - b.pageIndex;
-}
-
-BufferedFile::PageIterator::reference BufferedFile::PageIterator::operator[](
-    difference_type n
-) const {
-    return *(*this + n);
-}
-
-bool BufferedFile::PageIterator::operator==(const PageIterator& other) const {
-    return file == other.file && pageIndex == other.pageIndex;
+template <size_t RecordLen>
+size_t BasicBufferedFile<RecordLen>::getFileSize() {
+    struct stat st{};
+    metrics->recordSyscalls(1);
+    if (::fstat(fd, &st) != 0) {
+        std::string reason = std::strerror(errno);
+        THROW_FORMATTED(
+            std::runtime_error, "Reading size of {} failed: {}", fileName, reason
+        );
+    }
+    return st.st_size;
 }
 
-std::partial_ordering BufferedFile::PageIterator::operator<=>(
-    const PageIterator& other
-) const {
-    if (file != other.file) {
-        return std::partial_ordering::unordered;
-    } else {
-        return static_cast<std::partial_ordering>(
-            pageIndex <=> other.pageIndex
+template <size_t RecordLen>
+void BasicBufferedFile<RecordLen>::measureDiskUsage() {
+    struct stat st{};
+    metrics->recordSyscalls(1);
+    if (::fstat(fd, &st) != 0) {
+        std::string reason = std::strerror(errno);
+        THROW_FORMATTED(
+            std::runtime_error, "Reading size of {} failed: {}", fileName, reason
         );
     }
+    // st_blocks is in units of 512 bytes, whatever the block size
+    size_t measured = static_cast<size_t>(st.st_blocks) * 512;
+    Metrics::instance().addDiskUsage(
+        static_cast<int64_t>(measured) - static_cast<int64_t>(diskBytes)
+    );
+    diskBytes = measured;
+    fileSize = st.st_size;
+    if (st.st_blksize > 0) {
+        blockSize = st.st_blksize;
+    }
 }
 
-// ============================================================================
-// PageSentinel
-// ============================================================================
-
-BufferedFile::PageSentinel::PageSentinel(BufferedFile* file, size_t pageIndex)
-    : file(file), pageIndex(pageIndex) {}
-
-bool operator==(
-    const BufferedFile::PageIterator& it, const BufferedFile::PageSentinel& s
-) {
-    return it.file == s.file && it.pageIndex == s.pageIndex;
-}
-std::ptrdiff_t operator-(
-    const BufferedFile::PageIterator& it, const BufferedFile::PageSentinel& s
+template <size_t RecordLen>
+size_t BasicBufferedFile<RecordLen>::preadFully(
+    char* data, size_t size, size_t offset, size_t& calls
 ) {
-    using diff_t = BufferedFile::PageIterator::difference_type;
-    return static_cast<diff_t>(it.pageIndex) - static_cast<diff_t>(s.pageIndex);
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = ::pread(fd, data + done, size - done, offset + done);
+        calls++;
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            std::string reason = std::strerror(errno);
+            THROW_FORMATTED(
+                std::runtime_error, "Reading {} failed: {}", fileName, reason
+            );
+        }
+        if (n == 0) {
+            break;
+        }
+        done += n;
+    }
+    return done;
 }
 
-BufferedFile::PageIterator operator-(
-    const BufferedFile::PageSentinel& s,
-    BufferedFile::PageIterator::difference_type n
+template <size_t RecordLen>
+void BasicBufferedFile<RecordLen>::pwriteFully(
+    const char* data, size_t size, size_t offset, size_t& calls
 ) {
-    return BufferedFile::PageIterator(s.file, s.pageIndex - n);
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = ::pwrite(fd, data + done, size - done, offset + done);
+        calls++;
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            std::string reason = std::strerror(errno);
+            THROW_FORMATTED(
+                std::runtime_error, "Writing {} failed: {}", fileName, reason
+            );
+        }
+        done += n;
+    }
 }
 
-BufferedFile::PageIterator::difference_type operator-(
-    const BufferedFile::PageSentinel& s, const BufferedFile::PageIterator& it
-) {
-    using diff_t = BufferedFile::PageIterator::difference_type;
-    return static_cast<diff_t>(s.pageIndex) - static_cast<diff_t>(it.pageIndex);
-}
+#define INSTANTIATE_BUFFERED_FILE(W) template class BasicBufferedFile<W>;
+FOR_EACH_RECORD_WIDTH(INSTANTIATE_BUFFERED_FILE)
+#undef INSTANTIATE_BUFFERED_FILE
@@ -5,30 +5,34 @@
 #include <concepts>
 #include <cstddef>
 #include <error.hpp>
-#include <fstream>
-#include <ios>
-#include <iosfwd>
-#include <mutex>
+#include <iterator>
+#include <memory>
+#include <metrics.hpp>
+#include <page_format.hpp>
+#include <ranges>
 #include <record.hpp>
+#include <stdexcept>
+#include <string>
 #include <utility>
 #include <vector>
 
-template <typename R>
+template <typename R, typename RecordT>
 concept RangeOfRecords = std::ranges::range<R> &&
-                         std::same_as<std::ranges::range_value_t<R>, Record>;
-
-class BufferedFile {
+                         std::same_as<std::ranges::range_value_t<R>, RecordT>;
+
+// A file of records that is read and written one page at a time. The record
+// width is a template parameter so every page loop is compiled for the exact
+// record size, the blocking factor and the page format are chosen per file at
+// runtime. A page is always recordsPerPage * recordSize bytes on disk, with
+// PageFormat::VARIABLE and PageFormat::PREFIX it holds a varying number of
+// records.
+template <size_t RecordLen>
+class BasicBufferedFile {
    public:
+    using Record = BasicRecord<RecordLen>;
+
     // Record Size in bytes
     static constexpr size_t recordSize = Record::maxLen;
-    static size_t recordsPerPage;
-    // Page size in bytes
-    static size_t pageSize;
-
-    static size_t readCout;
-    static size_t writeCount;
-
-    static void setRecordsPerPage(size_t recordsPerPage);
 
     class PageProxy;
     class PageIterator;
@@ -38,20 +42,26 @@ class BufferedFile {
        public:
         friend class PageIterator;
 
-        operator std::vector<Record>() const;
-        std::vector<Record> records() const;
-        Record operator[](size_t recordIndexInPage) const;
+        operator std::vector<Record>() const { return records(); }
+        std::vector<Record> records() const {
+            return file->readPage(pageIndex);
+        }
+        Record operator[](size_t recordIndexInPage) const {
+            file->loadPage(pageIndex);
+            return file->page.at(recordIndexInPage);
+        }
 
-        PageProxy operator=(RangeOfRecords auto const& newPage) {
+        PageProxy operator=(RangeOfRecords<Record> auto const& newPage) {
             file->writePage(pageIndex, newPage);
             return *this;
         }
         auto operator<=>(const PageProxy& other) const = default;
 
        private:
-        PageProxy(BufferedFile* file, size_t pageIndex);
+        PageProxy(BasicBufferedFile* file, size_t pageIndex)
+            : file(file), pageIndex(pageIndex) {}
 
-        BufferedFile* file;
+        BasicBufferedFile* file;
         size_t pageIndex;
     };
 
@@ -63,101 +73,170 @@ class BufferedFile {
         using pointer = PageProxy;
         using reference = PageProxy;
 
-        PageIterator(BufferedFile* file, size_t pageIndex);
-        PageIterator(PageSentinel ps);
-
-        reference operator*() const;
+        PageIterator() = default;
+        PageIterator(BasicBufferedFile* file, size_t pageIndex)
+            : file(file), pageIndex(pageIndex) {}
+        PageIterator(PageSentinel ps)
+            : file(ps.get_file()), pageIndex(ps.get_page_index()) {
+            if (file == nullptr) {
+                THROW_FORMATTED(
+                    std::invalid_argument,
+                    "The program tried to make a PageIterator from a "
+                    "PageSentinel without initialized file"
+                );
+            }
+        }
 
-        pointer operator->() const;
+        reference operator*() const { return PageProxy(file, pageIndex); }
+        pointer operator->() const { return PageProxy(file, pageIndex); }
 
-        PageIterator& operator++();
-        PageIterator operator++(int);
-        PageIterator& operator--();
-        PageIterator operator--(int);
+        PageIterator& operator++() {
+            pageIndex++;
+            return *this;
+        }
+        PageIterator operator++(int) {
+            PageIterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+        PageIterator& operator--() {
+            pageIndex--;
+            return *this;
+        }
+        PageIterator operator--(int) {
+            PageIterator tmp = *this;
+            --(*this);
+            return tmp;
+        }
 
-        PageIterator& operator+=(difference_type n);
-        PageIterator& operator-=(difference_type n);
+        PageIterator& operator+=(difference_type n) {
+            pageIndex += n;
+            return *this;
+        }
+        PageIterator& operator-=(difference_type n) {
+            pageIndex -= n;
+            return *this;
+        }
 
-        friend PageIterator operator+(PageIterator it, difference_type n);
-        friend PageIterator operator+(difference_type n, PageIterator it);
-        friend PageIterator operator-(PageIterator it, difference_type n);
+        friend PageIterator operator+(PageIterator it, difference_type n) {
+            it += n;
+            return it;
+        }
+        friend PageIterator operator+(difference_type n, PageIterator it) {
+            it += n;
+            return it;
+        }
+        friend PageIterator operator-(PageIterator it, difference_type n) {
+            it -= n;
+            return it;
+        }
         friend difference_type operator-(
             const PageIterator& a, const PageIterator& b
-        );
-
-        reference operator[](difference_type n) const;
+        ) {
+            return a.pageIndex - b.pageIndex;
+        }
 
-        bool operator==(const PageIterator& other) const;
-        std::partial_ordering operator<=>(const PageIterator& other) const;
+        reference operator[](difference_type n) const { return *(*this + n); }
 
-        friend bool operator==(
-            const BufferedFile::PageIterator& it, const PageSentinel& s
-        );
-        friend std::ptrdiff_t operator-(
-            const BufferedFile::PageIterator& it, const PageSentinel& s
-        );
+        bool operator==(const PageIterator& other) const {
+            return file == other.file && pageIndex == other.pageIndex;
+        }
+        std::partial_ordering operator<=>(const PageIterator& other) const {
+            if (file != other.file) {
+                return std::partial_ordering::unordered;
+            }
+            return static_cast<std::partial_ordering>(
+                pageIndex <=> other.pageIndex
+            );
+        }
 
-        friend PageIterator::difference_type operator-(
+        friend bool operator==(const PageIterator& it, const PageSentinel& s) {
+            return it.file == s.get_file() &&
+                   it.pageIndex == s.get_page_index();
+        }
+        friend difference_type operator-(
+            const PageIterator& it, const PageSentinel& s
+        ) {
+            return static_cast<difference_type>(it.pageIndex) -
+                   static_cast<difference_type>(s.get_page_index());
+        }
+        friend difference_type operator-(
             const PageSentinel& s, const PageIterator& it
-        );
+        ) {
+            return static_cast<difference_type>(s.get_page_index()) -
+                   static_cast<difference_type>(it.pageIndex);
+        }
+
+        BasicBufferedFile* get_file() const { return file; }
+        size_t get_page_index() const { return pageIndex; }
 
        private:
-        BufferedFile* file;
-        size_t pageIndex;
+        BasicBufferedFile* file = nullptr;
+        size_t pageIndex = 0;
     };
 
     class PageSentinel {
        public:
-        friend BufferedFile::PageIterator;
-        using diffType = PageIterator::difference_type;
+        friend PageIterator;
+        using diffType = typename PageIterator::difference_type;
 
         PageSentinel() = default;
-        PageSentinel(BufferedFile* file, size_t pageIndex);
-
-        friend bool operator==(
-            const BufferedFile::PageIterator& it, const PageSentinel& s
-        );
-        friend std::ptrdiff_t operator-(
-            const BufferedFile::PageIterator& it, const PageSentinel& s
-        );
-
-        friend PageIterator operator-(
-            const PageSentinel& s, PageIterator::difference_type n
-        );
+        PageSentinel(BasicBufferedFile* file, size_t pageIndex)
+            : file(file), pageIndex(pageIndex) {}
 
-        friend PageIterator::difference_type operator-(
-            const PageSentinel& s, const PageIterator& it
-        );
+        friend PageIterator operator-(const PageSentinel& s, diffType n) {
+            return PageIterator(s.file, s.pageIndex - n);
+        }
 
-        BufferedFile* get_file() const { return file; }
+        BasicBufferedFile* get_file() const { return file; }
         size_t get_page_index() const { return pageIndex; }
 
        private:
-        BufferedFile* file = nullptr;
+        BasicBufferedFile* file = nullptr;
         size_t pageIndex = 0;
     };
 
     using BufferType = std::vector<Record>;
 
-    BufferedFile(const std::string fileName);
-    ~BufferedFile();
+    // `role` tells the files apart in the metrics, e.g. "input" or "temp"
+    BasicBufferedFile(
+        const std::string fileName,
+        size_t recordsPerPage,
+        PageFormat format = PageFormat::FIXED,
+        const std::string& role = "data"
+    );
+    ~BasicBufferedFile();
+
+    BasicBufferedFile(const BasicBufferedFile&) = delete;
+    BasicBufferedFile& operator=(const BasicBufferedFile&) = delete;
 
+    // Random access by record index, only for PageFormat::FIXED where every
+    // page holds the same number of records
     Record read(size_t index);
     void write(size_t index, Record data);
     void flush();
+    // Flushes and waits until the file is on the disk itself
+    void sync();
     // Checks if the current page is empty
     bool isCurrentPageEmpty();
     // Returns the page with a given index if it exists
     BufferType readPage(size_t pageIndex);
     // Returns the current page and increments the page index
     BufferType readPage();
+    // Replaces `records` with the page at `pageIndex` as it is on disk,
+    // bypassing the cached page. It only reads the file, so a thread may
+    // call it while another thread uses the file, as long as that thread
+    // does not write the page.
+    void readPageInto(size_t pageIndex, BufferType& records);
     // Completly overwrites the current page and increments the page index
-    void writePage(RangeOfRecords auto const& page) {
+    void writePage(RangeOfRecords<Record> auto const& page) {
         writePage(currentPageIndex, page);
         loadPage(currentPageIndex + 1);
     }
 
-    void writePage(size_t pageIndex, RangeOfRecords auto const& newPage) {
+    void writePage(
+        size_t pageIndex, RangeOfRecords<Record> auto const& newPage
+    ) {
         if (pageIndex > getPageCount()) {
             THROW_FORMATTED(
                 std::out_of_range,
@@ -173,16 +252,31 @@ class BufferedFile {
         BufferType tmp;
         tmp.reserve(recordsPerPage);
 
-        for (auto r : newPage) {
-            if (tmp.size() >= recordsPerPage) {
-                break;
+        if (codec.isFixed()) {
+            for (const auto& r : newPage) {
+                if (tmp.size() >= recordsPerPage) {
+                    break;
+                }
+                tmp.push_back(r);
+            }
+            tmp.resize(recordsPerPage, Record::empty);
+        } else {
+            size_t used = 0;
+            for (const auto& r : newPage) {
+                used += codec.recordCost(r, tmp.empty() ? nullptr : &tmp.back());
+                tmp.push_back(r);
+            }
+            if (used > codec.capacity()) {
+                THROW_FORMATTED(
+                    std::length_error,
+                    "Writing Page failed. {} records need {} bytes, "
+                    "page {} only has room for {}",
+                    tmp.size(),
+                    used,
+                    pageIndex,
+                    codec.capacity()
+                );
             }
-            r.resize(recordSize);
-            tmp.push_back(r);
-        }
-
-        while (tmp.size() < recordsPerPage) {
-            tmp.push_back(Record::empty);
         }
 
         this->page = std::move(tmp);
@@ -194,13 +288,37 @@ class BufferedFile {
     void setPageIndex(size_t index);
     size_t getPageIndex();
 
+    const std::string& getFileName() const { return fileName; }
+    size_t getRecordsPerPage() const { return recordsPerPage; }
+    // Page size in bytes
+    size_t getPageSize() const { return pageSize; }
+    PageFormat getPageFormat() const { return codec.getFormat(); }
+    const PageCodec<RecordLen>& getCodec() const { return codec; }
+
     size_t getPageCount();
+    // Unless the format is PageFormat::FIXED this reads the header of every
+    // page
     size_t getRecordCount();
-
-    // This is just a debug function so it does not change the readCount or
-    // writeCount
+    // Drops every page from pageCount on
+    void truncate(size_t pageCount);
+    // Gives the disk blocks of pages [firstPage, lastPage) back to the file
+    // system without changing the size of the file, they read as '\0' from
+    // then on. Only blocks that lie wholly in the range are freed, so the
+    // return value is the page to start the next adjacent range from.
+    // Throws std::runtime_error if the file system can not punch holes.
+    size_t releasePages(size_t firstPage, size_t lastPage);
+    // Readers that release the pages they consumed wait until this many
+    // bytes are consumed, so a call frees whole blocks and syscalls stay rare
+    static constexpr size_t releaseBatchBytes = 1 << 18;
+
+    // I/O counters of this file, shared with the global Metrics registry
+    const FileMetrics& getMetrics() const { return *metrics; }
+
+    // This is just a debug function so it does not record any metrics
     void printFileContent();
-    void copyFrom(BufferedFile& file);
+    // Makes this file a byte for byte copy of `file`. With `releaseCopied`
+    // the pages of `file` are released once they are copied.
+    void copyFrom(BasicBufferedFile& file, bool releaseCopied = false);
 
     auto pages() {
         auto begin = PageIterator(this, 0);
@@ -209,12 +327,25 @@ class BufferedFile {
     }
 
    private:
-    static std::once_flag setRecordsPerPageFlag;
+    const std::string fileName;
+    const size_t recordsPerPage;
+    const size_t pageSize;
+    const PageCodec<RecordLen> codec;
 
-    std::fstream file;
+    int fd = -1;
+    std::shared_ptr<FileMetrics> metrics;
     std::vector<Record> page;
+    // Encoded bytes of a single page, reused by every load and flush
+    std::vector<char> pageBytes;
     size_t currentPageIndex = -1;
     bool isPageModified = false;
+    // Size of the file and the bytes it takes on disk as last measured, plus
+    // the pages flushed past the end since then
+    size_t fileSize = 0;
+    size_t diskBytes = 0;
+    // Preferred I/O size of the file system, holes are punched in whole
+    // blocks of this size
+    size_t blockSize = 4096;
 
     // Converts a record index to the corresponding page index
     size_t rIndexToPageIndex(size_t index);
@@ -225,15 +356,28 @@ class BufferedFile {
     size_t pIndexToOffset(size_t index);
 
     void loadPage(size_t pageIndex);
-    std::streampos getFileSize();
-    // Extends a file to the total desired size given in bytes
-    void extendFile(std::streampos size);
-
-    // Sets the put cursor in the desired place, in addition validates the given
-    // offset and extends the file if needed
-    void seekpWithExtend(
-        std::ifstream::off_type offset, std::ios_base::seekdir dir
+    size_t getFileSize();
+    // Asks the file system what the file takes on disk and reports the change
+    // to the Metrics
+    void measureDiskUsage();
+    // Size of the file once the current page is written, flushes it if it
+    // is past the end of the file
+    size_t getWrittenSize();
+    void requireFixedFormat() const;
+
+    // Read or write until `size` bytes are moved, reading stops early at the
+    // end of the file and returns the number of bytes read. Both add the
+    // number of system calls made to `calls`.
+    size_t preadFully(char* data, size_t size, size_t offset, size_t& calls);
+    void pwriteFully(
+        const char* data, size_t size, size_t offset, size_t& calls
     );
 };
 
+#define DECLARE_BUFFERED_FILE(W) extern template class BasicBufferedFile<W>;
+FOR_EACH_RECORD_WIDTH(DECLARE_BUFFERED_FILE)
+#undef DECLARE_BUFFERED_FILE
+
+using BufferedFile = BasicBufferedFile<Record::maxLen>;
+
 #endif
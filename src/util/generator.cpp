@@ -0,0 +1,338 @@
+#include "generator.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "error.hpp"
+
+static constexpr std::array<std::pair<Distribution, std::string_view>, 8>
+    distributionNames{{
+        {Distribution::UNIFORM, "uniform"},
+        {Distribution::SORTED, "sorted"},
+        {Distribution::REVERSE, "reverse"},
+        {Distribution::NEARLY_SORTED, "nearly-sorted"},
+        {Distribution::DUPLICATES, "duplicates"},
+        {Distribution::ZIPF, "zipf"},
+        {Distribution::PREFIX, "prefix"},
+        {Distribution::FIXED_LENGTH, "fixed"},
+    }};
+
+std::optional<Distribution> parseDistribution(std::string_view name) {
+    for (const auto& [distribution, distName] : distributionNames) {
+        if (distName == name) {
+            return distribution;
+        }
+    }
+    return std::nullopt;
+}
+
+std::string_view distributionName(Distribution distribution) {
+    for (const auto& [dist, distName] : distributionNames) {
+        if (dist == distribution) {
+            return distName;
+        }
+    }
+    return "unknown";
+}
+
+// ============================================================================
+// RecordGenerator
+// ============================================================================
+
+RecordGenerator::RecordGenerator(const GeneratorConfig& config)
+    : config(config) {
+    const size_t width = config.recordWidth;
+
+    // Ordered keys are the record index written in the key alphabet
+    for (size_t capacity = alphabetSize(); capacity < config.recordCount;
+         capacity *= alphabetSize()) {
+        keyLen++;
+    }
+    bool isOrdered = config.distribution == Distribution::SORTED ||
+                     config.distribution == Distribution::REVERSE ||
+                     config.distribution == Distribution::NEARLY_SORTED;
+    if (isOrdered && keyLen > width) {
+        THROW_FORMATTED(
+            std::invalid_argument,
+            "{} distinct ordered records do not fit in {} bytes",
+            config.recordCount,
+            width
+        );
+    }
+
+    // A separate engine, so the pool does not depend on any block
+    std::seed_seq seq{
+        static_cast<uint32_t>(config.seed),
+        static_cast<uint32_t>(config.seed >> 32),
+        static_cast<uint32_t>(config.distribution),
+    };
+    Engine rng(seq);
+
+    if (config.distribution == Distribution::DUPLICATES ||
+        config.distribution == Distribution::ZIPF) {
+        if (config.distinctCount == 0) {
+            THROW_FORMATTED(
+                std::invalid_argument,
+                "The {} distribution needs at least one distinct record",
+                distributionName(config.distribution)
+            );
+        }
+        pool.assign(config.distinctCount * width, '\0');
+        for (size_t i = 0; i < config.distinctCount; i++) {
+            generateRandomRecord(rng, pool.data() + i * width);
+        }
+    }
+
+    if (config.distribution == Distribution::ZIPF) {
+        zipfCdf.resize(config.distinctCount);
+        double sum = 0;
+        for (size_t i = 0; i < config.distinctCount; i++) {
+            sum += 1.0 / std::pow(static_cast<double>(i + 1), config.zipfSkew);
+            zipfCdf[i] = sum;
+        }
+        for (auto& p : zipfCdf) {
+            p /= sum;
+        }
+    }
+
+    if (config.distribution == Distribution::PREFIX) {
+        size_t prefixLen = width - std::min<size_t>(width / 2, 8);
+        for (size_t i = 0; i < prefixLen; i++) {
+            prefix += randomChar(rng);
+        }
+    }
+}
+
+void RecordGenerator::fillBlock(
+    size_t blockIndex, size_t count, char* out
+) const {
+    std::seed_seq seq{
+        static_cast<uint32_t>(config.seed),
+        static_cast<uint32_t>(config.seed >> 32),
+        static_cast<uint32_t>(blockIndex),
+        static_cast<uint32_t>(blockIndex >> 32)
+    };
+    Engine rng(seq);
+
+    const size_t width = config.recordWidth;
+    const size_t first = blockIndex * blockRecords;
+
+    std::fill_n(out, count * width, '\0');
+    for (size_t i = 0; i < count; i++) {
+        generateRecord(rng, first + i, out + i * width);
+    }
+}
+
+void RecordGenerator::generateRecord(
+    Engine& rng, size_t recordIndex, char* out
+) const {
+    switch (config.distribution) {
+        case Distribution::UNIFORM:
+            generateRandomRecord(rng, out);
+            break;
+        case Distribution::SORTED:
+            generateOrderedRecord(rng, recordIndex, out);
+            break;
+        case Distribution::REVERSE:
+            generateOrderedRecord(
+                rng, config.recordCount - 1 - recordIndex, out
+            );
+            break;
+        case Distribution::NEARLY_SORTED: {
+            std::uniform_real_distribution<double> percentDist(0, 100);
+            if (percentDist(rng) < config.perturbPercent) {
+                generateRandomRecord(rng, out);
+            } else {
+                generateOrderedRecord(rng, recordIndex, out);
+            }
+            break;
+        }
+        case Distribution::DUPLICATES: {
+            std::uniform_int_distribution<size_t> poolDist(
+                0, config.distinctCount - 1
+            );
+            copyPoolRecord(poolDist(rng), out);
+            break;
+        }
+        case Distribution::ZIPF: {
+            std::uniform_real_distribution<double> probDist(0, 1);
+            auto it = std::ranges::upper_bound(zipfCdf, probDist(rng));
+            size_t rank = std::min<size_t>(
+                it - zipfCdf.begin(), config.distinctCount - 1
+            );
+            copyPoolRecord(rank, out);
+            break;
+        }
+        case Distribution::PREFIX: {
+            std::memcpy(out, prefix.data(), prefix.size());
+            std::uniform_int_distribution<size_t> suffixLenDist(
+                1, config.recordWidth - prefix.size()
+            );
+            size_t suffixLen = suffixLenDist(rng);
+            for (size_t i = 0; i < suffixLen; i++) {
+                out[prefix.size() + i] = randomChar(rng);
+            }
+            break;
+        }
+        case Distribution::FIXED_LENGTH:
+            generateRandomRecord(rng, out, config.recordWidth);
+            break;
+    }
+}
+
+void RecordGenerator::generateRandomRecord(
+    Engine& rng, char* out, size_t minLen
+) const {
+    std::uniform_int_distribution<size_t> lenDist(minLen, config.recordWidth);
+
+    size_t length = lenDist(rng);
+    for (size_t i = 0; i < length; ++i) {
+        out[i] = randomChar(rng);
+    }
+}
+
+void RecordGenerator::generateOrderedRecord(
+    Engine& rng, size_t value, char* out
+) const {
+    for (size_t i = keyLen; i-- > 0;) {
+        out[i] = digitChar(value % alphabetSize());
+        value /= alphabetSize();
+    }
+
+    // The tail never changes the order as every key is unique
+    std::uniform_int_distribution<size_t> lenDist(keyLen, config.recordWidth);
+    size_t length = lenDist(rng);
+    for (size_t i = keyLen; i < length; i++) {
+        out[i] = randomChar(rng);
+    }
+}
+
+void RecordGenerator::copyPoolRecord(size_t poolIndex, char* out) const {
+    const size_t width = config.recordWidth;
+    std::memcpy(out, pool.data() + poolIndex * width, width);
+}
+
+char RecordGenerator::randomChar(Engine& rng) const {
+    std::uniform_int_distribution<size_t> digitDist(0, alphabetSize() - 1);
+    return digitChar(digitDist(rng));
+}
+
+char RecordGenerator::digitChar(size_t digit) const {
+    // ASCII printable characters are in rage [32,126]
+    // but whe start from 33 as (char)32 is space.
+    // NOTE: (char)33 == '!'; (char)126 == '~';
+    char first = config.numbersOnly ? '0' : '!';
+    return static_cast<char>(first + digit);
+}
+
+size_t RecordGenerator::alphabetSize() const {
+    return config.numbersOnly ? 10 : 94;
+}
+
+// ============================================================================
+// Writing
+// ============================================================================
+
+void writeGeneratedFile(
+    const std::string& fileName, const RecordGenerator& generator,
+    size_t threadCount
+) {
+    std::filesystem::path dir = std::filesystem::path(fileName).parent_path();
+    if (!dir.empty()) {
+        std::filesystem::create_directories(dir);
+    }
+
+    int fd = ::open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::string reason = std::strerror(errno);
+        THROW_FORMATTED(
+            std::runtime_error,
+            "Could not open {} for writing: {}",
+            fileName,
+            reason
+        );
+    }
+
+    const size_t width = generator.getRecordWidth();
+    const size_t recordCount = generator.getConfig().recordCount;
+    const size_t blockCount =
+        (recordCount + RecordGenerator::blockRecords - 1) /
+        RecordGenerator::blockRecords;
+    threadCount =
+        std::clamp<size_t>(threadCount, 1, std::max<size_t>(blockCount, 1));
+
+    // Blocks are handed out dynamically, the output does not depend on which
+    // thread generated which block
+    std::atomic<size_t> nextBlock = 0;
+    std::atomic<int> writeError = 0;
+
+    auto worker = [&]() {
+        std::vector<char> block(generator.getBlockBytes());
+        for (size_t b = nextBlock++; b < blockCount && writeError == 0;
+             b = nextBlock++) {
+            size_t first = b * RecordGenerator::blockRecords;
+            size_t count =
+                std::min(RecordGenerator::blockRecords, recordCount - first);
+            generator.fillBlock(b, count, block.data());
+
+            size_t bytes = count * width;
+            off_t offset = static_cast<off_t>(first * width);
+            size_t written = 0;
+            while (written < bytes) {
+                ssize_t n = ::pwrite(
+                    fd,
+                    block.data() + written,
+                    bytes - written,
+                    offset + static_cast<off_t>(written)
+                );
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    writeError = errno;
+                    return;
+                }
+                written += static_cast<size_t>(n);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < threadCount; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    ::close(fd);
+
+    if (writeError != 0) {
+        std::string reason = std::strerror(writeError);
+        THROW_FORMATTED(
+            std::runtime_error,
+            "Writing {} failed: {}",
+            fileName,
+            reason
+        );
+    }
+}
+
+uint64_t randomSeed() {
+    std::random_device rd;
+    return (static_cast<uint64_t>(rd()) << 32) | rd();
+}
@@ -0,0 +1,103 @@
+#ifndef GENERATOR_HPP
+#define GENERATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class Distribution {
+    // Random length and random characters
+    UNIFORM,
+    // Already in ascending order
+    SORTED,
+    // In descending order
+    REVERSE,
+    // Sorted, but a given percentage of the records is replaced by random ones
+    NEARLY_SORTED,
+    // Only a small pool of distinct records, each picked uniformly
+    DUPLICATES,
+    // A pool of distinct records picked with a Zipf distributed frequency
+    ZIPF,
+    // All records share one long prefix and differ only in a short suffix
+    PREFIX,
+    // Random characters, every record uses the full width
+    FIXED_LENGTH,
+};
+
+std::optional<Distribution> parseDistribution(std::string_view name);
+std::string_view distributionName(Distribution distribution);
+
+struct GeneratorConfig {
+    size_t recordWidth;
+    size_t recordCount;
+    bool numbersOnly = false;
+    uint64_t seed = 0;
+    Distribution distribution = Distribution::UNIFORM;
+    // Percentage of records replaced in Distribution::NEARLY_SORTED
+    double perturbPercent = 5.0;
+    // Pool size of Distribution::DUPLICATES and Distribution::ZIPF
+    size_t distinctCount = 100;
+    // Exponent of Distribution::ZIPF
+    double zipfSkew = 1.0;
+};
+
+// Produces records in fixed size blocks. Every block gets its own engine
+// seeded from the global seed and the block index, and every ordered
+// distribution derives its keys from the record index, so the generated file
+// only depends on the config and not on how many threads wrote it.
+class RecordGenerator {
+   public:
+    // Records generated from one engine and written with one pwrite call
+    static constexpr size_t blockRecords = 1 << 15;
+
+    RecordGenerator(const GeneratorConfig& config);
+
+    const GeneratorConfig& getConfig() const { return config; }
+    size_t getRecordWidth() const { return config.recordWidth; }
+    size_t getBlockBytes() const { return blockRecords * config.recordWidth; }
+
+    // Fills `out` with `count` records (count * recordWidth bytes) of the
+    // block with the given index. Unused bytes of a record are '\0'.
+    void fillBlock(size_t blockIndex, size_t count, char* out) const;
+
+   private:
+    using Engine = std::default_random_engine;
+
+    void generateRecord(Engine& rng, size_t recordIndex, char* out) const;
+    // Random characters up to a random length in [minLen, width]
+    void generateRandomRecord(Engine& rng, char* out, size_t minLen = 1) const;
+    // Writes `value` as a fixed width number in the key alphabet followed by
+    // a random tail, so records compare in the order of their value
+    void generateOrderedRecord(Engine& rng, size_t value, char* out) const;
+    void copyPoolRecord(size_t poolIndex, char* out) const;
+
+    char randomChar(Engine& rng) const;
+    char digitChar(size_t digit) const;
+    size_t alphabetSize() const;
+
+    GeneratorConfig config;
+    // Number of key characters needed to encode every record index
+    size_t keyLen = 1;
+    // Records that DUPLICATES and ZIPF pick from, each recordWidth bytes
+    std::vector<char> pool;
+    // Cumulative probabilities of the pool entries for ZIPF
+    std::vector<double> zipfCdf;
+    // Shared part of every record for PREFIX
+    std::string prefix;
+};
+
+// Streams every record of the generator to `fileName` block by block. Blocks
+// are spread over `threadCount` threads, each writing at its own offset.
+void writeGeneratedFile(
+    const std::string& fileName, const RecordGenerator& generator,
+    size_t threadCount
+);
+
+// Seed used when the user did not ask for a reproducible dataset
+uint64_t randomSeed();
+
+#endif  // !GENERATOR_HPP
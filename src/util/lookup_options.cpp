@@ -0,0 +1,97 @@
+#include "lookup_options.hpp"
+
+#include <iostream>
+#include <string>
+
+#include "fence_index.hpp"
+
+LookupOptions::LookupOptions(int argc, char** argv) : scriptName(argv[0]) {
+    parse(argc, argv);
+    checkRequired();
+}
+
+void LookupOptions::parse(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        parseArgument(argv[i], i, argc, argv);
+    }
+}
+
+void LookupOptions::parseArgument(
+    const std::string& arg, int& i, int argc, char** argv
+) {
+    if (arg.starts_with('-') && arg.size() > 1) {
+        handleFlag(arg, i, argc, argv);
+    } else {
+        positional.push_back(arg);
+    }
+}
+
+void LookupOptions::handleFlag(
+    const std::string& flag, int& i, int argc, char** argv
+) {
+    if ((flag == "-h") || (flag == "--help")) {
+        printHelpAndExit(0);
+    } else if ((flag == "-x") || (flag == "--index")) {
+        indexFileName = getVal(i, argc, argv);
+    } else if ((flag == "-c") || (flag == "--count")) {
+        countOnly = true;
+    } else if (flag == "--") {
+        // Everything after -- is a file name or a key, even with a leading -
+        while (i + 1 < argc) {
+            positional.push_back(argv[++i]);
+        }
+    } else {
+        std::cerr << "Error: Unknown argument '" << flag << "'\n";
+        printHelpAndExit();
+    }
+}
+
+std::string LookupOptions::getVal(int& i, int argc, char** argv) {
+    if (i + 1 >= argc) {
+        std::cerr << "Error: " << argv[i] << " requires a value.\n";
+        printHelpAndExit();
+    }
+    return argv[++i];
+}
+
+void LookupOptions::checkRequired() {
+    if (positional.size() < 2 || positional.size() > 3) {
+        std::cerr << "Error: A file name and one or two keys must be provided."
+                  << std::endl;
+        printHelpAndExit();
+    }
+
+    fileName = positional[0];
+    lowKey = positional[1];
+    highKey = positional.size() == 3 ? positional[2] : lowKey;
+    if (indexFileName.empty()) {
+        indexFileName = fenceIndexPath(fileName);
+    }
+
+    if (highKey < lowKey) {
+        std::cerr << "Error: The high key must not be smaller than the low key."
+                  << std::endl;
+        printHelpAndExit();
+    }
+}
+
+void LookupOptions::printHelpAndExit(int exitCode) const {
+    // clang-format off
+    std::cout <<
+        "Usage: " << scriptName << " [options] <fileName> <key> [<highKey>]\n\n"
+        "Prints the records equal to <key>, or between <key> and <highKey>\n"
+        "inclusive, of a file sorted with --index. Only the pages the index\n"
+        "points to are read. Exits with 0 when records were found, 1 when\n"
+        "none were and 2 on errors.\n\n"
+        "Options:\n"
+        "\t-h, --help\tShow this help message\n\n"
+        "\t-x, --index <file>\n"
+        "\t\tIndex of the file (default: <fileName>.idx)\n\n"
+        "\t-c, --count\tOnly print the number of records found\n\n"
+        "Arguments:\n"
+        "\t<fileName>\tRequired: Path to the sorted file\n"
+        "\t<key>\t\tRequired: Record to look up, or start of the range\n"
+        "\t<highKey>\tEnd of the range\n";
+    // clang-format on
+    exit(exitCode);
+}
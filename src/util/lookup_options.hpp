@@ -0,0 +1,46 @@
+#ifndef LOOKUP_OPTIONS_HPP
+#define LOOKUP_OPTIONS_HPP
+
+#include <string>
+#include <vector>
+
+class LookupOptions {
+   public:
+    LookupOptions(int argc, char** argv);
+
+    const std::string& getFileName() const { return fileName; }
+    // The index next to the file unless another one was given
+    const std::string& getIndexFileName() const { return indexFileName; }
+    const std::string& getLowKey() const { return lowKey; }
+    // Equal to the low key for a point query
+    const std::string& getHighKey() const { return highKey; }
+    bool isCountOnly() const { return countOnly; }
+
+   private:
+    void parse(int argc, char** argv);
+    void parseArgument(const std::string& arg, int& i, int argc, char** argv);
+    void handleFlag(const std::string& flag, int& i, int argc, char** argv);
+
+    /**
+     * Tries to get the next argument
+     *
+     * Returns it as string
+     *
+     * If the argument is missing, exits with a error message:
+     * `"Error: " << argv[i] << " requires a value.\n"`
+     */
+    std::string getVal(int& i, int argc, char** argv);
+
+    void checkRequired();
+    void printHelpAndExit(int exitCode = 2) const;
+
+    std::vector<std::string> positional;
+    std::string fileName;
+    std::string indexFileName;
+    std::string lowKey;
+    std::string highKey;
+    bool countOnly = false;
+    std::string scriptName;
+};
+
+#endif  // !LOOKUP_OPTIONS_HPP
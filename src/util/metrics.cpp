@@ -0,0 +1,510 @@
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <ctime>
+#include <format>
+#include <iterator>
+#include <ostream>
+
+// ============================================================================
+// LatencyHistogram
+// ============================================================================
+
+void LatencyHistogram::record(std::chrono::nanoseconds latency) {
+    uint64_t ns = std::max<int64_t>(latency.count(), 1);
+    size_t bucket = std::min<size_t>(std::bit_width(ns) - 1, bucketCount - 1);
+    buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+LatencyHistogram::Buckets LatencyHistogram::snapshot() const {
+    Buckets result{};
+    for (size_t i = 0; i < bucketCount; i++) {
+        result[i] = buckets[i].load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+// ============================================================================
+// IoSnapshot
+// ============================================================================
+
+IoSnapshot IoSnapshot::operator-(const IoSnapshot& other) const {
+    IoSnapshot d = *this;
+    d.pageReads -= other.pageReads;
+    d.pageWrites -= other.pageWrites;
+    d.bytesRead -= other.bytesRead;
+    d.bytesWritten -= other.bytesWritten;
+    d.syscalls -= other.syscalls;
+    d.readNs -= other.readNs;
+    d.writeNs -= other.writeNs;
+    for (size_t i = 0; i < LatencyHistogram::bucketCount; i++) {
+        d.readLatency[i] -= other.readLatency[i];
+        d.writeLatency[i] -= other.writeLatency[i];
+    }
+    return d;
+}
+
+IoSnapshot& IoSnapshot::operator+=(const IoSnapshot& other) {
+    pageReads += other.pageReads;
+    pageWrites += other.pageWrites;
+    bytesRead += other.bytesRead;
+    bytesWritten += other.bytesWritten;
+    syscalls += other.syscalls;
+    readNs += other.readNs;
+    writeNs += other.writeNs;
+    for (size_t i = 0; i < LatencyHistogram::bucketCount; i++) {
+        readLatency[i] += other.readLatency[i];
+        writeLatency[i] += other.writeLatency[i];
+    }
+    return *this;
+}
+
+bool IoSnapshot::empty() const {
+    return pageReads == 0 && pageWrites == 0 && bytesRead == 0 &&
+           bytesWritten == 0 && syscalls == 0;
+}
+
+// ============================================================================
+// FileMetrics
+// ============================================================================
+
+FileMetrics::FileMetrics(std::string name, std::string role)
+    : name(std::move(name)), role(std::move(role)) {}
+
+void FileMetrics::recordPageRead(
+    size_t bytes, size_t calls, std::chrono::nanoseconds latency
+) {
+    pageReads.fetch_add(1, std::memory_order_relaxed);
+    recordRead(bytes, calls, latency);
+}
+
+void FileMetrics::recordPageWrite(
+    size_t bytes, size_t calls, std::chrono::nanoseconds latency
+) {
+    pageWrites.fetch_add(1, std::memory_order_relaxed);
+    recordWrite(bytes, calls, latency);
+}
+
+void FileMetrics::recordRead(
+    size_t bytes, size_t calls, std::chrono::nanoseconds latency
+) {
+    bytesRead.fetch_add(bytes, std::memory_order_relaxed);
+    syscalls.fetch_add(calls, std::memory_order_relaxed);
+    readNs.fetch_add(latency.count(), std::memory_order_relaxed);
+    readLatency.record(latency);
+}
+
+void FileMetrics::recordWrite(
+    size_t bytes, size_t calls, std::chrono::nanoseconds latency
+) {
+    bytesWritten.fetch_add(bytes, std::memory_order_relaxed);
+    syscalls.fetch_add(calls, std::memory_order_relaxed);
+    writeNs.fetch_add(latency.count(), std::memory_order_relaxed);
+    writeLatency.record(latency);
+}
+
+void FileMetrics::recordSyscalls(size_t count) {
+    syscalls.fetch_add(count, std::memory_order_relaxed);
+}
+
+IoSnapshot FileMetrics::snapshot() const {
+    IoSnapshot s;
+    s.pageReads = pageReads.load(std::memory_order_relaxed);
+    s.pageWrites = pageWrites.load(std::memory_order_relaxed);
+    s.bytesRead = bytesRead.load(std::memory_order_relaxed);
+    s.bytesWritten = bytesWritten.load(std::memory_order_relaxed);
+    s.syscalls = syscalls.load(std::memory_order_relaxed);
+    s.readNs = readNs.load(std::memory_order_relaxed);
+    s.writeNs = writeNs.load(std::memory_order_relaxed);
+    s.readLatency = readLatency.snapshot();
+    s.writeLatency = writeLatency.snapshot();
+    return s;
+}
+
+// ============================================================================
+// Metrics
+// ============================================================================
+
+Metrics& Metrics::instance() {
+    static Metrics metrics;
+    return metrics;
+}
+
+std::shared_ptr<FileMetrics> Metrics::registerFile(
+    const std::string& name, const std::string& role
+) {
+    auto file = std::make_shared<FileMetrics>(name, role);
+    std::lock_guard lock(mutex);
+    if (!openPhase.has_value()) {
+        dropClosedFilesLocked();
+    }
+    files.push_back({file, {}});
+    return file;
+}
+
+void Metrics::beginPhase(const std::string& name) {
+    std::lock_guard lock(mutex);
+    endPhaseLocked();
+    dropClosedFilesLocked();
+
+    OpenPhase phase{
+        .name = name,
+        .wallStart = std::chrono::steady_clock::now(),
+        .cpuStartMs = processCpuTimeMs(),
+        .records = 0,
+        .peakDiskUsage = diskUsage,
+        .countersStart = PerfCounters::instance().read(),
+        .fileStart = {},
+    };
+    for (const auto& f : files) {
+        phase.fileStart.push_back(f.metrics->snapshot());
+    }
+    openPhase = std::move(phase);
+}
+
+void Metrics::endPhase() {
+    std::lock_guard lock(mutex);
+    endPhaseLocked();
+    dropClosedFilesLocked();
+}
+
+void Metrics::addRecords(uint64_t count) {
+    std::lock_guard lock(mutex);
+    if (openPhase.has_value()) {
+        openPhase->records += count;
+    }
+}
+
+void Metrics::addDiskUsage(int64_t delta) {
+    std::lock_guard lock(mutex);
+    // NOTE: A file measures what it takes on disk, so a delta can never
+    // take away more than was added
+    diskUsage = delta < 0 ? diskUsage - std::min<uint64_t>(diskUsage, -delta)
+                          : diskUsage + delta;
+    peakDiskUsage = std::max(peakDiskUsage, diskUsage);
+    if (openPhase.has_value()) {
+        openPhase->peakDiskUsage =
+            std::max(openPhase->peakDiskUsage, diskUsage);
+    }
+}
+
+uint64_t Metrics::getPeakDiskUsage() const {
+    std::lock_guard lock(mutex);
+    return peakDiskUsage;
+}
+
+void Metrics::addSection(
+    const std::string& name,
+    uint64_t records,
+    double wallMs,
+    const PerfCounters::Counts& counters,
+    bool counted
+) {
+    std::lock_guard lock(mutex);
+    auto it = std::ranges::find(sections, name, &SectionMetrics::name);
+    if (it == sections.end()) {
+        SectionMetrics section;
+        section.name = name;
+        sections.push_back(section);
+        it = std::prev(sections.end());
+    }
+    it->calls++;
+    it->records += records;
+    it->wallMs += wallMs;
+    it->counters += counters;
+    if (!counted) {
+        it->uncountedCalls++;
+    }
+}
+
+void Metrics::endPhaseLocked() {
+    if (!openPhase.has_value()) {
+        return;
+    }
+
+    PhaseMetrics phase;
+    phase.name = openPhase->name;
+    phase.wallMs = std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - openPhase->wallStart
+    )
+                       .count();
+    phase.cpuMs = processCpuTimeMs() - openPhase->cpuStartMs;
+    phase.records = openPhase->records;
+    phase.peakDiskBytes = openPhase->peakDiskUsage;
+    phase.counters =
+        PerfCounters::instance().read() - openPhase->countersStart;
+
+    for (size_t i = 0; i < files.size(); i++) {
+        // Files opened during the phase started from zero
+        IoSnapshot start = i < openPhase->fileStart.size()
+                               ? openPhase->fileStart[i]
+                               : IoSnapshot{};
+        const FileMetrics& file = *files[i].metrics;
+        IoSnapshot delta = file.snapshot() - start;
+        if (!delta.empty()) {
+            phase.files.push_back({file.getName(), file.getRole(), delta});
+        }
+    }
+
+    phases.push_back(std::move(phase));
+    openPhase.reset();
+}
+
+void Metrics::dropClosedFilesLocked() {
+    // NOTE: Only the registry holds the metrics of a closed file, and nothing
+    // can get hold of them again
+    std::erase_if(files, [&](const RegisteredFile& f) {
+        if (f.metrics.use_count() != 1) {
+            return false;
+        }
+        closedTotals += f.metrics->snapshot() - f.base;
+        return true;
+    });
+}
+
+void Metrics::reset() {
+    std::lock_guard lock(mutex);
+    openPhase.reset();
+    dropClosedFilesLocked();
+    for (auto& f : files) {
+        f.base = f.metrics->snapshot();
+    }
+    closedTotals = {};
+    phases.clear();
+    sections.clear();
+    // Files still open keep taking their space
+    peakDiskUsage = diskUsage;
+}
+
+IoSnapshot Metrics::totals() const {
+    std::lock_guard lock(mutex);
+    IoSnapshot total = closedTotals;
+    for (const auto& f : files) {
+        total += f.metrics->snapshot() - f.base;
+    }
+    return total;
+}
+
+std::vector<PhaseMetrics> Metrics::getPhases() const {
+    std::lock_guard lock(mutex);
+    return phases;
+}
+
+std::vector<SectionMetrics> Metrics::getSections() const {
+    std::lock_guard lock(mutex);
+    return sections;
+}
+
+static void writeHistogramJson(
+    std::ostream& os, const LatencyHistogram::Buckets& buckets
+) {
+    os << "[";
+    bool first = true;
+    for (size_t i = 0; i < buckets.size(); i++) {
+        if (buckets[i] == 0) {
+            continue;
+        }
+        os << (first ? "" : ", ")
+           << std::format(
+                  "{{\"ge_ns\": {}, \"count\": {}}}", 1ull << i, buckets[i]
+              );
+        first = false;
+    }
+    os << "]";
+}
+
+static void writeIoJson(std::ostream& os, const IoSnapshot& io) {
+    os << std::format(
+        "\"page_reads\": {}, \"page_writes\": {}, \"bytes_read\": {}, "
+        "\"bytes_written\": {}, \"syscalls\": {}, \"read_ns\": {}, "
+        "\"write_ns\": {}, \"read_latency\": ",
+        io.pageReads,
+        io.pageWrites,
+        io.bytesRead,
+        io.bytesWritten,
+        io.syscalls,
+        io.readNs,
+        io.writeNs
+    );
+    writeHistogramJson(os, io.readLatency);
+    os << ", \"write_latency\": ";
+    writeHistogramJson(os, io.writeLatency);
+}
+
+// Only the counters that could be read are written, with the per record
+// ratios next to them
+static void writeCountersJson(
+    std::ostream& os, const PerfCounters::Counts& counters, uint64_t records
+) {
+    os << "{";
+    bool first = true;
+    for (size_t i = 0; i < PerfCounters::COUNTER_COUNT; i++) {
+        if (!counters.available[i]) {
+            continue;
+        }
+        auto name = PerfCounters::counterName(PerfCounters::Counter(i));
+        os << (first ? "" : ", ")
+           << std::format("\"{}\": {}", name, counters.values[i]);
+        if (records != 0) {
+            os << std::format(
+                ", \"{}_per_record\": {:.3f}",
+                name,
+                static_cast<double>(counters.values[i]) / records
+            );
+        }
+        first = false;
+    }
+    os << "}";
+}
+
+// File names are paths chosen by the user, so quotes, backslashes and every
+// control character need escaping
+static std::string jsonEscape(const std::string& str) {
+    std::string out;
+    for (char c : str) {
+        switch (c) {
+            case '"':
+            case '\\':
+                out += '\\';
+                out += c;
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    out += std::format(
+                        "\\u{:04x}", static_cast<unsigned char>(c)
+                    );
+                } else {
+                    out += c;
+                }
+        }
+    }
+    return out;
+}
+
+void Metrics::writeJson(std::ostream& os) const {
+    auto phaseList = getPhases();
+    IoSnapshot total = totals();
+
+    double wallMs = 0;
+    double cpuMs = 0;
+    for (const auto& p : phaseList) {
+        wallMs += p.wallMs;
+        cpuMs += p.cpuMs;
+    }
+
+    os << "{\n  \"totals\": {"
+       << std::format(
+              "\"wall_ms\": {:.3f}, \"cpu_ms\": {:.3f}, "
+              "\"peak_disk_bytes\": {}, ",
+              wallMs,
+              cpuMs,
+              getPeakDiskUsage()
+          );
+    writeIoJson(os, total);
+    os << "},\n  \"phases\": [";
+
+    for (size_t i = 0; i < phaseList.size(); i++) {
+        const auto& p = phaseList[i];
+        os << (i == 0 ? "\n" : ",\n")
+           << std::format(
+                  "    {{\"name\": \"{}\", \"wall_ms\": {:.3f}, "
+                  "\"cpu_ms\": {:.3f}, \"records\": {}, "
+                  "\"peak_disk_bytes\": {}, \"counters\": ",
+                  jsonEscape(p.name),
+                  p.wallMs,
+                  p.cpuMs,
+                  p.records,
+                  p.peakDiskBytes
+              );
+        writeCountersJson(os, p.counters, p.records);
+        os << ", \"files\": [";
+        for (size_t j = 0; j < p.files.size(); j++) {
+            const auto& f = p.files[j];
+            os << (j == 0 ? "\n" : ",\n")
+               << std::format(
+                      "      {{\"name\": \"{}\", \"role\": \"{}\", ",
+                      jsonEscape(f.name),
+                      jsonEscape(f.role)
+                  );
+            writeIoJson(os, f.io);
+            os << "}";
+        }
+        os << (p.files.empty() ? "]}" : "\n    ]}");
+    }
+    os << (phaseList.empty() ? "],\n" : "\n  ],\n");
+
+    auto sectionList = getSections();
+    os << "  \"sections\": [";
+    for (size_t i = 0; i < sectionList.size(); i++) {
+        const auto& s = sectionList[i];
+        os << (i == 0 ? "\n" : ",\n")
+           << std::format(
+                  "    {{\"name\": \"{}\", \"calls\": {}, \"records\": {}, "
+                  "\"wall_ms\": {:.3f}, \"uncounted_calls\": {}, "
+                  "\"counters\": ",
+                  jsonEscape(s.name),
+                  s.calls,
+                  s.records,
+                  s.wallMs,
+                  s.uncountedCalls
+              );
+        writeCountersJson(os, s.counters, s.records);
+        os << "}";
+    }
+    os << (sectionList.empty() ? "]\n}\n" : "\n  ]\n}\n");
+}
+
+// ============================================================================
+// PhaseScope
+// ============================================================================
+
+PhaseScope::PhaseScope(const std::string& name) {
+    Metrics::instance().beginPhase(name);
+}
+
+PhaseScope::~PhaseScope() { Metrics::instance().endPhase(); }
+
+// ============================================================================
+// SectionScope
+// ============================================================================
+
+SectionScope::SectionScope(const char* name, uint64_t records)
+    : name(name),
+      records(records),
+      wallStart(std::chrono::steady_clock::now()),
+      counted(PerfCounters::instance().isCountingThisThread()),
+      countersStart(
+          counted ? PerfCounters::instance().read() : PerfCounters::Counts{}
+      ) {}
+
+SectionScope::~SectionScope() {
+    double wallMs = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - wallStart
+    )
+                        .count();
+    const auto& counters = PerfCounters::instance();
+    // NOTE: Without open counters no call is counted, none is missed either
+    Metrics::instance().addSection(
+        name,
+        records,
+        wallMs,
+        counted ? counters.read() - countersStart : PerfCounters::Counts{},
+        counted || !counters.isOpen()
+    );
+}
+
+double processCpuTimeMs() {
+    timespec ts{};
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
@@ -0,0 +1,240 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "perf_counters.hpp"
+
+// Latencies bucketed by powers of two, bucket i counts [2^i, 2^(i+1)) ns
+class LatencyHistogram {
+   public:
+    static constexpr size_t bucketCount = 40;
+    using Buckets = std::array<uint64_t, bucketCount>;
+
+    void record(std::chrono::nanoseconds latency);
+    Buckets snapshot() const;
+
+   private:
+    std::array<std::atomic<uint64_t>, bucketCount> buckets{};
+};
+
+// Plain copy of the counters of a file at one point in time
+struct IoSnapshot {
+    uint64_t pageReads = 0;
+    uint64_t pageWrites = 0;
+    uint64_t bytesRead = 0;
+    uint64_t bytesWritten = 0;
+    uint64_t syscalls = 0;
+    uint64_t readNs = 0;
+    uint64_t writeNs = 0;
+    LatencyHistogram::Buckets readLatency{};
+    LatencyHistogram::Buckets writeLatency{};
+
+    IoSnapshot operator-(const IoSnapshot& other) const;
+    IoSnapshot& operator+=(const IoSnapshot& other);
+    bool empty() const;
+};
+
+// I/O counters of a single file. They are atomic, so one file can be used
+// from several threads and read while it is being written.
+class FileMetrics {
+   public:
+    FileMetrics(std::string name, std::string role);
+
+    // A whole page went through the file, `bytes` were moved by `syscalls`
+    // calls in `latency`
+    void recordPageRead(
+        size_t bytes, size_t syscalls, std::chrono::nanoseconds latency
+    );
+    void recordPageWrite(
+        size_t bytes, size_t syscalls, std::chrono::nanoseconds latency
+    );
+    // Reads and writes that are not a page, like the final copy
+    void recordRead(
+        size_t bytes, size_t syscalls, std::chrono::nanoseconds latency
+    );
+    void recordWrite(
+        size_t bytes, size_t syscalls, std::chrono::nanoseconds latency
+    );
+    // Calls that move no data, like fstat or ftruncate
+    void recordSyscalls(size_t count);
+
+    IoSnapshot snapshot() const;
+
+    const std::string& getName() const { return name; }
+    const std::string& getRole() const { return role; }
+
+   private:
+    const std::string name;
+    const std::string role;
+
+    std::atomic<uint64_t> pageReads = 0;
+    std::atomic<uint64_t> pageWrites = 0;
+    std::atomic<uint64_t> bytesRead = 0;
+    std::atomic<uint64_t> bytesWritten = 0;
+    std::atomic<uint64_t> syscalls = 0;
+    std::atomic<uint64_t> readNs = 0;
+    std::atomic<uint64_t> writeNs = 0;
+    LatencyHistogram readLatency;
+    LatencyHistogram writeLatency;
+};
+
+struct FilePhaseMetrics {
+    std::string name;
+    std::string role;
+    IoSnapshot io;
+};
+
+struct PhaseMetrics {
+    std::string name;
+    double wallMs = 0;
+    double cpuMs = 0;
+    // Records that went through the phase, as reported by addRecords()
+    uint64_t records = 0;
+    // Most bytes the open files took on disk at once during the phase
+    uint64_t peakDiskBytes = 0;
+    // Hardware counters, empty unless PerfCounters were opened
+    PerfCounters::Counts counters;
+    std::vector<FilePhaseMetrics> files;
+};
+
+// A piece of work that runs many times inside the phases, e.g. sorting the
+// buffers of a run. Its time and counters are summed over every call.
+struct SectionMetrics {
+    std::string name;
+    uint64_t calls = 0;
+    uint64_t records = 0;
+    double wallMs = 0;
+    PerfCounters::Counts counters;
+    // Calls on a thread other than the one that opened the counters, which
+    // are not in `counters`, see PerfCounters::isCountingThisThread
+    uint64_t uncountedCalls = 0;
+};
+
+// Process wide registry of every file and every phase of a sort. Files
+// register themselves when they are opened, the sorter marks the phases and
+// the counters of each file are split between them.
+//
+// Closed files are dropped between phases, only their counters are kept in
+// the totals. Phases and sections are kept until reset(), so a long running
+// process resets between sorts. There is a single open phase, so sorts on
+// several threads at once end each other's phases and mix their I/O.
+class Metrics {
+   public:
+    static Metrics& instance();
+
+    std::shared_ptr<FileMetrics> registerFile(
+        const std::string& name, const std::string& role
+    );
+
+    // Ends the current phase, if any, and starts a new one
+    void beginPhase(const std::string& name);
+    void endPhase();
+    // Counts records processed by the current phase
+    void addRecords(uint64_t count);
+    // Adds one call of a section, see SectionScope
+    void addSection(
+        const std::string& name,
+        uint64_t records,
+        double wallMs,
+        const PerfCounters::Counts& counters,
+        bool counted = true
+    );
+
+    // The bytes every open file takes on disk changed by `delta`. Files
+    // report it as they grow, shrink or are closed.
+    void addDiskUsage(int64_t delta);
+    // Most bytes the open files took on disk at once since the last reset
+    uint64_t getPeakDiskUsage() const;
+
+    // Forgets every phase, section and closed file. Files that are still
+    // open count from zero again.
+    void reset();
+
+    // Sum over every file since the last reset
+    IoSnapshot totals() const;
+    std::vector<PhaseMetrics> getPhases() const;
+    std::vector<SectionMetrics> getSections() const;
+
+    // Writes every phase and the totals as a single JSON object
+    void writeJson(std::ostream& os) const;
+
+   private:
+    Metrics() = default;
+
+    struct OpenPhase {
+        std::string name;
+        std::chrono::steady_clock::time_point wallStart;
+        double cpuStartMs;
+        uint64_t records = 0;
+        uint64_t peakDiskUsage = 0;
+        PerfCounters::Counts countersStart;
+        std::vector<IoSnapshot> fileStart;
+    };
+
+    struct RegisteredFile {
+        std::shared_ptr<FileMetrics> metrics;
+        // Counters of the file at the last reset
+        IoSnapshot base;
+    };
+
+    void endPhaseLocked();
+    // Only between phases, which refer to the files by their position
+    void dropClosedFilesLocked();
+
+    mutable std::mutex mutex;
+    std::vector<RegisteredFile> files;
+    // Counters of the files closed since the last reset
+    IoSnapshot closedTotals;
+    std::vector<PhaseMetrics> phases;
+    std::vector<SectionMetrics> sections;
+    std::optional<OpenPhase> openPhase;
+    uint64_t diskUsage = 0;
+    uint64_t peakDiskUsage = 0;
+};
+
+// Marks a phase for as long as it is alive
+class PhaseScope {
+   public:
+    PhaseScope(const std::string& name);
+    ~PhaseScope();
+
+    PhaseScope(const PhaseScope&) = delete;
+    PhaseScope& operator=(const PhaseScope&) = delete;
+};
+
+// Adds the time and hardware counters from its construction to its destruction
+// to a section. The counters are only read when they are open, so this is
+// cheap enough for code that runs once per run or merge group. On a thread
+// other than the one that opened them, e.g. the sorter of a pipeline, they
+// are not read and the call is counted as uncounted instead.
+class SectionScope {
+   public:
+    SectionScope(const char* name, uint64_t records = 0);
+    ~SectionScope();
+
+    SectionScope(const SectionScope&) = delete;
+    SectionScope& operator=(const SectionScope&) = delete;
+
+   private:
+    const char* name;
+    uint64_t records;
+    std::chrono::steady_clock::time_point wallStart;
+    bool counted;
+    PerfCounters::Counts countersStart;
+};
+
+// CPU time used by the whole process in milliseconds
+double processCpuTimeMs();
+
+#endif  // !METRICS_HPP
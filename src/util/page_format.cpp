@@ -0,0 +1,261 @@
+#include "page_format.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include "error.hpp"
+
+std::optional<PageFormat> parsePageFormat(std::string_view name) {
+    if (name == "fixed") {
+        return PageFormat::FIXED;
+    }
+    if (name == "variable") {
+        return PageFormat::VARIABLE;
+    }
+    if (name == "prefix") {
+        return PageFormat::PREFIX;
+    }
+    return std::nullopt;
+}
+
+std::string_view pageFormatName(PageFormat format) {
+    switch (format) {
+        case PageFormat::FIXED:
+            return "fixed";
+        case PageFormat::VARIABLE:
+            return "variable";
+        case PageFormat::PREFIX:
+            return "prefix";
+    }
+    return "unknown";
+}
+
+// Integers in the variable format are 16 bit little endian
+static uint16_t loadU16(const char* p) {
+    auto b = reinterpret_cast<const unsigned char*>(p);
+    return static_cast<uint16_t>(b[0] | (b[1] << 8));
+}
+
+static void storeU16(char* p, size_t value) {
+    p[0] = static_cast<char>(value & 0xff);
+    p[1] = static_cast<char>((value >> 8) & 0xff);
+}
+
+// Size of a slot, the offset of the record within the page
+static constexpr size_t slotSize = 2;
+// Size of the length that precedes every record
+static constexpr size_t lengthSize = 1;
+
+// Length of the prefix two records share
+static size_t sharedPrefix(std::string_view a, std::string_view b) {
+    auto [itA, itB] = std::ranges::mismatch(a, b);
+    return itA - a.begin();
+}
+
+template <size_t RecordLen>
+PageCodec<RecordLen>::PageCodec(PageFormat format, size_t pageSize)
+    : format(format),
+      pageSize(pageSize),
+      recordsPerPage(pageSize / RecordLen) {
+    static_assert(
+        RecordLen <= std::numeric_limits<uint8_t>::max(),
+        "The variable page format stores record lengths in one byte"
+    );
+    // Offsets and record counts are stored in 16 bits
+    if (!isFixed() && pageSize > std::numeric_limits<uint16_t>::max()) {
+        THROW_FORMATTED(
+            std::invalid_argument,
+            "Pages of the {} format can hold at most {} bytes, got {}",
+            pageFormatName(format),
+            std::numeric_limits<uint16_t>::max(),
+            pageSize
+        );
+    }
+    if (!isFixed() &&
+        pageSize < headerSize + slotSize + lengthSize + RecordLen) {
+        THROW_FORMATTED(
+            std::invalid_argument,
+            "Pages of {} bytes can not hold a record of width {}",
+            pageSize,
+            RecordLen
+        );
+    }
+}
+
+template <size_t RecordLen>
+size_t PageCodec<RecordLen>::capacity() const {
+    return isFixed() ? pageSize : pageSize - headerSize;
+}
+
+template <size_t RecordLen>
+size_t PageCodec<RecordLen>::recordCost(
+    const Record& r, const Record* previous
+) const {
+    switch (format) {
+        case PageFormat::FIXED:
+            return RecordLen;
+        case PageFormat::VARIABLE:
+            return slotSize + lengthSize + r.str().size();
+        case PageFormat::PREFIX: {
+            auto str = r.str();
+            size_t shared =
+                previous != nullptr ? sharedPrefix(previous->str(), str) : 0;
+            return 2 * lengthSize + str.size() - shared;
+        }
+    }
+    return RecordLen;
+}
+
+template <size_t RecordLen>
+void PageCodec<RecordLen>::encode(
+    const std::vector<Record>& records, std::vector<char>& bytes
+) const {
+    bytes.resize(pageSize);
+    std::ranges::fill(bytes, '\0');
+
+    if (isFixed()) {
+        char* out = bytes.data();
+        for (size_t i = 0; i < records.size() && i < recordsPerPage; i++) {
+            std::memcpy(out, records[i].data().data(), RecordLen);
+            out += RecordLen;
+        }
+        return;
+    }
+
+    size_t used = 0;
+    for (size_t i = 0; i < records.size(); i++) {
+        used += recordCost(records[i], i > 0 ? &records[i - 1] : nullptr);
+    }
+    if (used > capacity()) {
+        THROW_FORMATTED(
+            std::length_error,
+            "{} records need {} bytes, a page only has room for {}",
+            records.size(),
+            used,
+            capacity()
+        );
+    }
+
+    storeU16(bytes.data(), records.size());
+    if (format == PageFormat::PREFIX) {
+        char* out = bytes.data() + headerSize;
+        std::string_view previous;
+        for (const auto& r : records) {
+            auto str = r.str();
+            size_t shared = sharedPrefix(previous, str);
+            out[0] = static_cast<char>(shared);
+            out[1] = static_cast<char>(str.size() - shared);
+            std::memcpy(out + 2, str.data() + shared, str.size() - shared);
+            out += 2 * lengthSize + str.size() - shared;
+            previous = str;
+        }
+        return;
+    }
+
+    char* slot = bytes.data() + headerSize;
+    size_t end = pageSize;
+    for (const auto& r : records) {
+        auto str = r.str();
+        end -= lengthSize + str.size();
+        bytes[end] = static_cast<char>(str.size());
+        std::memcpy(bytes.data() + end + lengthSize, str.data(), str.size());
+        storeU16(slot, end);
+        slot += slotSize;
+    }
+}
+
+template <size_t RecordLen>
+void PageCodec<RecordLen>::decode(
+    const std::vector<char>& bytes, std::vector<Record>& records
+) const {
+    records.clear();
+
+    if (isFixed()) {
+        records.reserve(recordsPerPage);
+        for (size_t i = 0; i < recordsPerPage; i++) {
+            records.emplace_back(
+                std::string_view(bytes.data() + i * RecordLen, RecordLen)
+            );
+        }
+        return;
+    }
+
+    size_t count = recordCountFromHeader(bytes.data());
+    if (headerSize + count * slotSize > pageSize) {
+        THROW_FORMATTED(
+            std::runtime_error, "Corrupt page, {} records do not fit", count
+        );
+    }
+
+    records.reserve(count);
+    if (format == PageFormat::PREFIX) {
+        decodePrefix(bytes, count, records);
+        return;
+    }
+
+    const char* slot = bytes.data() + headerSize;
+    for (size_t i = 0; i < count; i++, slot += slotSize) {
+        size_t offset = loadU16(slot);
+        size_t len = offset < pageSize
+                         ? static_cast<unsigned char>(bytes[offset])
+                         : 0;
+        if (offset + lengthSize + len > pageSize || len > RecordLen) {
+            THROW_FORMATTED(
+                std::runtime_error,
+                "Corrupt page, record {} lies outside of the page",
+                i
+            );
+        }
+        records.emplace_back(
+            std::string_view(bytes.data() + offset + lengthSize, len)
+        );
+    }
+}
+
+template <size_t RecordLen>
+void PageCodec<RecordLen>::decodePrefix(
+    const std::vector<char>& bytes, size_t count, std::vector<Record>& records
+) const {
+    // Every record is rebuilt on top of the one before it
+    std::array<char, RecordLen> current{};
+    size_t offset = headerSize;
+    for (size_t i = 0; i < count; i++) {
+        if (offset + 2 * lengthSize > pageSize) {
+            THROW_FORMATTED(
+                std::runtime_error,
+                "Corrupt page, record {} lies outside of the page",
+                i
+            );
+        }
+        size_t shared = static_cast<unsigned char>(bytes[offset]);
+        size_t rest = static_cast<unsigned char>(bytes[offset + 1]);
+        offset += 2 * lengthSize;
+        if (shared + rest > RecordLen || offset + rest > pageSize ||
+            (i == 0 && shared != 0)) {
+            THROW_FORMATTED(
+                std::runtime_error,
+                "Corrupt page, record {} lies outside of the page",
+                i
+            );
+        }
+        std::memcpy(current.data() + shared, bytes.data() + offset, rest);
+        std::fill(
+            current.begin() + shared + rest, current.end(), static_cast<char>(0)
+        );
+        offset += rest;
+        records.emplace_back(std::string_view(current.data(), RecordLen));
+    }
+}
+
+template <size_t RecordLen>
+size_t PageCodec<RecordLen>::recordCountFromHeader(const char* header) const {
+    return isFixed() ? recordsPerPage : loadU16(header);
+}
+
+#define INSTANTIATE_PAGE_CODEC(W) template class PageCodec<W>;
+FOR_EACH_RECORD_WIDTH(INSTANTIATE_PAGE_CODEC)
+#undef INSTANTIATE_PAGE_CODEC
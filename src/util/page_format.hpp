@@ -0,0 +1,80 @@
+#ifndef PAGE_FORMAT_HPP
+#define PAGE_FORMAT_HPP
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "record.hpp"
+
+// How the records of a page are laid out on disk. Every page of a file has
+// the same size in bytes, the format decides how many records fit in it.
+enum class PageFormat {
+    // Every record takes the full record width, padded with '\0'. A page
+    // holds exactly recordsPerPage records.
+    FIXED,
+    // Slotted page: a record count, one slot per record with its offset and
+    // the records themselves, each prefixed with its length, packed from the
+    // end of the page. Short records take less space, so a page holds as
+    // many records as fit.
+    VARIABLE,
+    // Front coded page: a record count, then every record as the length of
+    // the prefix it shares with the record before it, the length of the rest
+    // and the rest itself. Records are only readable in order, which is all
+    // a sorted run needs, and the shared prefixes of neighbouring sorted
+    // records are stored once.
+    PREFIX,
+};
+
+std::optional<PageFormat> parsePageFormat(std::string_view name);
+std::string_view pageFormatName(PageFormat format);
+
+// Encodes and decodes the pages of one format and page size
+template <size_t RecordLen>
+class PageCodec {
+   public:
+    using Record = BasicRecord<RecordLen>;
+
+    PageCodec(PageFormat format, size_t pageSize);
+
+    PageFormat getFormat() const { return format; }
+    bool isFixed() const { return format == PageFormat::FIXED; }
+
+    // Bytes available to records and their bookkeeping
+    size_t capacity() const;
+    // Bytes `r` takes when appended to a page after `previous`, which is
+    // nullptr for the first record of a page
+    size_t recordCost(const Record& r, const Record* previous = nullptr) const;
+
+    // Writes `records` into `bytes`, which is resized to the page size. In
+    // the fixed format missing records are padded and extra ones dropped,
+    // otherwise the records must fit.
+    void encode(const std::vector<Record>& records, std::vector<char>& bytes)
+        const;
+    // Replaces `records` with the content of the page
+    void decode(const std::vector<char>& bytes, std::vector<Record>& records)
+        const;
+
+    // Number of records stored in a page given its first bytes. Only needed
+    // by the variable and prefix formats, whose count is in the header.
+    static constexpr size_t headerSize = 2;
+    size_t recordCountFromHeader(const char* header) const;
+
+   private:
+    void decodePrefix(
+        const std::vector<char>& bytes,
+        size_t count,
+        std::vector<Record>& records
+    ) const;
+
+    PageFormat format;
+    size_t pageSize;
+    size_t recordsPerPage;
+};
+
+#define DECLARE_PAGE_CODEC(W) extern template class PageCodec<W>;
+FOR_EACH_RECORD_WIDTH(DECLARE_PAGE_CODEC)
+#undef DECLARE_PAGE_CODEC
+
+#endif  // !PAGE_FORMAT_HPP
@@ -0,0 +1,166 @@
+#include "perf_counters.hpp"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <thread>
+
+static int openCounter(uint64_t config) {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = 1;
+    // Counts the sorting threads as well, once they are joined
+    attr.inherit = 1;
+    // Kernel time is mostly page cache work, which the I/O metrics cover
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return static_cast<int>(
+        syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC)
+    );
+}
+
+// ============================================================================
+// Counts
+// ============================================================================
+
+auto PerfCounters::Counts::operator-(const Counts& other) const -> Counts {
+    Counts d = *this;
+    for (size_t i = 0; i < COUNTER_COUNT; i++) {
+        d.values[i] -= other.values[i];
+        d.available[i] = available[i] && other.available[i];
+    }
+    return d;
+}
+
+auto PerfCounters::Counts::operator+=(const Counts& other) -> Counts& {
+    for (size_t i = 0; i < COUNTER_COUNT; i++) {
+        values[i] += other.values[i];
+        available[i] = available[i] || other.available[i];
+    }
+    return *this;
+}
+
+bool PerfCounters::Counts::any() const {
+    for (bool a : available) {
+        if (a) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ============================================================================
+// PerfCounters
+// ============================================================================
+
+PerfCounters& PerfCounters::instance() {
+    static PerfCounters counters;
+    return counters;
+}
+
+std::string_view PerfCounters::counterName(Counter counter) {
+    switch (counter) {
+        case INSTRUCTIONS:
+            return "instructions";
+        case CYCLES:
+            return "cycles";
+        case CACHE_MISSES:
+            return "cache_misses";
+        case BRANCH_MISSES:
+            return "branch_misses";
+        default:
+            return "unknown";
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    for (int fd : fds) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+bool PerfCounters::open() {
+    if (isOpen()) {
+        return true;
+    }
+
+    static constexpr std::array<uint64_t, COUNTER_COUNT> configs{
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES,
+    };
+
+    int lastErrno = 0;
+    for (size_t i = 0; i < COUNTER_COUNT; i++) {
+        fds[i] = openCounter(configs[i]);
+        if (fds[i] < 0) {
+            lastErrno = errno;
+            continue;
+        }
+        ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    owner = std::this_thread::get_id();
+    if (!isOpen()) {
+        error = std::format(
+            "perf_event_open failed: {}{}",
+            std::strerror(lastErrno),
+            lastErrno == EACCES || lastErrno == EPERM
+                ? " (see /proc/sys/kernel/perf_event_paranoid)"
+                : ""
+        );
+        return false;
+    }
+    return true;
+}
+
+bool PerfCounters::isOpen() const {
+    for (int fd : fds) {
+        if (fd >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PerfCounters::isCountingThisThread() const {
+    return isOpen() && std::this_thread::get_id() == owner;
+}
+
+auto PerfCounters::read() const -> Counts {
+    Counts counts;
+    for (size_t i = 0; i < COUNTER_COUNT; i++) {
+        if (fds[i] < 0) {
+            continue;
+        }
+
+        // value, time enabled, time running
+        uint64_t data[3] = {};
+        if (::read(fds[i], data, sizeof(data)) != sizeof(data)) {
+            continue;
+        }
+
+        // When the CPU has fewer counters than requested the kernel
+        // multiplexes them, scale up to the time the counter was enabled
+        double scale = data[2] == 0 ? 0.0
+                                    : static_cast<double>(data[1]) /
+                                          static_cast<double>(data[2]);
+        counts.values[i] = static_cast<uint64_t>(data[0] * scale);
+        counts.available[i] = true;
+    }
+    return counts;
+}
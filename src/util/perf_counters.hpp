@@ -0,0 +1,60 @@
+#ifndef PERF_COUNTERS_HPP
+#define PERF_COUNTERS_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+
+// Hardware counters of the whole process, read through perf_event_open.
+// Counters the kernel or the CPU does not provide (containers, VMs,
+// perf_event_paranoid) are simply missing, nothing fails because of them.
+class PerfCounters {
+   public:
+    enum Counter : size_t {
+        INSTRUCTIONS,
+        CYCLES,
+        CACHE_MISSES,
+        BRANCH_MISSES,
+        COUNTER_COUNT,
+    };
+
+    // Counter values, only meaningful where `available` is set
+    struct Counts {
+        std::array<uint64_t, COUNTER_COUNT> values{};
+        std::array<bool, COUNTER_COUNT> available{};
+
+        Counts operator-(const Counts& other) const;
+        Counts& operator+=(const Counts& other);
+        bool any() const;
+    };
+
+    static PerfCounters& instance();
+    static std::string_view counterName(Counter counter);
+
+    // Opens and starts every counter. Threads created afterwards are counted
+    // too once they have been joined. Returns false if no counter could be
+    // opened, getError() then tells why.
+    bool open();
+    bool isOpen() const;
+    const std::string& getError() const { return error; }
+    // Whether the calling thread opened the counters. Another thread only
+    // adds to them once it is joined, so reading them on it misses its own
+    // work.
+    bool isCountingThisThread() const;
+
+    // Zero for every counter when not open
+    Counts read() const;
+
+   private:
+    PerfCounters() = default;
+    ~PerfCounters();
+
+    std::array<int, COUNTER_COUNT> fds{-1, -1, -1, -1};
+    std::thread::id owner;
+    std::string error;
+};
+
+#endif  // !PERF_COUNTERS_HPP
@@ -1,18 +1,13 @@
 #include <ostream>
 #include <record.hpp>
 
-Record const Record::empty = Record();
-
-Record::Record() : _data(Record::maxLen, '\0') {}
-Record::Record(const std::string& str) : _data(str) {}
-Record::Record(size_t count, char c) : _data(count, c) {}
-Record::Record(const char* cStr) : _data(cStr) {}
-
-const std::string& Record::data() const { return _data; }
-size_t Record::lenght() const { return _data.length(); }
-void Record::resize(size_t size) { _data.resize(size); }
-
-std::ostream& operator<<(std::ostream& os, const Record& r) {
+template <size_t MaxLen>
+std::ostream& operator<<(std::ostream& os, const BasicRecord<MaxLen>& r) {
     os << r.data();
     return os;
 }
+
+#define INSTANTIATE_RECORD(W) \
+    template std::ostream& operator<<(std::ostream&, const BasicRecord<W>&);
+FOR_EACH_RECORD_WIDTH(INSTANTIATE_RECORD)
+#undef INSTANTIATE_RECORD
@@ -1,30 +1,94 @@
 #ifndef RECORD_HPP
 #define RECORD_HPP
 
+#include <algorithm>
+#include <array>
+#include <compare>
 #include <cstddef>
+#include <cstring>
+#include <iosfwd>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
 
-class Record {
-   public:
-    static constexpr size_t maxLen = 30;
-    static const Record empty;
+#include "error.hpp"
+
+// Every record width listed here is explicitly instantiated in the extsort
+// library, and every program that takes -w dispatches to it. Adding a width to
+// this list supports it everywhere, only the help texts name the widths.
+#define FOR_EACH_RECORD_WIDTH(X) X(16) X(30) X(64)
 
-    Record();
-    Record(const std::string& str);
-    Record(size_t count, char c);
-    Record(const char* cStr);
+template <size_t MaxLen>
+class BasicRecord {
+   public:
+    static constexpr size_t maxLen = MaxLen;
+    static const BasicRecord empty;
 
-    const std::string& data() const;
-    size_t lenght() const;
-    void resize(size_t size);
+    constexpr BasicRecord() : _data{} {}
+    BasicRecord(std::string_view str) : _data{} {
+        std::memcpy(_data.data(), str.data(), std::min(str.size(), maxLen));
+    }
+    BasicRecord(const std::string& str) : BasicRecord(std::string_view(str)) {}
+    BasicRecord(const char* cStr) : BasicRecord(std::string_view(cStr)) {}
+    BasicRecord(size_t count, char c) : _data{} {
+        std::fill_n(_data.begin(), std::min(count, maxLen), c);
+    }
 
-    auto operator<=>(const Record& other) const = default;
-    bool operator==(const Record& other) const = default;
+    // Returns all maxLen bytes of the record, including the '\0' padding
+    std::string_view data() const { return {_data.data(), maxLen}; }
+    constexpr size_t lenght() const { return maxLen; }
+    // Returns the record without the '\0' padding
+    std::string_view str() const {
+        return {_data.data(), strnlen(_data.data(), maxLen)};
+    }
 
-    friend std::ostream& operator<<(std::ostream& os, const Record& r);
+    // Bytes are compared as unsigned chars, same as std::string and
+    // `LC_ALL=C sort`. The length is a constant so the compiler can inline the
+    // comparison for every width.
+    std::strong_ordering operator<=>(const BasicRecord& other) const {
+        return std::memcmp(_data.data(), other._data.data(), maxLen) <=> 0;
+    }
+    bool operator==(const BasicRecord& other) const = default;
 
    private:
-    std::string _data;
+    std::array<char, MaxLen> _data;
 };
 
+template <size_t MaxLen>
+const BasicRecord<MaxLen> BasicRecord<MaxLen>::empty = BasicRecord<MaxLen>();
+
+template <size_t MaxLen>
+std::ostream& operator<<(std::ostream& os, const BasicRecord<MaxLen>& r);
+
+// The default record width, as used by the original data format
+using Record = BasicRecord<30>;
+
+constexpr bool isSupportedRecordWidth(size_t width) {
+#define RECORD_WIDTH_CASE(W) \
+    if (width == W) {        \
+        return true;         \
+    }
+    FOR_EACH_RECORD_WIDTH(RECORD_WIDTH_CASE)
+#undef RECORD_WIDTH_CASE
+    return false;
+}
+
+// Selects the compile time record width matching the runtime one and calls
+// `f.template operator()<width>()`
+template <typename F>
+decltype(auto) dispatchRecordWidth(size_t width, F&& f) {
+#define RECORD_WIDTH_CASE(W)                                \
+    if (width == W) {                                       \
+        return std::forward<F>(f).template operator()<W>(); \
+    }
+    FOR_EACH_RECORD_WIDTH(RECORD_WIDTH_CASE)
+#undef RECORD_WIDTH_CASE
+    THROW_FORMATTED(
+        std::invalid_argument,
+        "Record width {} is not one of the compiled in widths",
+        width
+    );
+}
+
 #endif  // !RECORD_HPP
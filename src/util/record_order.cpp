@@ -0,0 +1,33 @@
+#include "record_order.hpp"
+
+#include <ranges>
+
+std::optional<RecordOrder> parseRecordOrder(std::string_view name) {
+    RecordOrder order;
+    for (auto part : std::views::split(name, ',')) {
+        std::string_view word(part.begin(), part.end());
+        if (word == "ascending") {
+            order.descending = false;
+        } else if (word == "descending") {
+            order.descending = true;
+        } else if (word == "numeric") {
+            order.numeric = true;
+        } else if (word == "ignore-case") {
+            order.ignoreCase = true;
+        } else {
+            return std::nullopt;
+        }
+    }
+    return order;
+}
+
+std::string recordOrderName(const RecordOrder& order) {
+    std::string name = order.descending ? "descending" : "ascending";
+    if (order.numeric) {
+        name += ",numeric";
+    }
+    if (order.ignoreCase) {
+        name += ",ignore-case";
+    }
+    return name;
+}
@@ -0,0 +1,157 @@
+#ifndef RECORD_ORDER_HPP
+#define RECORD_ORDER_HPP
+
+#include <cstddef>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "error.hpp"
+#include "record.hpp"
+
+// The order records are sorted in. Records that are equal in it, like "a7"
+// and "A07", are ordered by their bytes, so equal records are always
+// neighbours and the order of a sort never depends on its input.
+struct RecordOrder {
+    // Largest record first
+    bool descending = false;
+    // Runs of digits compare by their value, so "9" comes before "10"
+    bool numeric = false;
+    // ASCII letters compare as their lowercase
+    bool ignoreCase = false;
+
+    // Whether records are ordered by their bytes, smallest first
+    bool isBytes() const { return !descending && !numeric && !ignoreCase; }
+    bool operator==(const RecordOrder& other) const = default;
+};
+
+// A comma separated list of "ascending", "descending", "numeric" and
+// "ignore-case", std::nullopt for anything else
+std::optional<RecordOrder> parseRecordOrder(std::string_view name);
+std::string recordOrderName(const RecordOrder& order);
+
+// Compares the text of two records, without their '\0' padding, in the
+// numeric and case order. Returns a negative number, 0 or a positive number.
+template <bool Numeric, bool IgnoreCase>
+int compareRecordText(std::string_view a, std::string_view b) {
+    auto isDigit = [](unsigned char c) { return c >= '0' && c <= '9'; };
+    auto toLower = [](unsigned char c) -> unsigned char {
+        return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+    };
+    a = a.substr(0, a.find('\0'));
+    b = b.substr(0, b.find('\0'));
+
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.size() && j < b.size()) {
+        unsigned char ca = a[i];
+        unsigned char cb = b[j];
+        if constexpr (Numeric) {
+            if (isDigit(ca) && isDigit(cb)) {
+                // NOTE: Leading zeros do not change the value, without them
+                // the number with more digits is the larger one
+                while (i < a.size() && a[i] == '0') {
+                    i++;
+                }
+                while (j < b.size() && b[j] == '0') {
+                    j++;
+                }
+                size_t aEnd = i;
+                while (aEnd < a.size() && isDigit(a[aEnd])) {
+                    aEnd++;
+                }
+                size_t bEnd = j;
+                while (bEnd < b.size() && isDigit(b[bEnd])) {
+                    bEnd++;
+                }
+                if (aEnd - i != bEnd - j) {
+                    return aEnd - i < bEnd - j ? -1 : 1;
+                }
+                int c = a.substr(i, aEnd - i).compare(b.substr(j, bEnd - j));
+                if (c != 0) {
+                    return c;
+                }
+                i = aEnd;
+                j = bEnd;
+                continue;
+            }
+        }
+        if constexpr (IgnoreCase) {
+            ca = toLower(ca);
+            cb = toLower(cb);
+        }
+        if (ca != cb) {
+            return ca < cb ? -1 : 1;
+        }
+        i++;
+        j++;
+    }
+    // NOTE: One of them ended, a prefix comes first
+    return (a.size() - i != 0) - (b.size() - j != 0);
+}
+
+// Comparison policy of a RecordOrder known at compile time, a strict weak
+// ordering for std::sort and std::priority_queue. The sorter is instantiated
+// for every one of them, so no comparison pays for choosing the order.
+template <bool Descending, bool Numeric = false, bool IgnoreCase = false>
+struct RecordLess {
+    static constexpr RecordOrder order{Descending, Numeric, IgnoreCase};
+
+    // `a` and `b` hold all bytes of records of the same width
+    bool operator()(std::string_view a, std::string_view b) const {
+        int c = 0;
+        if constexpr (Numeric || IgnoreCase) {
+            c = compareRecordText<Numeric, IgnoreCase>(a, b);
+        }
+        if (c == 0) {
+            c = a.compare(b);
+        }
+        return Descending ? c > 0 : c < 0;
+    }
+
+    template <size_t RecordLen>
+    bool operator()(
+        const BasicRecord<RecordLen>& a, const BasicRecord<RecordLen>& b
+    ) const {
+        if constexpr (Numeric || IgnoreCase) {
+            return (*this)(a.data(), b.data());
+        } else {
+            // NOTE: Keeps the inlined fixed length comparison of records
+            return Descending ? b < a : a < b;
+        }
+    }
+};
+
+// Every order that can be chosen at runtime, as RecordLess arguments
+#define FOR_EACH_RECORD_ORDER(X) \
+    X(false, false, false)       \
+    X(false, false, true)        \
+    X(false, true, false)        \
+    X(false, true, true)         \
+    X(true, false, false)        \
+    X(true, false, true)         \
+    X(true, true, false)         \
+    X(true, true, true)
+
+// Selects the RecordLess matching the runtime order and calls
+// `f.template operator()<Less>()`, once per sort instead of once per
+// comparison
+template <typename F>
+decltype(auto) dispatchRecordOrder(const RecordOrder& order, F&& f) {
+#define RECORD_ORDER_CASE(D, N, I)                             \
+    if (order == RecordLess<D, N, I>::order) {                 \
+        using Less = RecordLess<D, N, I>;                      \
+        return std::forward<F>(f).template operator()<Less>(); \
+    }
+    FOR_EACH_RECORD_ORDER(RECORD_ORDER_CASE)
+#undef RECORD_ORDER_CASE
+    THROW_FORMATTED(
+        std::invalid_argument,
+        "Record order {} is not compiled in",
+        recordOrderName(order)
+    );
+}
+
+#endif  // !RECORD_ORDER_HPP
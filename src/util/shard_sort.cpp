@@ -0,0 +1,419 @@
+#include "shard_sort.hpp"
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "buffer.hpp"
+#include "error.hpp"
+#include "metrics.hpp"
+#include "record_order.hpp"
+#include "temp_file.hpp"
+#include "trace.hpp"
+
+namespace {
+
+// Records routed to a shard
+struct ShardCounts {
+    size_t records = 0;
+    // Records made only of '\0', which the padding of the shard file can not
+    // be told apart from
+    size_t empty = 0;
+    // Empty records that fill the last page of a fixed shard file
+    size_t padding = 0;
+};
+
+// The line of the summary of sort_files that holds its merge phases
+constexpr std::string_view PHASES_LINE = "Phases Needed Actual: ";
+
+// Merge phases a worker reports in its log, 0 if it reports none
+size_t readPhaseCount(const std::string& logFile) {
+    std::ifstream log(logFile);
+    std::string line;
+    size_t phaseCount = 0;
+    while (std::getline(log, line)) {
+        if (line.starts_with(PHASES_LINE)) {
+            auto count = std::string_view(line).substr(PHASES_LINE.size());
+            std::from_chars(
+                count.data(), count.data() + count.size(), phaseCount
+            );
+        }
+    }
+    return phaseCount;
+}
+
+// The last line a worker wrote to its log, which holds the error of a
+// failed one
+std::string readLastLine(const std::string& logFile) {
+    std::ifstream log(logFile);
+    std::string line;
+    std::string last;
+    while (std::getline(log, line)) {
+        if (!line.empty()) {
+            last = line;
+        }
+    }
+    return last;
+}
+
+// Starts `command` with `shardFile` as its last argument, its output and
+// errors going to `logFile`
+pid_t spawnWorker(
+    const std::vector<std::string>& command,
+    const std::string& shardFile,
+    const std::string& logFile
+) {
+    std::vector<std::string> args = command;
+    args.push_back(shardFile);
+    std::vector<char*> argv;
+    for (auto& arg : args) {
+        argv.push_back(arg.data());
+    }
+    argv.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(
+        &actions,
+        STDOUT_FILENO,
+        logFile.c_str(),
+        O_WRONLY | O_CREAT | O_TRUNC,
+        0644
+    );
+    posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+    pid_t pid = 0;
+    int error = ::posix_spawn(
+        &pid, args[0].c_str(), &actions, nullptr, argv.data(), environ
+    );
+    posix_spawn_file_actions_destroy(&actions);
+    if (error != 0) {
+        std::string reason = std::strerror(error);
+        THROW_FORMATTED(
+            std::runtime_error, "Starting {} failed: {}", args[0], reason
+        );
+    }
+    return pid;
+}
+
+// Exit status of the worker, 128 plus the signal if one killed it
+int waitForWorker(pid_t pid) {
+    int status = 0;
+    while (::waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            std::string reason = std::strerror(errno);
+            THROW_FORMATTED(
+                std::runtime_error,
+                "Waiting for worker {} failed: {}",
+                pid,
+                reason
+            );
+        }
+    }
+    if (WIFEXITED(status)) {
+        return WEXITSTATUS(status);
+    }
+    return 128 + WTERMSIG(status);
+}
+
+// Samples records from evenly spaced pages of f and returns the shardCount - 1
+// that split the samples into equal parts, in order
+template <size_t RecordLen, typename Less>
+std::vector<BasicRecord<RecordLen>> chooseSplitters(
+    BasicBufferedFile<RecordLen>& f, const ShardConfig& shards, Less less
+) {
+    TRACE_SPAN("choose_splitters");
+    std::vector<BasicRecord<RecordLen>> samples;
+    size_t pageCount = f.getPageCount();
+    size_t sampleCount = shards.shardCount * shards.samplesPerShard;
+    for (size_t s = 0; s < sampleCount && pageCount != 0; s++) {
+        // NOTE: Samples that share a page take different records of it
+        auto page = f.readPage(s * pageCount / sampleCount);
+        if (!page.empty()) {
+            samples.push_back(page[s % page.size()]);
+        }
+    }
+    std::ranges::sort(samples, less);
+
+    std::vector<BasicRecord<RecordLen>> splitters;
+    if (samples.empty()) {
+        return splitters;
+    }
+    for (size_t i = 1; i < shards.shardCount; i++) {
+        splitters.push_back(samples[i * samples.size() / shards.shardCount]);
+    }
+    return splitters;
+}
+
+// Writes every record of f to the shard whose range holds it. A record goes
+// to the first shard whose splitter is larger, so equal records share one.
+template <size_t RecordLen, typename Less>
+std::vector<ShardCounts> partition(
+    BasicBufferedFile<RecordLen>& f,
+    const std::vector<BasicRecord<RecordLen>>& splitters,
+    const std::vector<std::unique_ptr<BasicTempFile<RecordLen>>>& shardFiles,
+    Less less
+) {
+    using Record = BasicRecord<RecordLen>;
+    using BufferedFile = BasicBufferedFile<RecordLen>;
+
+    PhaseScope phase("partition");
+    TRACE_SPAN("partition");
+    std::vector<ShardCounts> counts(shardFiles.size());
+    {
+        std::vector<std::unique_ptr<BasicBuffer<RecordLen>>> outputs;
+        for (const auto& shard : shardFiles) {
+            outputs.push_back(std::make_unique<BasicBuffer<RecordLen>>(
+                static_cast<BufferedFile&>(*shard).pages()
+            ));
+        }
+        size_t recordCount = 0;
+        for (std::vector<Record> page : f.pages()) {
+            recordCount += page.size();
+            for (const auto& r : page) {
+                size_t i = std::ranges::upper_bound(splitters, r, less) -
+                           splitters.begin();
+                counts[i].records++;
+                if (r == Record::empty) {
+                    counts[i].empty++;
+                }
+                outputs[i]->append(r);
+            }
+        }
+        Metrics::instance().addRecords(recordCount);
+    }
+    // NOTE: The workers read the shards from disk
+    for (size_t i = 0; i < shardFiles.size(); i++) {
+        auto& shard = static_cast<BufferedFile&>(*shardFiles[i]);
+        shard.flush();
+        if (shard.getPageFormat() == PageFormat::FIXED) {
+            counts[i].padding =
+                shard.getPageCount() * shard.getRecordsPerPage() -
+                counts[i].records;
+        }
+    }
+    return counts;
+}
+
+// Program and arguments of the worker of a shard. With a limit it keeps only
+// as many records as the concatenation can take from the shard: its padding
+// may come first in the order, but all of it is one record with --unique.
+std::vector<std::string> workerCommandFor(
+    const ShardCounts& counts,
+    const SortConfig& config,
+    const ShardConfig& shards
+) {
+    std::vector<std::string> command = shards.workerCommand;
+    if (config.limit.has_value()) {
+        size_t padding = config.dedup == DedupMode::UNIQUE
+                             ? std::min<size_t>(counts.padding, 1)
+                             : counts.padding;
+        command.push_back("--limit");
+        command.push_back(std::to_string(*config.limit + padding));
+    }
+    return command;
+}
+
+// Sorts every shard in a worker process of its own, waits for all of them and
+// returns the most merge phases any of them took
+template <size_t RecordLen>
+size_t sortShards(
+    const std::vector<std::unique_ptr<BasicTempFile<RecordLen>>>& shardFiles,
+    const std::vector<ShardCounts>& counts,
+    const SortConfig& config,
+    const ShardConfig& shards
+) {
+    PhaseScope phase("sort_shards");
+    TRACE_SPAN("sort_shards");
+    std::vector<std::string> logFiles;
+    std::vector<pid_t> workers;
+    std::exception_ptr spawnError;
+    try {
+        for (size_t i = 0; i < shardFiles.size(); i++) {
+            logFiles.push_back(shardFiles[i]->getFileName() + ".log");
+            workers.push_back(spawnWorker(
+                workerCommandFor(counts[i], config, shards),
+                shardFiles[i]->getFileName(),
+                logFiles.back()
+            ));
+        }
+    } catch (...) {
+        // NOTE: The workers that started still sort files of this process
+        spawnError = std::current_exception();
+    }
+
+    std::optional<size_t> failed;
+    int failedStatus = 0;
+    size_t phaseCount = 0;
+    for (size_t i = 0; i < workers.size(); i++) {
+        int status = waitForWorker(workers[i]);
+        if (status == 0) {
+            phaseCount = std::max(phaseCount, readPhaseCount(logFiles[i]));
+            std::filesystem::remove(logFiles[i]);
+        } else if (!failed.has_value()) {
+            failed = i;
+            failedStatus = status;
+        }
+    }
+    if (spawnError) {
+        std::rethrow_exception(spawnError);
+    }
+    if (failed.has_value()) {
+        std::string reason = std::format(
+            "exit status {}: {}", failedStatus, readLastLine(logFiles[*failed])
+        );
+        THROW_FORMATTED(
+            std::runtime_error,
+            "Sorting shard {} failed with {}, see {}",
+            *failed + 1,
+            reason,
+            logFiles[*failed]
+        );
+    }
+    return phaseCount;
+}
+
+// Writes the records of the sorted shards into f one after the other and
+// returns how many there are. The padding of a shard file is dropped, it is
+// whatever the shard holds of empty records beyond the ones routed to it.
+template <size_t RecordLen>
+size_t concatenate(
+    BasicBufferedFile<RecordLen>& f,
+    const std::vector<std::unique_ptr<BasicTempFile<RecordLen>>>& shardFiles,
+    const std::vector<ShardCounts>& counts,
+    const SortConfig& config
+) {
+    using Record = BasicRecord<RecordLen>;
+    using BufferedFile = BasicBufferedFile<RecordLen>;
+
+    PhaseScope phase("concatenate");
+    TRACE_SPAN("concatenate");
+    size_t written = 0;
+    size_t pageCount = 0;
+    {
+        BasicBuffer<RecordLen> out(f.pages());
+        std::vector<Record> page;
+        auto isDone = [&]() {
+            return config.limit.has_value() && written == *config.limit;
+        };
+        for (size_t i = 0; i < shardFiles.size() && !isDone(); i++) {
+            auto& shard = static_cast<BufferedFile&>(*shardFiles[i]);
+            // NOTE: Empty records routed to the shard are one with --unique
+            size_t emptyLeft = config.dedup == DedupMode::UNIQUE
+                                   ? std::min<size_t>(counts[i].empty, 1)
+                                   : counts[i].empty;
+            size_t shardPages = shard.getPageCount();
+            for (size_t p = 0; p < shardPages && !isDone(); p++) {
+                // NOTE: The cached page was read before the worker sorted it
+                shard.readPageInto(p, page);
+                for (const auto& r : page) {
+                    if (isDone()) {
+                        break;
+                    }
+                    if (r == Record::empty) {
+                        if (emptyLeft == 0) {
+                            continue;
+                        }
+                        emptyLeft--;
+                    }
+                    out.append(r);
+                    written++;
+                }
+            }
+        }
+        Metrics::instance().addRecords(written);
+        pageCount = out.pageCount();
+    }
+    f.truncate(pageCount);
+    return written;
+}
+
+template <size_t RecordLen, typename Less>
+SortStats sortShardedBy(
+    BasicBufferedFile<RecordLen>& f,
+    const SortConfig& config,
+    const ShardConfig& shards,
+    Less less
+) {
+    SortStats stats;
+    if (config.logging) {
+        std::cout << "Stage 1: Partition into " << shards.shardCount
+                  << " shards" << std::endl;
+    }
+    auto splitters = chooseSplitters(f, shards, less);
+    std::vector<std::unique_ptr<BasicTempFile<RecordLen>>> shardFiles;
+    for (size_t i = 0; i < shards.shardCount; i++) {
+        shardFiles.push_back(std::make_unique<BasicTempFile<RecordLen>>(
+            f.getRecordsPerPage(), f.getPageFormat()
+        ));
+    }
+    auto counts = partition(f, splitters, shardFiles, less);
+    if (config.logging) {
+        for (size_t i = 0; i < counts.size(); i++) {
+            std::cout << std::format(
+                "Shard {}: records={} file={}",
+                i + 1,
+                counts[i].records,
+                shardFiles[i]->getFileName()
+            ) << std::endl;
+        }
+        std::cout << "\nStage 2: Sort shards in " << shards.shardCount
+                  << " worker processes" << std::endl;
+    }
+
+    stats.phaseCount = sortShards(shardFiles, counts, config, shards);
+
+    if (config.logging) {
+        std::cout << "\nStage 3: Concatenate shards\n" << std::endl;
+    }
+    stats.outputCount = concatenate(f, shardFiles, counts, config);
+    stats.runCount = shards.shardCount;
+    return stats;
+}
+
+}  // namespace
+
+template <size_t RecordLen>
+SortStats sortSharded(
+    BasicBufferedFile<RecordLen>& f,
+    const SortConfig& config,
+    const ShardConfig& shards
+) {
+    if (config.indexStride != 0 || config.dedup == DedupMode::COUNT) {
+        THROW_FORMATTED(
+            std::invalid_argument, "A sharded sort writes no index or counts"
+        );
+    }
+    if (shards.shardCount == 0 || shards.workerCommand.empty()) {
+        THROW_FORMATTED(
+            std::invalid_argument,
+            "A sharded sort needs at least one shard and a worker command"
+        );
+    }
+    return dispatchRecordOrder(config.order, [&]<typename Less>() {
+        return sortShardedBy(f, config, shards, Less{});
+    });
+}
+
+#define INSTANTIATE_SHARD_SORT(W)                                    \
+    template SortStats sortSharded<W>(                               \
+        BasicBufferedFile<W>&, const SortConfig&, const ShardConfig& \
+    );
+FOR_EACH_RECORD_WIDTH(INSTANTIATE_SHARD_SORT)
+#undef INSTANTIATE_SHARD_SORT
@@ -0,0 +1,48 @@
+#ifndef SHARD_SORT_HPP
+#define SHARD_SORT_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "file_buffering.hpp"
+#include "sort_config.hpp"
+
+// How a sort is split over worker processes
+struct ShardConfig {
+    size_t shardCount = 2;
+    // Records sampled for every shard to choose the splitters, more of them
+    // even out the sizes of the shards
+    size_t samplesPerShard = 64;
+    // Program and arguments of a worker. It is run with the name of a shard
+    // file appended and must sort that file in place, like sort_files -l.
+    // With a limit `--limit <count>` comes before the file name, and the
+    // merge phases are read from the "Phases Needed Actual:" line of its
+    // output.
+    std::vector<std::string> workerCommand;
+};
+
+// Sorts f in place by ranges of records instead of by merging. Splitters
+// sampled from f divide its records into shardCount shards of about the same
+// size, which are written to temporary files and sorted by a worker process
+// each, all at the same time. Every record of a shard comes before every
+// record of the next one, so the sorted shards are concatenated back into f
+// without a merge. Workers share nothing but their shard file with the sort,
+// so the temporary directories may be on shared storage.
+//
+// Equal records end up in the same shard, so with DedupMode::UNIQUE the
+// workers drop every duplicate. Every worker keeps only the limit plus the
+// padding of its shard, and the limit is applied again while concatenating.
+// The phase count of the result is the largest of any worker, they merge at
+// the same time.
+// Throws std::invalid_argument for an index or DedupMode::COUNT, and
+// std::runtime_error if a worker fails, whose output is kept in the log file
+// next to its shard.
+template <size_t RecordLen>
+SortStats sortSharded(
+    BasicBufferedFile<RecordLen>& f,
+    const SortConfig& config,
+    const ShardConfig& shards
+);
+
+#endif  // !SHARD_SORT_HPP
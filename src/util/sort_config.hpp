@@ -0,0 +1,80 @@
+#ifndef SORT_CONFIG_HPP
+#define SORT_CONFIG_HPP
+
+#include <cstddef>
+#include <optional>
+
+#include "page_format.hpp"
+#include "record.hpp"
+#include "record_order.hpp"
+
+// What happens to records that are equal
+enum class DedupMode {
+    // All of them are kept
+    NONE,
+    // Only one is kept, duplicates are dropped as soon as they meet, in run
+    // generation and in every merge phase
+    UNIQUE,
+    // Only one is kept and the number of occurrences of every record is
+    // written next to the sorted file. Intermediate runs have no room for a
+    // count, so duplicates are only collapsed when the sorted file is
+    // written.
+    COUNT,
+};
+
+// Everything the sorter needs to know, independent of where it came from
+struct SortConfig {
+    size_t bufferCount = 5;
+    size_t blockingFactor = 10;
+    size_t recordWidth = Record::maxLen;
+    // Threads used to sort the buffers of a run
+    size_t threadCount = 1;
+    // Run generation reads, sorts and writes on threads of their own, so the
+    // next run is read while one is sorted and the one before is written.
+    // Holds up to three runs of bufferCount pages in memory instead of one.
+    bool pipelined = false;
+    // Prints a summary of every run as it is written
+    bool logging = true;
+    // Records sampled from every run summary
+    size_t sampleSize = 0;
+    // Prints the whole file after every run and phase, O(N) each time, so
+    // only for debugging tiny inputs
+    bool dumpContents = false;
+    // Format of the runs written to temporary files, the format of the
+    // sorted file when not set. PageFormat::FIXED is rejected for runs that
+    // do not fill their pages, as its padding would be merged as records.
+    std::optional<PageFormat> runFormat = std::nullopt;
+    // Writes a sparse index of the sorted file with the first record of
+    // every indexStride-th page, 0 for no index. Lookups search it by the
+    // bytes of the records, so it is rejected for any other order.
+    size_t indexStride = 0;
+    RecordOrder order = {};
+    DedupMode dedup = DedupMode::NONE;
+    // Only the first `limit` records of the order are kept. Without
+    // duplicates and if they fit in the buffers they are selected in a single
+    // pass, otherwise runs and merges stop after `limit` records.
+    std::optional<size_t> limit = std::nullopt;
+    // Punches holes into runs and into the input as soon as they are merged,
+    // so a sort takes about one copy of the data on disk instead of two.
+    // Needs a file system that supports FALLOC_FL_PUNCH_HOLE.
+    bool releaseConsumed = false;
+    // Writes a Checkpoint next to the sorted file after run generation and
+    // after every merge phase. Runs always go to temporary files then, which
+    // outlive a sort that fails, and the sorted file is only written once
+    // the runs are complete.
+    bool checkpoint = false;
+    // Continues from the checkpoint of the sorted file if there is one
+    bool resume = false;
+};
+
+// What happened during a single sort
+struct SortStats {
+    size_t runCount = 0;
+    size_t phaseCount = 0;
+    // Bytes copied from the temp file back into the sorted file
+    size_t copiedBytes = 0;
+    // Records in the sorted file, only counted with a DedupMode or a limit
+    size_t outputCount = 0;
+};
+
+#endif  // !SORT_CONFIG_HPP
@@ -1,8 +1,12 @@
 #include "sort_options.hpp"
 
+#include <algorithm>
+#include <filesystem>
 #include <format>
 #include <iostream>
 #include <string>
+#include <utility>
+#include <vector>
 
 SortOptions::SortOptions(int argc, char** argv) : scriptName(argv[0]) {
     parse(argc, argv);
@@ -14,11 +18,29 @@ SortOptions::SortOptions(int argc, char** argv) : scriptName(argv[0]) {
             "fileName={}\n"
             "bufferCount={}\n"
             "blockingFactor={}\n"
-            "logging={}\n",
+            "recordWidth={}\n"
+            "pageFormat={}\n"
+            "runFormat={}\n"
+            "order={}\n"
+            "threadCount={}\n"
+            "pipelined={}\n"
+            "shardCount={}\n"
+            "logging={}\n"
+            "sampleSize={}\n"
+            "dumpContents={}\n",
             fileName,
             bufferCount,
             blockingFactor,
-            logging
+            recordWidth,
+            pageFormatName(pageFormat),
+            pageFormatName(runFormat.value_or(pageFormat)),
+            recordOrderName(order),
+            threadCount,
+            pipelined,
+            shardCount,
+            logging,
+            sampleSize,
+            dumpContents
         ) << std::endl;
         // clang-format on
     }
@@ -49,15 +71,69 @@ void SortOptions::handleFlag(
         parseBufferCount(i, argc, argv);
     } else if ((flag == "-b") || (flag == "--blockingFactor")) {
         parseBlockingFactor(i, argc, argv);
+    } else if ((flag == "-w") || (flag == "--recordWidth")) {
+        parseRecordWidth(i, argc, argv);
+    } else if (flag == "--page-format") {
+        parsePageFormat(i, argc, argv);
+    } else if (flag == "--run-format") {
+        parseRunFormat(i, argc, argv);
+    } else if (flag == "--order") {
+        parseOrder(i, argc, argv);
+    } else if ((flag == "-o") || (flag == "--output")) {
+        outputFileName = getVal(i, argc, argv);
+    } else if (flag == "--sort-inputs") {
+        sortInputs = true;
+    } else if (flag == "--temp-dir") {
+        tempDirectories.push_back(getVal(i, argc, argv));
+    } else if (flag == "--temp-placement") {
+        parseTempPlacement(i, argc, argv);
+    } else if (flag == "--stream") {
+        streaming = true;
+    } else if (flag == "--lines") {
+        streamFormat = StreamFormat::LINES;
+    } else if (flag == "--sorted-pages") {
+        parseSortedPages(i, argc, argv);
+    } else if (flag == "--unique") {
+        dedup = DedupMode::UNIQUE;
+    } else if (flag == "--count") {
+        dedup = DedupMode::COUNT;
+    } else if (flag == "--index") {
+        parseIndexStride(i, argc, argv);
+    } else if (flag == "--limit") {
+        parseLimit(i, argc, argv);
+    } else if (flag == "--punch-holes") {
+        releaseConsumed = true;
+    } else if (flag == "--checkpoint") {
+        checkpoint = true;
+    } else if (flag == "--resume") {
+        resume = true;
+    } else if ((flag == "-t") || (flag == "--threads")) {
+        parseThreadCount(i, argc, argv);
+    } else if (flag == "--pipeline") {
+        pipelined = true;
+    } else if (flag == "--shards") {
+        parseShardCount(i, argc, argv);
     } else if ((flag == "-l") || (flag == "--logging")) {
         logging = false;
+    } else if (flag == "--stats-json") {
+        statsJsonFile = getVal(i, argc, argv);
+    } else if ((flag == "-s") || (flag == "--sample")) {
+        parseSampleSize(i, argc, argv);
+    } else if (flag == "--dump") {
+        dumpContents = true;
+    } else if (flag == "--perf-counters") {
+        perfCounters = true;
+    } else if (flag == "--trace") {
+        traceFile = getVal(i, argc, argv);
     } else {
         std::cerr << "Error: Unknown argument '" << flag << "'\n";
         printHelpAndExit();
     }
 }
 
-void SortOptions::handleFileName(const std::string& name) { fileName = name; }
+void SortOptions::handleFileName(const std::string& name) {
+    fileNames.push_back(name);
+}
 
 std::string SortOptions::getVal(int& i, int argc, char** argv) {
     if (i + 1 >= argc) {
@@ -89,9 +165,334 @@ void SortOptions::parseBlockingFactor(int& i, int argc, char** argv) {
     }
 }
 
-void SortOptions::checkRequired() const {
-    if (fileName.empty()) {
-        std::cerr << "Error: A file name must be provided." << std::endl;
+void SortOptions::parseRecordWidth(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    try {
+        recordWidth = std::stoul(val);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+}
+
+void SortOptions::parsePageFormat(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    auto format = ::parsePageFormat(val);
+    if (!format.has_value()) {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+    pageFormat = *format;
+}
+
+void SortOptions::parseRunFormat(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    runFormat = ::parsePageFormat(val);
+    if (!runFormat.has_value()) {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+}
+
+void SortOptions::parseOrder(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    auto parsed = parseRecordOrder(val);
+    if (!parsed.has_value()) {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+    order = *parsed;
+}
+
+void SortOptions::parseTempPlacement(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    auto placement = ::parseTempPlacement(val);
+    if (!placement.has_value()) {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+    tempPlacement = *placement;
+}
+
+void SortOptions::parseIndexStride(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    try {
+        indexStride = std::stoul(val);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+}
+
+void SortOptions::parseLimit(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    try {
+        limit = std::stoul(val);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+}
+
+void SortOptions::parseSortedPages(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    try {
+        sortedPages = std::stoul(val);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+}
+
+void SortOptions::parseThreadCount(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    try {
+        threadCount = std::stoul(val);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+}
+
+void SortOptions::parseShardCount(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    try {
+        shardCount = std::stoul(val);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+    if (shardCount == 0) {
+        std::cerr << "Error: The shard count must be at least 1." << std::endl;
+        printHelpAndExit();
+    }
+}
+
+void SortOptions::parseSampleSize(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    try {
+        sampleSize = std::stoul(val);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+}
+
+SortConfig SortOptions::getSortConfig() const {
+    return SortConfig{
+        .bufferCount = bufferCount,
+        .blockingFactor = blockingFactor,
+        .recordWidth = recordWidth,
+        .threadCount = threadCount,
+        .pipelined = pipelined,
+        .logging = logging,
+        .sampleSize = sampleSize,
+        .dumpContents = dumpContents,
+        .runFormat = runFormat,
+        .indexStride = indexStride,
+        .order = order,
+        .dedup = dedup,
+        .limit = limit,
+        .releaseConsumed = releaseConsumed,
+        .checkpoint = checkpoint || resume,
+        .resume = resume,
+    };
+}
+
+ExternalSorterOptions SortOptions::getExternalSorterOptions() const {
+    // NOTE: The sorter splits its budget between the runs of a pipeline
+    size_t runCount = pipelined ? 3 : 1;
+    return ExternalSorterOptions{
+        .memoryBudget = runCount * bufferCount * blockingFactor * recordWidth,
+        .recordsPerPage = blockingFactor,
+        .threadCount = threadCount,
+        .pipelined = pipelined,
+        .tempDirectories = {tempDirectories.begin(), tempDirectories.end()},
+        .tempPlacement = tempPlacement,
+        .runFormat = runFormat,
+        .order = order,
+        .dedup = dedup,
+        .limit = limit,
+        .releaseConsumed = releaseConsumed,
+    };
+}
+
+ShardConfig SortOptions::getShardConfig() const {
+    // NOTE: Workers run this very program, whatever directory they start in
+    std::vector<std::string> command = {
+        std::filesystem::read_symlink("/proc/self/exe").string(),
+        "-l",
+        "-n",
+        std::to_string(bufferCount),
+        "-b",
+        std::to_string(blockingFactor),
+        "-w",
+        std::to_string(recordWidth),
+        "--page-format",
+        std::string(pageFormatName(pageFormat)),
+        "--order",
+        recordOrderName(order),
+        "-t",
+        std::to_string(threadCount),
+        "--temp-placement",
+        std::string(tempPlacementName(tempPlacement)),
+    };
+    if (runFormat.has_value()) {
+        command.push_back("--run-format");
+        command.push_back(std::string(pageFormatName(*runFormat)));
+    }
+    // NOTE: The limit of every worker depends on the padding of its shard,
+    // sortSharded adds it
+    if (dedup == DedupMode::UNIQUE) {
+        command.push_back("--unique");
+    }
+    if (pipelined) {
+        command.push_back("--pipeline");
+    }
+    for (const auto& dir : tempDirectories) {
+        command.push_back("--temp-dir");
+        command.push_back(dir);
+    }
+    return ShardConfig{
+        .shardCount = shardCount,
+        .workerCommand = std::move(command),
+    };
+}
+
+void SortOptions::checkRequired() {
+    if (streaming) {
+        checkStreaming();
+    } else if (outputFileName.empty()) {
+        if (fileNames.size() != 1) {
+            std::cerr << "Error: Exactly one file name must be provided, "
+                         "unless merging with --output."
+                      << std::endl;
+            printHelpAndExit();
+        }
+        fileName = fileNames[0];
+    } else {
+        if (fileNames.empty()) {
+            std::cerr << "Error: At least one file to merge must be provided."
+                      << std::endl;
+            printHelpAndExit();
+        }
+        if (std::ranges::find(fileNames, outputFileName) != fileNames.end()) {
+            std::cerr << "Error: The output file must not be one of the "
+                         "files to merge."
+                      << std::endl;
+            printHelpAndExit();
+        }
+        fileName = outputFileName;
+        inputFileNames = fileNames;
+    }
+
+    if (streamFormat == StreamFormat::LINES && !streaming) {
+        std::cerr << "Error: --lines requires --stream." << std::endl;
+        printHelpAndExit();
+    }
+    if (sortInputs && !isMerging()) {
+        std::cerr << "Error: --sort-inputs requires --output." << std::endl;
+        printHelpAndExit();
+    }
+    if (sortedPages != 0 && isMerging()) {
+        std::cerr << "Error: --sorted-pages can not be used with --output."
+                  << std::endl;
+        printHelpAndExit();
+    }
+    // NOTE: Runs of a variable file end within a page, fixed pages would pad
+    // them with records
+    if (runFormat == PageFormat::FIXED && pageFormat != PageFormat::FIXED) {
+        std::cerr << "Error: --run-format fixed needs --page-format fixed."
+                  << std::endl;
+        printHelpAndExit();
+    }
+    // NOTE: Runs without duplicates or cut at a limit end within a page
+    if (runFormat == PageFormat::FIXED &&
+        (dedup == DedupMode::UNIQUE || limit.has_value())) {
+        std::cerr << "Error: --run-format fixed can not be used with "
+                     "--unique or --limit."
+                  << std::endl;
+        printHelpAndExit();
+    }
+    // NOTE: Lookups search the index by the bytes of the records
+    if (indexStride != 0 && !order.isBytes()) {
+        std::cerr << "Error: --index needs the default --order ascending."
+                  << std::endl;
+        printHelpAndExit();
+    }
+    // NOTE: The index and counts of a sort that is resumed after its last
+    // phase would be lost, and punched runs can not be merged again
+    if ((checkpoint || resume) &&
+        (isMerging() || streaming || sortedPages != 0 || releaseConsumed ||
+         indexStride != 0 || dedup == DedupMode::COUNT)) {
+        std::cerr << "Error: --checkpoint and --resume can not be used with "
+                     "--output, --stream, --sorted-pages, --punch-holes, "
+                     "--index or --count."
+                  << std::endl;
+        printHelpAndExit();
+    }
+
+    if (isSharding()) {
+        checkSharding();
+    }
+
+    if (threadCount == 0) {
+        std::cerr << "Error: The thread count must be at least 1."
+                  << std::endl;
+        printHelpAndExit();
+    }
+
+    if (!isSupportedRecordWidth(recordWidth)) {
+        std::cerr << "Error: Unsupported record width " << recordWidth
+                  << std::endl;
+        printHelpAndExit();
+    }
+}
+
+void SortOptions::checkStreaming() {
+    if (!fileNames.empty() || !outputFileName.empty() || sortedPages != 0) {
+        std::cerr << "Error: --stream reads stdin and writes stdout, it takes "
+                     "no files."
+                  << std::endl;
+        printHelpAndExit();
+    }
+    if (indexStride != 0 || dedup == DedupMode::COUNT || dumpContents) {
+        std::cerr << "Error: --index, --count and --dump need a sorted file, "
+                     "they can not be used with --stream."
+                  << std::endl;
+        printHelpAndExit();
+    }
+    // NOTE: Runs end within a page, fixed pages would pad them with records
+    if (runFormat == PageFormat::FIXED) {
+        std::cerr << "Error: --stream can not write --run-format fixed."
+                  << std::endl;
+        printHelpAndExit();
+    }
+    // NOTE: stdout only holds the sorted records
+    logging = false;
+}
+
+void SortOptions::checkSharding() {
+    // NOTE: The shards are sorted files of their own, side outputs and
+    // progress of the whole sort would have to be pieced together
+    if (isMerging() || streaming || sortedPages != 0 || checkpoint ||
+        resume || releaseConsumed || indexStride != 0 ||
+        dedup == DedupMode::COUNT || dumpContents) {
+        std::cerr << "Error: --shards can not be used with --output, "
+                     "--stream, --sorted-pages, --checkpoint, --resume, "
+                     "--punch-holes, --index, --count or --dump."
+                  << std::endl;
         printHelpAndExit();
     }
 }
@@ -99,16 +500,99 @@ void SortOptions::checkRequired() const {
 void SortOptions::printHelpAndExit(int exitCode) const {
     // clang-format off
     std::cout <<
-        "Usage: " << scriptName << " [options] <fileName>\n\n"
+        "Usage: " << scriptName << " [options] <fileName>\n"
+        "       " << scriptName << " [options] -o <output> <fileName>...\n"
+        "       " << scriptName << " [options] --stream\n\n"
+        "Sorts <fileName> in place, merges already sorted files into\n"
+        "<output>, or sorts stdin to stdout.\n\n"
         "Options:\n"
         "\t-h, --help\tShow this help message\n\n"
         "\t-n, --bufferCount <value>\n"
         "\t\tSet buffer count (min: 3, default: 5)\n\n"
         "\t-b, --blockingFactor <value>\n"
         "\t\tSet blocking factor (min: 1, default: 10)\n\n"
+        "\t-w, --recordWidth <value>\n"
+        "\t\tSet record width in bytes (16, 30 or 64, default: 30)\n\n"
+        "\t--page-format <fixed|variable>\n"
+        "\t\tLayout of the pages of the file. variable packs records by\n"
+        "\t\ttheir length, short records take less space (default: fixed)\n\n"
+        "\t--order <ascending|descending>[,numeric][,ignore-case]\n"
+        "\t\tOrder of the sorted records. numeric compares runs of\n"
+        "\t\tdigits by their value, ignore-case compares letters as\n"
+        "\t\tlowercase. Records equal in the order are ordered by their\n"
+        "\t\tbytes (default: ascending)\n\n"
+        "\t--run-format <fixed|variable|prefix>\n"
+        "\t\tLayout of the runs in temporary files. prefix stores the\n"
+        "\t\tprefix sorted neighbours share once. Runs that do not fill\n"
+        "\t\ttheir pages, with --stream, --unique or --limit, can not be\n"
+        "\t\tfixed (default: --page-format, prefix for such runs)\n\n"
+        "\t-o, --output <file>\n"
+        "\t\tMerge the sorted <fileName>s into <file> in a single pass\n"
+        "\t\twhile they fit in the input buffers, instead of sorting\n\n"
+        "\t--sort-inputs\n"
+        "\t\tWith --output, first sort every input that is not sorted\n"
+        "\t\tinto a temporary copy, the inputs are left unchanged.\n"
+        "\t\tOtherwise an unsorted input is an error\n\n"
+        "\t--temp-dir <dir>\n"
+        "\t\tCreate temporary files in <dir>, may be given once per\n"
+        "\t\tdevice. Consecutive files go to different directories, so\n"
+        "\t\ta merge reads one while writing another (default: temp)\n\n"
+        "\t--temp-placement <round-robin|free-space>\n"
+        "\t\tPick the directory of a new temporary file in turn, or by\n"
+        "\t\tthe most free space (default: round-robin)\n\n"
+        "\t--stream\tSort the records of stdin to stdout, through temporary\n"
+        "\t\tfiles. Records take the full record width unless --lines\n"
+        "\t\tis given. Logs are disabled\n\n"
+        "\t--lines\tWith --stream, read and write one record per line\n\n"
+        "\t--sorted-pages <count>\n"
+        "\t\tThe first <count> pages are sorted already, only sort the\n"
+        "\t\tpages appended after them and merge them in\n\n"
+        "\t--unique\tKeep one of every set of equal records, dropping\n"
+        "\t\tduplicates in every run and merge phase\n\n"
+        "\t--count\tLike --unique, and write how often every record occurs\n"
+        "\t\tto <fileName>.counts\n\n"
+        "\t--limit <count>\n"
+        "\t\tKeep only the first <count> records, or distinct records\n"
+        "\t\twith --unique or --count\n\n"
+        "\t--punch-holes\n"
+        "\t\tFree the disk blocks of the file and of temporary files as\n"
+        "\t\tsoon as they are merged, so the sort needs about one copy\n"
+        "\t\tof the file on disk instead of two. The file is lost if the\n"
+        "\t\tsort fails\n\n"
+        "\t--checkpoint\n"
+        "\t\tWrite the progress of the sort to <fileName>.ckpt after\n"
+        "\t\trun generation and every merge phase, and keep the runs\n"
+        "\t\tit names if the sort fails\n\n"
+        "\t--resume\tLike --checkpoint, and continue from <fileName>.ckpt\n"
+        "\t\tif it exists instead of starting over\n\n"
+        "\t--index <stride>\n"
+        "\t\tWrite the first record of every <stride>-th page of the\n"
+        "\t\tsorted file to <fileName>.idx, for the lookup tool\n\n"
+        "\t-t, --threads <value>\n"
+        "\t\tThreads sorting the buffers of a run (default: 1)\n\n"
+        "\t--pipeline\tRead the next run while one is sorted and the one\n"
+        "\t\tbefore it is written. Holds three runs of <bufferCount>\n"
+        "\t\tpages in memory instead of one\n\n"
+        "\t--shards <count>\n"
+        "\t\tSplit the file by ranges of records into <count> shards,\n"
+        "\t\tsort each in a process of its own and concatenate them.\n"
+        "\t\tEvery process takes the memory of a whole sort\n\n"
         "\t-l, --logging\tDisable logging\n\n"
+        "\t-s, --sample <value>\n"
+        "\t\tLog this many evenly spaced records of every run (default: 0)\n\n"
+        "\t--dump\tPrint the whole file before and after the sort and after\n"
+        "\t\tevery run and phase. Slow, only for debugging small files\n\n"
+        "\t--stats-json <file>\n"
+        "\t\tWrite per phase I/O and timing statistics as JSON\n\n"
+        "\t--perf-counters\n"
+        "\t\tCount instructions, cycles, cache and branch misses of every\n"
+        "\t\tphase and of the in buffer sort\n\n"
+        "\t--trace <file>\n"
+        "\t\tWrite a Chrome trace of the sort, needs a build with\n"
+        "\t\t-DENABLE_TRACING=ON\n\n"
         "Arguments:\n"
-        "\t<fileName>\tRequired: Path to the file to be sorted\n";
+        "\t<fileName>\tRequired: Path to the file to be sorted, or to the\n"
+        "\t\t\tfiles to merge with --output\n";
     // clang-format on
     exit(exitCode);
 }
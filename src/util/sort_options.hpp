@@ -2,7 +2,17 @@
 #define SORT_OPTIONS_HPP
 
 #include <cstddef>
+#include <optional>
 #include <string>
+#include <vector>
+
+#include "page_format.hpp"
+#include "external_sorter.hpp"
+#include "record.hpp"
+#include "record_order.hpp"
+#include "shard_sort.hpp"
+#include "sort_config.hpp"
+#include "temp_file.hpp"
 
 class SortOptions {
    public:
@@ -10,8 +20,52 @@ class SortOptions {
 
     size_t getBufferCount() const { return bufferCount; }
     size_t getBlockingFactor() const { return blockingFactor; }
+    size_t getRecordWidth() const { return recordWidth; }
+    PageFormat getPageFormat() const { return pageFormat; }
+    const std::optional<PageFormat>& getRunFormat() const { return runFormat; }
+    const RecordOrder& getOrder() const { return order; }
+    // 0 when no index should be written
+    size_t getIndexStride() const { return indexStride; }
+    DedupMode getDedupMode() const { return dedup; }
+    const std::optional<size_t>& getLimit() const { return limit; }
+    size_t getThreadCount() const { return threadCount; }
+    bool isPipelined() const { return pipelined; }
     bool isLogging() const { return logging; }
+    bool usePerfCounters() const { return perfCounters; }
+    size_t getSampleSize() const { return sampleSize; }
+    bool isDumpingContents() const { return dumpContents; }
+    // The file that ends up sorted, the output file when merging
     const std::string& getFileName() const { return fileName; }
+    // Whether sorted input files are merged into an output file
+    bool isMerging() const { return !inputFileNames.empty(); }
+    // Empty unless merging
+    const std::vector<std::string>& getInputFileNames() const {
+        return inputFileNames;
+    }
+    bool isSortingInputs() const { return sortInputs; }
+    // Pages at the start of the file that are sorted already, 0 if none are
+    size_t getSortedPages() const { return sortedPages; }
+    // Whether the file is split into shards sorted by worker processes
+    bool isSharding() const { return shardCount != 0; }
+    // Whether records are sorted from stdin to stdout instead of a file
+    bool isStreaming() const { return streaming; }
+    StreamFormat getStreamFormat() const { return streamFormat; }
+    // Empty unless temporary files go elsewhere than temp/
+    const std::vector<std::string>& getTempDirectories() const {
+        return tempDirectories;
+    }
+    TempPlacement getTempPlacement() const { return tempPlacement; }
+    // Empty when no statistics should be written
+    const std::string& getStatsJsonFile() const { return statsJsonFile; }
+    // Empty when no trace should be written
+    const std::string& getTraceFile() const { return traceFile; }
+
+    SortConfig getSortConfig() const;
+    // The options of a sort from stdin to stdout
+    ExternalSorterOptions getExternalSorterOptions() const;
+    // The shards of a sharded sort and the command that sorts one of them
+    // with the options of this sort
+    ShardConfig getShardConfig() const;
 
    private:
     void parse(int argc, char** argv);
@@ -31,14 +85,55 @@ class SortOptions {
 
     void parseBufferCount(int& i, int argc, char** argv);
     void parseBlockingFactor(int& i, int argc, char** argv);
+    void parseRecordWidth(int& i, int argc, char** argv);
+    void parsePageFormat(int& i, int argc, char** argv);
+    void parseRunFormat(int& i, int argc, char** argv);
+    void parseOrder(int& i, int argc, char** argv);
+    void parseIndexStride(int& i, int argc, char** argv);
+    void parseLimit(int& i, int argc, char** argv);
+    void parseSortedPages(int& i, int argc, char** argv);
+    void parseTempPlacement(int& i, int argc, char** argv);
+    void parseThreadCount(int& i, int argc, char** argv);
+    void parseShardCount(int& i, int argc, char** argv);
+    void parseSampleSize(int& i, int argc, char** argv);
 
-    void checkRequired() const;
+    void checkRequired();
+    void checkStreaming();
+    void checkSharding();
     void printHelpAndExit(int exitCode = 1) const;
 
     size_t bufferCount = 5;
     size_t blockingFactor = 10;
+    size_t recordWidth = Record::maxLen;
+    PageFormat pageFormat = PageFormat::FIXED;
+    std::optional<PageFormat> runFormat;
+    RecordOrder order;
+    size_t indexStride = 0;
+    DedupMode dedup = DedupMode::NONE;
+    std::optional<size_t> limit;
+    bool releaseConsumed = false;
+    bool checkpoint = false;
+    bool resume = false;
+    size_t threadCount = 1;
+    bool pipelined = false;
+    // 0 unless sharding
+    size_t shardCount = 0;
     bool logging = true;
+    bool perfCounters = false;
+    size_t sampleSize = 0;
+    bool dumpContents = false;
     std::string fileName;
+    std::vector<std::string> fileNames;
+    std::string outputFileName;
+    std::vector<std::string> inputFileNames;
+    bool sortInputs = false;
+    size_t sortedPages = 0;
+    bool streaming = false;
+    StreamFormat streamFormat = StreamFormat::BINARY;
+    std::vector<std::string> tempDirectories;
+    TempPlacement tempPlacement = TempPlacement::ROUND_ROBIN;
+    std::string statsJsonFile;
+    std::string traceFile;
     std::string scriptName;
 };
 
@@ -0,0 +1,1536 @@
+#include "sorter.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <queue>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "bounded_queue.hpp"
+#include "buffer.hpp"
+#include "checkpoint.hpp"
+#include "diagnostics.hpp"
+#include "error.hpp"
+#include "file_buffering.hpp"
+#include "metrics.hpp"
+#include "record_order.hpp"
+#include "temp_file.hpp"
+#include "trace.hpp"
+
+// Sorts every buffer, spreading them over at most threadCount threads
+template <typename Record, typename Less>
+static void sortBuffers(
+    std::vector<std::vector<Record>>& buffers, size_t threadCount, Less less
+) {
+    TRACE_SPAN("sort_buffers");
+    size_t recordCount = 0;
+    for (const auto& b : buffers) {
+        recordCount += b.size();
+    }
+    SectionScope section("in_buffer_sort", recordCount);
+
+    threadCount = std::min(threadCount, buffers.size());
+    if (threadCount <= 1) {
+        for (auto& b : buffers) {
+            TRACE_SPAN("sort_buffer");
+            std::ranges::sort(b, less);
+        }
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < threadCount; t++) {
+        threads.emplace_back([&, t]() {
+            TRACE_THREAD_NAME("sort_worker");
+            for (size_t i = t; i < buffers.size(); i += threadCount) {
+                TRACE_SPAN("sort_buffer");
+                std::ranges::sort(buffers[i], less);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
+namespace {
+
+// Appends the merged records of one run to an output buffer, or anything
+// else with an append. With `collapse` a record equal to the one before it is
+// dropped, with `counts` every distinct record is also written there along
+// with how often it was seen. Once `limit` records are written the output is
+// done.
+template <size_t RecordLen, typename Output = BasicBuffer<RecordLen>>
+class MergeOutput {
+   public:
+    using Record = BasicRecord<RecordLen>;
+
+    MergeOutput(
+        Output& out,
+        bool collapse,
+        std::ostream* counts,
+        std::optional<size_t> limit = std::nullopt
+    )
+        : out(out),
+          collapse(collapse || counts != nullptr),
+          counts(counts),
+          limit(limit) {}
+
+    // Returns whether `r` was appended
+    bool add(const Record& r) {
+        if (collapse && last.has_value() && *last == r) {
+            lastCount++;
+            return false;
+        }
+        // NOTE: Duplicates of the last record are still counted
+        if (limit.has_value() && written == *limit) {
+            done = true;
+            return false;
+        }
+        writeCount();
+        out.append(r);
+        written++;
+        if (collapse) {
+            last = r;
+            lastCount = 1;
+        }
+        return true;
+    }
+
+    // Must be called once the run is complete
+    void finish() {
+        writeCount();
+        last.reset();
+    }
+
+    size_t getWritten() const { return written; }
+    // Whether no more records will be appended
+    bool isDone() const { return done; }
+
+   private:
+    void writeCount() {
+        if (counts != nullptr && last.has_value()) {
+            *counts << std::format("{} {}\n", lastCount, last->str());
+        }
+    }
+
+    Output& out;
+    bool collapse;
+    std::ostream* counts;
+    std::optional<size_t> limit;
+    std::optional<Record> last;
+    size_t lastCount = 0;
+    size_t written = 0;
+    bool done = false;
+};
+
+// Limit of a run or merge group. Runs of DedupMode::COUNT still hold their
+// duplicates, so only the sorted file can be cut.
+static std::optional<size_t> runLimit(const SortConfig& config, bool isFinal) {
+    if (config.dedup == DedupMode::COUNT && !isFinal) {
+        return std::nullopt;
+    }
+    return config.limit;
+}
+
+// K-way merge of inputs sorted by `less` into `output` until the inputs run
+// out or the output is done. With `inputNames` every input is checked to be
+// sorted, and one that is not throws std::runtime_error naming it. Returns
+// the number of records read.
+template <size_t RecordLen, typename Output, typename Less>
+size_t mergeBuffers(
+    std::span<BasicBuffer<RecordLen>> inputs,
+    MergeOutput<RecordLen, Output>& output,
+    std::optional<RunSummary<RecordLen>>& summary,
+    Less less,
+    const std::vector<std::string>* inputNames = nullptr
+) {
+    // NOTE: The queue puts its largest element on top
+    auto cmp = [&](auto& a, auto& b) {
+        return less(inputs[b.first][b.second], inputs[a.first][a.second]);
+    };
+    std::priority_queue<
+        std::pair<size_t, size_t>,
+        std::vector<std::pair<size_t, size_t>>,
+        decltype(cmp)>
+        pq(cmp);
+
+    // NOTE: Initialize pg with first element from each nonempty buffer
+    for (size_t i = 0; i < inputs.size(); i++) {
+        if (!inputs[i].empty()) {
+            pq.push({i, 0});
+        }
+    }
+
+    size_t records = 0;
+    while (!pq.empty() && !output.isDone()) {
+        auto [bufIdx, elemIdx] = pq.top();
+        pq.pop();
+
+        const auto r = inputs[bufIdx][elemIdx];
+        records++;
+        if (output.add(r) && summary) {
+            summary->add(r);
+        }
+
+        // Add next element from same buffer
+        if (inputs[bufIdx].has(elemIdx + 1)) {
+            if (inputNames != nullptr && less(inputs[bufIdx][elemIdx + 1], r)) {
+                THROW_FORMATTED(
+                    std::runtime_error,
+                    "{} is not sorted, record {} is out of order",
+                    (*inputNames)[bufIdx],
+                    elemIdx + 1
+                );
+            }
+            pq.push({bufIdx, elemIdx + 1});
+        }
+    }
+    return records;
+}
+
+// Side outputs of the sorted file `fileName` that the config asks for
+template <size_t RecordLen>
+class FinalOutputFiles {
+   public:
+    FinalOutputFiles(const std::string& fileName, const SortConfig& config)
+        : fileName(fileName) {
+        // NOTE: Lookups search the index by the bytes of the records
+        if (config.indexStride != 0 && !config.order.isBytes()) {
+            THROW_FORMATTED(
+                std::invalid_argument,
+                "An index of a file sorted in {} order can not be searched",
+                recordOrderName(config.order)
+            );
+        }
+        if (config.indexStride != 0) {
+            index.emplace(config.indexStride);
+            outputs.index = &*index;
+        }
+        if (config.dedup == DedupMode::COUNT) {
+            counts.open(countsPath(fileName), std::ios::trunc);
+            if (!counts.is_open()) {
+                THROW_FORMATTED(
+                    std::runtime_error,
+                    "Could not open {} for writing",
+                    countsPath(fileName)
+                );
+            }
+            outputs.counts = &counts;
+        }
+    }
+
+    const FinalOutputs<RecordLen>& get() const { return outputs; }
+
+    // Writes the index once the sorted file `f` is complete
+    void save(const BasicBufferedFile<RecordLen>& f) const {
+        if (index) {
+            index->save(
+                fenceIndexPath(fileName),
+                f.getRecordsPerPage(),
+                f.getPageFormat()
+            );
+        }
+    }
+
+   private:
+    std::string fileName;
+    std::optional<BasicFenceIndex<RecordLen>> index;
+    std::ofstream counts;
+    FinalOutputs<RecordLen> outputs;
+};
+
+// Format of the runs written while sorting into the format `sorted`. Runs
+// that drop records do not fill whole pages, so PageFormat::FIXED gets
+// PageFormat::PREFIX runs. Throws std::invalid_argument for fixed runs of a
+// file in another format or runs that drop records.
+PageFormat runFormatFor(PageFormat sorted, const SortConfig& config) {
+    // NOTE: Its pages hold any number of records, so runs end within a page
+    // and fixed pages would pad them with records
+    if (config.runFormat == PageFormat::FIXED && sorted != PageFormat::FIXED) {
+        THROW_FORMATTED(
+            std::invalid_argument,
+            "Runs of a file in the {} format can not be in the fixed format",
+            pageFormatName(sorted)
+        );
+    }
+    bool shrinksRuns =
+        config.dedup == DedupMode::UNIQUE || config.limit.has_value();
+    if (config.runFormat == PageFormat::FIXED && shrinksRuns) {
+        THROW_FORMATTED(
+            std::invalid_argument,
+            "Runs that drop duplicates or stop at a limit can not be in the "
+            "fixed format"
+        );
+    }
+    return config.runFormat.value_or(
+        shrinksRuns && sorted == PageFormat::FIXED ? PageFormat::PREFIX
+                                                   : sorted
+    );
+}
+
+// Pages [beginPage, endPage) of a file that hold one sorted run. `name`
+// tells which one is not sorted in the error if it turns out not to be.
+template <size_t RecordLen>
+struct RunSource {
+    BasicBufferedFile<RecordLen>* file;
+    size_t beginPage;
+    size_t endPage;
+    std::string name;
+};
+
+// One merge phase, merging the runs of `src` bufferCount - 1 at a time into
+// runs of `dest`. `finalOutputs` is only given when the phase writes the
+// sorted file as its single run.
+template <size_t RecordLen, typename Less>
+RunLayout mergePhase(
+    BasicBufferedFile<RecordLen>& src,
+    BasicBufferedFile<RecordLen>& dest,
+    const RunLayout& runs,
+    const SortConfig& config,
+    SortStats& stats,
+    const FinalOutputs<RecordLen>* finalOutputs,
+    Less less
+) {
+    using Buffer = BasicBuffer<RecordLen>;
+
+    std::vector<Buffer> buffers;
+    buffers.reserve(config.bufferCount);
+    auto srcBegin = src.pages().begin();
+    RunLayout merged;
+    stats.phaseCount++;
+    PhaseScope phase(std::format("merge_phase_{}", stats.phaseCount));
+    TRACE_SPAN_ARG("merge_phase", "phase", stats.phaseCount);
+
+    if (config.logging) {
+        std::cout << "Phase " << stats.phaseCount << std::endl;
+        std::cout << "Merging " << runs.runStarts.size() << " runs, "
+                  << config.bufferCount - 1 << " at a time" << std::endl;
+
+        std::cout << "dest = " << dest.getFileName() << std::endl;
+        std::cout << "src = " << src.getFileName() << std::endl;
+    }
+
+    // Only filled when logging
+    std::optional<RunSummary<RecordLen>> summary;
+    size_t phaseRuns = 0;
+    size_t phaseRecords = 0;
+    uint64_t phaseChecksum = 0;
+    // First page of src that is not released yet
+    size_t releasedPage = 0;
+
+    // NOTE: Do one merge pass
+    for (size_t run = 0; run < runs.runStarts.size();) {
+        TRACE_SPAN("merge_group");
+        buffers.clear();
+        size_t inputBuffersUsed = 0;
+
+        // NOTE: Fill all input buffers
+        for (; inputBuffersUsed < config.bufferCount - 1 &&
+               run < runs.runStarts.size();
+             inputBuffersUsed++, run++) {
+            size_t runEnd = run + 1 < runs.runStarts.size()
+                                ? runs.runStarts[run + 1]
+                                : runs.pageCount;
+            buffers.emplace_back(
+                srcBegin + runs.runStarts[run], srcBegin + runEnd
+            );
+            if (config.releaseConsumed) {
+                buffers.back().releaseConsumedPages();
+            }
+        }
+
+        // Setup output buffer, each merge group writes right after the
+        // previous one
+        buffers.emplace_back(std::ranges::subrange(
+            dest.pages().begin() + merged.pageCount, dest.pages().end()
+        ));
+        // The last phase has a single group, which writes the sorted file
+        const FinalOutputs<RecordLen>* groupOutputs = finalOutputs;
+        if (groupOutputs != nullptr && groupOutputs->index != nullptr) {
+            groupOutputs->index->clear();
+            buffers.back().setFenceIndex(groupOutputs->index);
+        }
+        MergeOutput<RecordLen> output(
+            buffers.back(),
+            config.dedup == DedupMode::UNIQUE,
+            groupOutputs != nullptr ? groupOutputs->counts : nullptr,
+            runLimit(config, groupOutputs != nullptr)
+        );
+
+        if (config.logging) {
+            summary.emplace(config.sampleSize);
+        }
+
+        Metrics::instance().addRecords(mergeBuffers(
+            std::span(buffers).first(inputBuffersUsed), output, summary, less
+        ));
+        output.finish();
+        if (groupOutputs != nullptr) {
+            stats.outputCount = output.getWritten();
+        }
+
+        merged.runStarts.push_back(merged.pageCount);
+        merged.pageCount += buffers.back().pageCount();
+
+        // The buffers keep the pages they stopped in and what a limit left
+        // unread. Groups are adjacent, so a block the group ends in is
+        // released with the next one.
+        if (config.releaseConsumed) {
+            releasedPage = src.releasePages(
+                releasedPage,
+                run < runs.runStarts.size() ? runs.runStarts[run]
+                                            : runs.pageCount
+            );
+        }
+
+        if (summary) {
+            phaseRuns++;
+            phaseRecords += summary->getCount();
+            phaseChecksum += summary->getChecksum();
+            summary->print(std::cout, std::format("Run {}", phaseRuns));
+        }
+    }
+
+    // Write the last page now so it is counted in this phase
+    buffers.clear();
+    dest.flush();
+    // NOTE: Every run of src was merged, dropping its holes lets the next
+    // phase append to it
+    if (config.releaseConsumed) {
+        src.truncate(0);
+    }
+
+    if (config.logging) {
+        // Must match the checksum of every other phase, unless
+        // duplicates are dropped
+        std::cout << std::format(
+            "Phase {}: runs={} count={} checksum={:016x}\n",
+            stats.phaseCount,
+            phaseRuns,
+            phaseRecords,
+            phaseChecksum
+        ) << std::endl;
+    }
+    if (config.dumpContents) {
+        std::cout << "File contents:" << std::endl;
+        dest.printFileContent();
+    }
+
+    return merged;
+}
+
+// createRuns and mergeRuns with the order of the config known at compile
+// time
+template <size_t RecordLen, typename Less>
+RunLayout createRunsBy(
+    BasicBufferedFile<RecordLen>& in,
+    BasicBufferedFile<RecordLen>& out,
+    const SortConfig& config,
+    SortStats& stats,
+    const FinalOutputs<RecordLen>* finalOutputs,
+    size_t firstPage,
+    Less less
+);
+template <size_t RecordLen, typename Less>
+void mergeRunsBy(
+    BasicBufferedFile<RecordLen>& f,
+    BasicBufferedFile<RecordLen>& runFile,
+    RunLayout runs,
+    const SortConfig& config,
+    SortStats& stats,
+    const FinalOutputs<RecordLen>* finalOutputs,
+    Less less
+);
+
+// A merge phase whose runs may lie in different files, checking that every
+// one is sorted. With more runs than input buffers it writes one run per
+// group to a temporary file and mergeRuns cascades them into f. Runs may lie
+// in f itself, then even the last phase writes a temporary file, which is
+// copied into f.
+template <size_t RecordLen, typename Less>
+void mergeSources(
+    const std::vector<RunSource<RecordLen>>& sources,
+    BasicBufferedFile<RecordLen>& f,
+    const SortConfig& config,
+    SortStats& stats,
+    const FinalOutputs<RecordLen>& outputs,
+    Less less
+) {
+    using Buffer = BasicBuffer<RecordLen>;
+
+    const size_t fanIn = config.bufferCount - 1;
+    const bool isLastPhase = sources.size() <= fanIn;
+    const bool readsF = std::ranges::any_of(sources, [&](const auto& source) {
+        return source.file == &f;
+    });
+    std::optional<BasicTempFile<RecordLen>> t;
+    BasicBufferedFile<RecordLen>* dest = &f;
+    if (!isLastPhase || readsF) {
+        t.emplace(
+            f.getRecordsPerPage(),
+            isLastPhase ? f.getPageFormat()
+                        : runFormatFor(f.getPageFormat(), config)
+        );
+        dest = &static_cast<BasicBufferedFile<RecordLen>&>(*t);
+    }
+    const FinalOutputs<RecordLen>* groupOutputs =
+        isLastPhase ? &outputs : nullptr;
+
+    std::vector<std::string> names;
+    for (const auto& source : sources) {
+        names.push_back(source.name);
+    }
+
+    RunLayout runs;
+    {
+        stats.phaseCount++;
+        PhaseScope phase(std::format("merge_phase_{}", stats.phaseCount));
+        TRACE_SPAN_ARG("merge_phase", "phase", stats.phaseCount);
+        if (config.logging) {
+            std::cout << "Phase " << stats.phaseCount << std::endl;
+            std::cout << "Merging " << sources.size() << " runs, " << fanIn
+                      << " at a time" << std::endl;
+            std::cout << "dest = " << dest->getFileName() << std::endl;
+        }
+
+        // Only filled when logging
+        std::optional<RunSummary<RecordLen>> summary;
+
+        for (size_t first = 0; first < sources.size(); first += fanIn) {
+            TRACE_SPAN("merge_group");
+            size_t last = std::min(first + fanIn, sources.size());
+
+            std::vector<Buffer> buffers;
+            buffers.reserve(last - first + 1);
+            for (size_t i = first; i < last; i++) {
+                auto begin = sources[i].file->pages().begin();
+                buffers.emplace_back(
+                    begin + sources[i].beginPage, begin + sources[i].endPage
+                );
+            }
+            buffers.emplace_back(std::ranges::subrange(
+                dest->pages().begin() + runs.pageCount, dest->pages().end()
+            ));
+            if (groupOutputs != nullptr) {
+                buffers.back().setFenceIndex(groupOutputs->index);
+            }
+            MergeOutput<RecordLen> output(
+                buffers.back(),
+                config.dedup == DedupMode::UNIQUE,
+                groupOutputs != nullptr ? groupOutputs->counts : nullptr,
+                runLimit(config, isLastPhase)
+            );
+
+            if (config.logging) {
+                summary.emplace(config.sampleSize);
+            }
+
+            std::vector<std::string> groupNames(
+                names.begin() + first, names.begin() + last
+            );
+            Metrics::instance().addRecords(mergeBuffers(
+                std::span(buffers).first(last - first),
+                output,
+                summary,
+                less,
+                &groupNames
+            ));
+            output.finish();
+            if (groupOutputs != nullptr) {
+                stats.outputCount = output.getWritten();
+            }
+
+            runs.runStarts.push_back(runs.pageCount);
+            runs.pageCount += buffers.back().pageCount();
+
+            if (summary) {
+                summary->print(
+                    std::cout, std::format("Run {}", runs.runStarts.size())
+                );
+            }
+        }
+
+        // Write the last page now so it is counted in this phase
+        dest->flush();
+        if (config.dumpContents) {
+            std::cout << "File contents:" << std::endl;
+            dest->printFileContent();
+        }
+    }
+
+    if (dest != &f) {
+        mergeRunsBy(f, *dest, std::move(runs), config, stats, &outputs, less);
+    }
+}
+
+// Hands merged records to a callback, the output of a MergeOutput
+template <size_t RecordLen>
+class CallbackSink {
+   public:
+    explicit CallbackSink(const RecordSink<RecordLen>& sink) : sink(sink) {}
+
+    void append(const BasicRecord<RecordLen>& r) { sink(r); }
+
+   private:
+    const RecordSink<RecordLen>& sink;
+};
+
+// Tells `progress` where the sort stands, if it is set
+static void reportProgress(
+    const ProgressCallback& progress,
+    const SortStats& stats,
+    size_t runsLeft
+) {
+    if (progress) {
+        progress(SortProgress{
+            .phaseCount = stats.phaseCount,
+            .runCount = runsLeft,
+            .io = Metrics::instance().totals(),
+        });
+    }
+}
+
+// Keeps the `limit` records of f that come first in a bounded max heap
+// while reading it once, then writes them sorted over the start of f
+template <size_t RecordLen, typename Less>
+static void selectSmallest(
+    BasicBufferedFile<RecordLen>& f,
+    size_t limit,
+    const SortConfig& config,
+    SortStats& stats,
+    const FinalOutputs<RecordLen>& outputs,
+    Less less
+) {
+    using Record = BasicRecord<RecordLen>;
+
+    PhaseScope phase("select_smallest");
+    TRACE_SPAN("select_smallest");
+    if (config.logging) {
+        std::cout << "Selecting the " << limit << " smallest records\n"
+                  << std::endl;
+    }
+
+    std::priority_queue<Record, std::vector<Record>, Less> heap(less);
+    size_t recordCount = 0;
+    for (std::vector<Record> page : f.pages()) {
+        recordCount += page.size();
+        for (const auto& r : page) {
+            if (heap.size() < limit) {
+                heap.push(r);
+            } else if (limit != 0 && less(r, heap.top())) {
+                heap.pop();
+                heap.push(r);
+            }
+        }
+    }
+    Metrics::instance().addRecords(recordCount);
+
+    std::vector<Record> smallest(heap.size());
+    for (size_t i = smallest.size(); i-- > 0; heap.pop()) {
+        smallest[i] = heap.top();
+    }
+
+    size_t pageCount = 0;
+    {
+        BasicBuffer<RecordLen> out(f.pages());
+        out.setFenceIndex(outputs.index);
+        for (const auto& r : smallest) {
+            out.append(r);
+        }
+        pageCount = out.pageCount();
+    }
+    f.truncate(pageCount);
+    stats.runCount = smallest.empty() ? 0 : 1;
+    stats.outputCount = smallest.size();
+}
+
+// Records that the runs of the sort of f now lie in `runFile`. They are
+// synced first, so a checkpoint never names runs that are not on disk.
+template <size_t RecordLen>
+void saveCheckpoint(
+    BasicBufferedFile<RecordLen>& f,
+    BasicBufferedFile<RecordLen>& runFile,
+    const RunLayout& runs,
+    const SortConfig& config,
+    const SortStats& stats,
+    const std::vector<std::string>& workFiles
+) {
+    TRACE_SPAN("save_checkpoint");
+    runFile.sync();
+    Checkpoint checkpoint{
+        .recordWidth = RecordLen,
+        .recordsPerPage = f.getRecordsPerPage(),
+        .pageFormat = f.getPageFormat(),
+        .runFormat = runFile.getPageFormat(),
+        .order = config.order,
+        .runCount = stats.runCount,
+        .phaseCount = stats.phaseCount,
+        .runFile = runFile.getFileName(),
+        .runs = runs,
+        .workFiles = workFiles,
+    };
+    checkpoint.save(checkpointPath(f.getFileName()));
+}
+
+// Continues the sort of f with the merge phases that follow `checkpoint`.
+// Temporary files of the failed sort that do not hold its runs are removed.
+template <size_t RecordLen, typename Less>
+void resumeSort(
+    BasicBufferedFile<RecordLen>& f,
+    const Checkpoint& checkpoint,
+    const SortConfig& config,
+    SortStats& stats,
+    const FinalOutputs<RecordLen>& outputs,
+    Less less
+) {
+    const std::string path = checkpointPath(f.getFileName());
+    if (checkpoint.recordWidth != RecordLen ||
+        checkpoint.recordsPerPage != f.getRecordsPerPage() ||
+        checkpoint.pageFormat != f.getPageFormat()) {
+        THROW_FORMATTED(
+            std::invalid_argument,
+            "{} is of a sort with records of width {}, {} records per page "
+            "and {} pages, resume with the same options",
+            path,
+            checkpoint.recordWidth,
+            checkpoint.recordsPerPage,
+            pageFormatName(checkpoint.pageFormat)
+        );
+    }
+    if (checkpoint.order != config.order) {
+        THROW_FORMATTED(
+            std::invalid_argument,
+            "{} is of a sort in {} order, resume with the same order",
+            path,
+            recordOrderName(checkpoint.order)
+        );
+    }
+    for (const auto& workFile : checkpoint.workFiles) {
+        if (workFile != checkpoint.runFile) {
+            std::filesystem::remove(workFile);
+        }
+    }
+
+    stats.runCount = checkpoint.runCount;
+    stats.phaseCount = checkpoint.phaseCount;
+    if (config.logging) {
+        std::cout << std::format(
+            "Resuming after phase {} with {} runs in {}\n",
+            checkpoint.phaseCount,
+            checkpoint.runs.runStarts.size(),
+            checkpoint.runFile
+        ) << std::endl;
+    }
+
+    if (checkpoint.runFile == f.getFileName()) {
+        mergeRunsBy(f, f, checkpoint.runs, config, stats, &outputs, less);
+        return;
+    }
+    if (!std::filesystem::exists(checkpoint.runFile)) {
+        THROW_FORMATTED(
+            std::runtime_error,
+            "{} has its runs in {}, which no longer exists",
+            path,
+            checkpoint.runFile
+        );
+    }
+    BasicTempFile<RecordLen> t(
+        checkpoint.runFile,
+        f.getRecordsPerPage(),
+        checkpoint.runFormat,
+        config.checkpoint
+    );
+    auto& runFile = static_cast<BasicBufferedFile<RecordLen>&>(t);
+    if (runFile.getPageCount() < checkpoint.runs.pageCount) {
+        THROW_FORMATTED(
+            std::runtime_error,
+            "{} has {} pages of runs, but {} only has {}",
+            path,
+            checkpoint.runs.pageCount,
+            checkpoint.runFile,
+            runFile.getPageCount()
+        );
+    }
+    mergeRunsBy(f, runFile, checkpoint.runs, config, stats, &outputs, less);
+}
+
+}  // namespace
+
+std::string countsPath(const std::string& fileName) {
+    return fileName + ".counts";
+}
+
+// Every sort below takes its order as the comparison policy `less`. The
+// public functions at the end choose it from the config once per sort.
+namespace {
+
+template <size_t RecordLen, typename Less>
+SortStats sortFileBy(
+    BasicBufferedFile<RecordLen>& f, const SortConfig& config, Less less
+) {
+    SortStats stats;
+    FinalOutputFiles<RecordLen> finalFiles(f.getFileName(), config);
+    const FinalOutputs<RecordLen>& outputs = finalFiles.get();
+
+    if (config.resume) {
+        auto checkpoint = Checkpoint::load(checkpointPath(f.getFileName()));
+        if (checkpoint.has_value()) {
+            resumeSort(f, *checkpoint, config, stats, outputs, less);
+            finalFiles.save(f);
+            return stats;
+        }
+    }
+
+    // Without duplicates the smallest records fit in the run buffers
+    size_t bufferRecords = config.bufferCount * f.getRecordsPerPage();
+    if (config.limit.has_value() && *config.limit <= bufferRecords &&
+        config.dedup == DedupMode::NONE) {
+        selectSmallest(f, *config.limit, config, stats, outputs, less);
+        finalFiles.save(f);
+        return stats;
+    }
+
+    PageFormat runFormat = runFormatFor(f.getPageFormat(), config);
+    // A single run in the format of f is the sorted file, no phase follows
+    bool runsAreFinal = f.getPageCount() <= config.bufferCount &&
+                        runFormat == f.getPageFormat();
+    auto* runOutputs = runsAreFinal ? &outputs : nullptr;
+
+    // NOTE: Runs written over the input can not be generated again, so a
+    // sort that may be resumed writes them to a temporary file
+    if (f.getCodec().isFixed() && runFormat == PageFormat::FIXED &&
+        !config.checkpoint) {
+        RunLayout runs =
+            createRunsBy(f, f, config, stats, runOutputs, 0, less);
+        mergeRunsBy(f, f, std::move(runs), config, stats, &outputs, less);
+    } else {
+        // NOTE: Records are packed differently once sorted, so a run may need
+        // more pages than it was read from and would overwrite unread input
+        BasicTempFile<RecordLen> t(
+            f.getRecordsPerPage(), runFormat, config.checkpoint
+        );
+        auto& runFile = static_cast<BasicBufferedFile<RecordLen>&>(t);
+        RunLayout runs =
+            createRunsBy(f, runFile, config, stats, runOutputs, 0, less);
+        if (config.checkpoint) {
+            saveCheckpoint(
+                f, runFile, runs, config, stats, {runFile.getFileName()}
+            );
+        }
+        mergeRunsBy(
+            f, runFile, std::move(runs), config, stats, &outputs, less
+        );
+    }
+
+    finalFiles.save(f);
+    return stats;
+}
+
+template <size_t RecordLen, typename Less>
+SortStats mergeFilesBy(
+    const std::vector<BasicBufferedFile<RecordLen>*>& inputs,
+    BasicBufferedFile<RecordLen>& f,
+    const SortConfig& config,
+    Less less
+) {
+    SortStats stats;
+    stats.runCount = inputs.size();
+    FinalOutputFiles<RecordLen> finalFiles(f.getFileName(), config);
+
+    std::vector<RunSource<RecordLen>> sources;
+    for (auto* in : inputs) {
+        sources.push_back({in, 0, in->getPageCount(), in->getFileName()});
+    }
+    mergeSources(sources, f, config, stats, finalFiles.get(), less);
+
+    finalFiles.save(f);
+    return stats;
+}
+
+template <size_t RecordLen, typename Less>
+SortStats sortAppendedBy(
+    BasicBufferedFile<RecordLen>& f,
+    size_t sortedPages,
+    const SortConfig& config,
+    Less less
+) {
+    // NOTE: The last sorted page of a fixed file can end in padding, which
+    // need not be in order with the records before it, so it is sorted along
+    // with the appended pages
+    sortedPages = std::min(sortedPages, f.getPageCount());
+    if (sortedPages != 0 && f.getPageFormat() == PageFormat::FIXED) {
+        sortedPages--;
+    }
+    if (sortedPages == 0) {
+        return sortFileBy(f, config, less);
+    }
+
+    SortStats stats;
+    FinalOutputFiles<RecordLen> finalFiles(f.getFileName(), config);
+
+    // NOTE: Only the appended pages go through run generation, the sorted
+    // pages are merged with their runs as they are
+    BasicTempFile<RecordLen> t(
+        f.getRecordsPerPage(), runFormatFor(f.getPageFormat(), config)
+    );
+    auto& runFile = static_cast<BasicBufferedFile<RecordLen>&>(t);
+    RunLayout runs = createRunsBy<RecordLen>(
+        f, runFile, config, stats, nullptr, sortedPages, less
+    );
+
+    std::vector<RunSource<RecordLen>> sources{
+        {&f,
+         0,
+         sortedPages,
+         std::format("{} up to page {}", f.getFileName(), sortedPages)}
+    };
+    for (size_t run = 0; run < runs.runStarts.size(); run++) {
+        size_t runEnd = run + 1 < runs.runStarts.size()
+                            ? runs.runStarts[run + 1]
+                            : runs.pageCount;
+        sources.push_back(
+            {&runFile,
+             runs.runStarts[run],
+             runEnd,
+             std::format("Run {} of the appended pages", run + 1)}
+        );
+    }
+    stats.runCount = sources.size();
+    mergeSources(sources, f, config, stats, finalFiles.get(), less);
+
+    finalFiles.save(f);
+    return stats;
+}
+
+// Runs `fill`, `sort` and `write` on threads of their own, each on another
+// one of `batches`, which go around from one stage to the next. `fill`
+// returns false once there is nothing left to sort. The first exception of
+// a stage stops the others and is rethrown once they are done.
+template <typename Batch, typename Fill, typename Sort, typename Write>
+static void pipelineBatches(
+    std::vector<Batch> batches, Fill fill, Sort sort, Write write
+) {
+    BoundedQueue<Batch> empty(batches.size());
+    BoundedQueue<Batch> filled(batches.size());
+    BoundedQueue<Batch> sorted(batches.size());
+    for (auto& batch : batches) {
+        empty.push(std::move(batch));
+    }
+    auto closeAll = [&]() {
+        empty.close();
+        filled.close();
+        sorted.close();
+    };
+
+    std::exception_ptr fillError;
+    std::exception_ptr sortError;
+    std::exception_ptr writeError;
+    std::thread reader([&]() {
+        TRACE_THREAD_NAME("run_reader");
+        try {
+            while (auto batch = empty.pop()) {
+                if (!fill(*batch) || !filled.push(std::move(*batch))) {
+                    break;
+                }
+            }
+        } catch (...) {
+            fillError = std::current_exception();
+            closeAll();
+        }
+        filled.close();
+    });
+    std::thread sorter([&]() {
+        TRACE_THREAD_NAME("run_sorter");
+        try {
+            while (auto batch = filled.pop()) {
+                sort(*batch);
+                if (!sorted.push(std::move(*batch))) {
+                    break;
+                }
+            }
+        } catch (...) {
+            sortError = std::current_exception();
+            closeAll();
+        }
+        sorted.close();
+    });
+
+    // NOTE: Runs are written on this thread, like without a pipeline
+    try {
+        while (auto batch = sorted.pop()) {
+            write(*batch);
+            empty.push(std::move(*batch));
+        }
+    } catch (...) {
+        writeError = std::current_exception();
+    }
+    closeAll();
+    reader.join();
+    sorter.join();
+
+    for (auto error : {fillError, sortError, writeError}) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+// Run generation with the input pages coming from `nextPage`, which fills
+// the page it is given and returns false once the input is exhausted. With
+// SortConfig::pipelined it is called on a thread of its own.
+template <size_t RecordLen, typename NextPage, typename Less>
+RunLayout createRunsFrom(
+    NextPage&& nextPage,
+    BasicBufferedFile<RecordLen>& out,
+    const SortConfig& config,
+    SortStats& stats,
+    const FinalOutputs<RecordLen>* finalOutputs,
+    Less less
+) {
+    using Record = BasicRecord<RecordLen>;
+    using Buffer = BasicBuffer<RecordLen>;
+    using Batch = std::vector<std::vector<Record>>;
+
+    PhaseScope phase("run_generation");
+    TRACE_SPAN("run_generation");
+    if (config.logging) {
+        std::cout << "Stage 1: Divide into runs" << std::endl;
+    }
+
+    bool isFileEmpty = false;
+    RunLayout runs;
+
+    // Only filled when logging
+    std::optional<RunSummary<RecordLen>> summary;
+    size_t totalRecords = 0;
+    uint64_t totalChecksum = 0;
+
+    // NOTE: Fill all buffers, false once there are no records left
+    auto fill = [&](Batch& buffers) {
+        TRACE_SPAN("fill_buffers");
+        if (isFileEmpty) {
+            return false;
+        }
+        for (auto& b : buffers) {
+            if (!nextPage(b)) {
+                isFileEmpty = true;
+                break;
+            }
+        }
+        return !std::ranges::all_of(buffers, [](auto& b) {
+            return b.empty();
+        });
+    };
+
+    auto sort = [&](Batch& buffers) {
+        sortBuffers(buffers, config.threadCount, less);
+    };
+
+    auto write = [&](Batch& buffers) {
+        TRACE_SPAN_ARG("run", "run", stats.runCount + 1);
+
+        // NOTE: The queue puts its largest element on top
+        auto cmp = [&](auto& a, auto& b) {
+            return less(
+                buffers[b.first][b.second], buffers[a.first][a.second]
+            );
+        };
+        std::priority_queue<
+            std::pair<size_t, size_t>,
+            std::vector<std::pair<size_t, size_t>>,
+            decltype(cmp)>
+            pq(cmp);
+
+        // NOTE: Initialize pg with first element from each nonempty buffer
+        size_t runRecords = 0;
+        for (size_t i = 0; i < buffers.size(); i++) {
+            if (!buffers[i].empty()) {
+                pq.push({i, 0});
+            }
+            runRecords += buffers[i].size();
+        }
+        Metrics::instance().addRecords(runRecords);
+
+        if (config.logging) {
+            summary.emplace(config.sampleSize);
+        }
+
+        // NOTE: K-way merge, every run starts on a new page
+        {
+            Buffer outBuf(std::ranges::subrange(
+                out.pages().begin() + runs.pageCount, out.pages().end()
+            ));
+            MergeOutput<RecordLen> output(
+                outBuf,
+                config.dedup == DedupMode::UNIQUE,
+                finalOutputs != nullptr ? finalOutputs->counts : nullptr,
+                runLimit(config, finalOutputs != nullptr)
+            );
+            if (finalOutputs != nullptr) {
+                outBuf.setFenceIndex(finalOutputs->index);
+            }
+            while (!pq.empty() && !output.isDone()) {
+                auto [bufIdx, elemIdx] = pq.top();
+                pq.pop();
+
+                const auto& r = buffers[bufIdx][elemIdx];
+                if (output.add(r) && summary) {
+                    summary->add(r);
+                }
+
+                // Add next element from same buffer
+                if (elemIdx + 1 < buffers[bufIdx].size()) {
+                    pq.push({bufIdx, elemIdx + 1});
+                }
+            }
+            output.finish();
+            if (finalOutputs != nullptr) {
+                stats.outputCount = output.getWritten();
+            }
+            runs.runStarts.push_back(runs.pageCount);
+            runs.pageCount += outBuf.pageCount();
+        }
+
+        for (auto& b : buffers) {
+            b.clear();
+        }
+
+        stats.runCount++;
+        if (summary) {
+            totalRecords += summary->getCount();
+            totalChecksum += summary->getChecksum();
+            summary->print(std::cout, std::format("Run {}", stats.runCount));
+        }
+        if (config.dumpContents) {
+            std::cout << "File contents:" << std::endl;
+            out.printFileContent();
+            std::cout << std::endl;
+        }
+    };
+
+    if (config.pipelined) {
+        // NOTE: One batch for each stage
+        pipelineBatches(
+            std::vector<Batch>(3, Batch(config.bufferCount)), fill, sort, write
+        );
+    } else {
+        Batch buffers(config.bufferCount);
+        while (fill(buffers)) {
+            sort(buffers);
+            write(buffers);
+        }
+    }
+
+    if (config.logging) {
+        std::cout << std::format(
+            "Runs: runs={} count={} checksum={:016x}\n",
+            stats.runCount,
+            totalRecords,
+            totalChecksum
+        ) << std::endl;
+    }
+
+    // Write the last page now so it is counted in this phase
+    out.flush();
+    return runs;
+}
+
+template <size_t RecordLen, typename Less>
+RunLayout createRunsBy(
+    BasicBufferedFile<RecordLen>& in,
+    BasicBufferedFile<RecordLen>& out,
+    const SortConfig& config,
+    SortStats& stats,
+    const FinalOutputs<RecordLen>* finalOutputs,
+    size_t firstPage,
+    Less less
+) {
+    // NOTE: Pages are read past the cached page, which may hold a change
+    in.flush();
+    const size_t pageCount = in.getPageCount();
+    size_t pageIndex = firstPage;
+    // NOTE: Runs written over the pages they were read from take the space
+    // back right away
+    const bool releasing = config.releaseConsumed && &in != &out;
+    size_t releasedPage = firstPage;
+    // NOTE: Runs written over their input only write pages that were read
+    // already, so a pipeline may read while it writes
+    auto nextPage = [&](std::vector<BasicRecord<RecordLen>>& page) {
+        if (pageIndex >= pageCount) {
+            return false;
+        }
+        in.readPageInto(pageIndex++, page);
+        size_t consumed = pageIndex - releasedPage;
+        if (releasing && consumed * in.getPageSize() >=
+                             BasicBufferedFile<RecordLen>::releaseBatchBytes) {
+            releasedPage = in.releasePages(releasedPage, pageIndex);
+        }
+        return true;
+    };
+    RunLayout runs =
+        createRunsFrom(nextPage, out, config, stats, finalOutputs, less);
+    if (releasing) {
+        in.truncate(firstPage);
+    }
+    return runs;
+}
+
+template <size_t RecordLen, typename Less>
+SortStats sortRecordsBy(
+    const PageSource<RecordLen>& source,
+    const RecordSink<RecordLen>& sink,
+    size_t recordsPerPage,
+    const SortConfig& config,
+    const ProgressCallback& progress,
+    Less less
+) {
+    using BufferedFile = BasicBufferedFile<RecordLen>;
+    using Buffer = BasicBuffer<RecordLen>;
+
+    if (config.indexStride != 0 || config.dedup == DedupMode::COUNT) {
+        THROW_FORMATTED(
+            std::invalid_argument,
+            "Sorted records that are handed on have no file to write an "
+            "index or counts for"
+        );
+    }
+
+    // NOTE: A run ends within its last page, and fixed pages would pad it
+    // with records the source never gave
+    if (config.runFormat == PageFormat::FIXED) {
+        THROW_FORMATTED(
+            std::invalid_argument,
+            "Runs of sorted records that are handed on can not be in the "
+            "fixed format"
+        );
+    }
+
+    SortStats stats;
+    const PageFormat runFormat = config.runFormat.value_or(PageFormat::PREFIX);
+    BasicTempFile<RecordLen> t1(recordsPerPage, runFormat);
+    std::optional<BasicTempFile<RecordLen>> t2;
+    BufferedFile* work1 = &static_cast<BufferedFile&>(t1);
+    BufferedFile* src = work1;
+
+    RunLayout runs =
+        createRunsFrom<RecordLen>(source, *src, config, stats, nullptr, less);
+    reportProgress(progress, stats, runs.runStarts.size());
+
+    // NOTE: Leave as many runs as the last merge can take at once
+    const size_t fanIn = config.bufferCount - 1;
+    while (runs.runStarts.size() > fanIn) {
+        if (!t2.has_value()) {
+            t2.emplace(recordsPerPage, runFormat);
+        }
+        BufferedFile* dest =
+            src == work1 ? &static_cast<BufferedFile&>(*t2) : work1;
+        runs = mergePhase<RecordLen>(
+            *src, *dest, runs, config, stats, nullptr, less
+        );
+        src = dest;
+        reportProgress(progress, stats, runs.runStarts.size());
+    }
+
+    stats.phaseCount++;
+    PhaseScope phase(std::format("merge_phase_{}", stats.phaseCount));
+    TRACE_SPAN_ARG("merge_phase", "phase", stats.phaseCount);
+
+    std::vector<Buffer> buffers;
+    auto srcBegin = src->pages().begin();
+    for (size_t run = 0; run < runs.runStarts.size(); run++) {
+        size_t runEnd = run + 1 < runs.runStarts.size()
+                            ? runs.runStarts[run + 1]
+                            : runs.pageCount;
+        buffers.emplace_back(
+            srcBegin + runs.runStarts[run], srcBegin + runEnd
+        );
+        if (config.releaseConsumed) {
+            buffers.back().releaseConsumedPages();
+        }
+    }
+
+    CallbackSink<RecordLen> callbackSink(sink);
+    MergeOutput<RecordLen, CallbackSink<RecordLen>> output(
+        callbackSink, config.dedup == DedupMode::UNIQUE, nullptr, config.limit
+    );
+    std::optional<RunSummary<RecordLen>> summary;
+    Metrics::instance().addRecords(
+        mergeBuffers(std::span(buffers), output, summary, less)
+    );
+    output.finish();
+    stats.outputCount = output.getWritten();
+    reportProgress(progress, stats, 1);
+    return stats;
+}
+
+template <size_t RecordLen, typename Less>
+void mergeRunsBy(
+    BasicBufferedFile<RecordLen>& f,
+    BasicBufferedFile<RecordLen>& runFile,
+    RunLayout runs,
+    const SortConfig& config,
+    SortStats& stats,
+    const FinalOutputs<RecordLen>* finalOutputs,
+    Less less
+) {
+    using BufferedFile = BasicBufferedFile<RecordLen>;
+
+    TRACE_SPAN("merge_runs");
+    if (config.logging) {
+        std::cout << "Stage 2: Merging runs\n" << std::endl;
+    }
+
+    // A phase writes to f if it does not read from it and either the runs
+    // have the format of f or it is the last phase. Otherwise it writes to
+    // one of two work files, the run file and a temporary file, or two
+    // temporary files when the runs started out in f. Temporary files are
+    // only created once they are needed.
+    const PageFormat runFormat = runFile.getPageFormat();
+    std::optional<BasicTempFile<RecordLen>> t1;
+    std::optional<BasicTempFile<RecordLen>> t2;
+    BufferedFile* work1 = &runFile != &f ? &runFile : nullptr;
+    BufferedFile* work2 = nullptr;
+    auto workFileOtherThan = [&](BufferedFile* file) -> BufferedFile* {
+        if (work1 == nullptr) {
+            t1.emplace(f.getRecordsPerPage(), runFormat, config.checkpoint);
+            work1 = &static_cast<BufferedFile&>(*t1);
+        }
+        if (work1 != file) {
+            return work1;
+        }
+        if (work2 == nullptr) {
+            t2.emplace(f.getRecordsPerPage(), runFormat, config.checkpoint);
+            work2 = &static_cast<BufferedFile&>(*t2);
+        }
+        return work2;
+    };
+    auto workFileNames = [&]() {
+        std::vector<std::string> names;
+        for (BufferedFile* work : {work1, work2}) {
+            if (work != nullptr) {
+                names.push_back(work->getFileName());
+            }
+        }
+        return names;
+    };
+
+    BufferedFile* src = &runFile;
+    BufferedFile* dest = nullptr;
+
+    // NOTE: Do until one run remains in the format of f. A single run in
+    // another format still takes a phase to be rewritten into f.
+    while (runs.runStarts.size() > 1 ||
+           src->getPageFormat() != f.getPageFormat()) {
+        bool isLastPhase = runs.runStarts.size() <= config.bufferCount - 1;
+        if (src != &f && (isLastPhase || runFormat == f.getPageFormat())) {
+            dest = &f;
+        } else {
+            dest = workFileOtherThan(src);
+        }
+
+        runs = mergePhase(
+            *src,
+            *dest,
+            runs,
+            config,
+            stats,
+            isLastPhase ? finalOutputs : nullptr,
+            less
+        );
+        src = dest;
+        if (config.checkpoint) {
+            saveCheckpoint(f, *dest, runs, config, stats, workFileNames());
+        }
+    }
+
+    // Unless the format is fixed a file can hold pages of an earlier, longer
+    // phase past the sorted run
+    if (src->getPageCount() > runs.pageCount) {
+        src->truncate(runs.pageCount);
+    }
+
+    // After the last swap src is the file written last. If that is already
+    // the sorted file there is nothing to copy back.
+    if (src != &f) {
+        PhaseScope phase("final_copy");
+        TRACE_SPAN("final_copy");
+        f.copyFrom(*src, config.releaseConsumed);
+        stats.copiedBytes = f.getPageCount() * f.getPageSize();
+    } else {
+        f.flush();
+    }
+
+    if (config.checkpoint) {
+        f.sync();
+        std::filesystem::remove(checkpointPath(f.getFileName()));
+    }
+}
+
+}  // namespace
+
+template <size_t RecordLen>
+SortStats sortFile(BasicBufferedFile<RecordLen>& f, const SortConfig& config) {
+    return dispatchRecordOrder(config.order, [&]<typename Less>() {
+        return sortFileBy(f, config, Less{});
+    });
+}
+
+template <size_t RecordLen>
+SortStats mergeFiles(
+    const std::vector<BasicBufferedFile<RecordLen>*>& inputs,
+    BasicBufferedFile<RecordLen>& f,
+    const SortConfig& config
+) {
+    return dispatchRecordOrder(config.order, [&]<typename Less>() {
+        return mergeFilesBy(inputs, f, config, Less{});
+    });
+}
+
+template <size_t RecordLen>
+bool isSorted(BasicBufferedFile<RecordLen>& f, const RecordOrder& order) {
+    return dispatchRecordOrder(order, [&]<typename Less>() {
+        Less less;
+        std::optional<BasicRecord<RecordLen>> last;
+        for (size_t pageIndex = 0; pageIndex < f.getPageCount(); pageIndex++) {
+            for (const auto& r : f.readPage(pageIndex)) {
+                if (last.has_value() && less(r, *last)) {
+                    return false;
+                }
+                last = r;
+            }
+        }
+        return true;
+    });
+}
+
+template <size_t RecordLen>
+std::unique_ptr<BasicTempFile<RecordLen>> sortIntoTempFile(
+    BasicBufferedFile<RecordLen>& in, const SortConfig& config
+) {
+    auto copy = std::make_unique<BasicTempFile<RecordLen>>(
+        in.getRecordsPerPage(), in.getPageFormat()
+    );
+    BasicBufferedFile<RecordLen>& sorted = *copy;
+    sorted.copyFrom(in);
+    // NOTE: A checkpoint of a copy that is removed after the merge is no use
+    SortConfig copyConfig = config;
+    copyConfig.indexStride = 0;
+    copyConfig.dedup = DedupMode::NONE;
+    copyConfig.limit = std::nullopt;
+    copyConfig.checkpoint = false;
+    copyConfig.resume = false;
+    sortFile(sorted, copyConfig);
+    return copy;
+}
+
+template <size_t RecordLen>
+SortStats sortAppended(
+    BasicBufferedFile<RecordLen>& f,
+    size_t sortedPages,
+    const SortConfig& config
+) {
+    return dispatchRecordOrder(config.order, [&]<typename Less>() {
+        return sortAppendedBy(f, sortedPages, config, Less{});
+    });
+}
+
+template <size_t RecordLen>
+SortStats sortRecords(
+    const PageSource<RecordLen>& source,
+    const RecordSink<RecordLen>& sink,
+    size_t recordsPerPage,
+    const SortConfig& config,
+    const ProgressCallback& progress
+) {
+    return dispatchRecordOrder(config.order, [&]<typename Less>() {
+        return sortRecordsBy(
+            source, sink, recordsPerPage, config, progress, Less{}
+        );
+    });
+}
+
+template <size_t RecordLen>
+RunLayout createRuns(
+    BasicBufferedFile<RecordLen>& in,
+    BasicBufferedFile<RecordLen>& out,
+    const SortConfig& config,
+    SortStats& stats,
+    const FinalOutputs<RecordLen>* finalOutputs,
+    size_t firstPage
+) {
+    return dispatchRecordOrder(config.order, [&]<typename Less>() {
+        return createRunsBy(
+            in, out, config, stats, finalOutputs, firstPage, Less{}
+        );
+    });
+}
+
+template <size_t RecordLen>
+void mergeRuns(
+    BasicBufferedFile<RecordLen>& f,
+    BasicBufferedFile<RecordLen>& runFile,
+    RunLayout runs,
+    const SortConfig& config,
+    SortStats& stats,
+    const FinalOutputs<RecordLen>* finalOutputs
+) {
+    dispatchRecordOrder(config.order, [&]<typename Less>() {
+        mergeRunsBy(
+            f, runFile, std::move(runs), config, stats, finalOutputs, Less{}
+        );
+    });
+}
+
+#define INSTANTIATE_SORTER(W)                                               \
+    template SortStats sortFile<W>(BasicBufferedFile<W>&, const SortConfig&); \
+    template RunLayout createRuns<W>(                                       \
+        BasicBufferedFile<W>&,                                              \
+        BasicBufferedFile<W>&,                                              \
+        const SortConfig&,                                                  \
+        SortStats&,                                                         \
+        const FinalOutputs<W>*,                                             \
+        size_t                                                              \
+    );                                                                      \
+    template void mergeRuns<W>(                                             \
+        BasicBufferedFile<W>&,                                              \
+        BasicBufferedFile<W>&,                                              \
+        RunLayout,                                                          \
+        const SortConfig&,                                                  \
+        SortStats&,                                                         \
+        const FinalOutputs<W>*                                              \
+    );                                                                      \
+    template SortStats mergeFiles<W>(                                       \
+        const std::vector<BasicBufferedFile<W>*>&,                          \
+        BasicBufferedFile<W>&,                                              \
+        const SortConfig&                                                   \
+    );                                                                      \
+    template bool isSorted<W>(BasicBufferedFile<W>&, const RecordOrder&);   \
+    template std::unique_ptr<BasicTempFile<W>> sortIntoTempFile<W>(         \
+        BasicBufferedFile<W>&, const SortConfig&                            \
+    );                                                                      \
+    template SortStats sortAppended<W>(                                     \
+        BasicBufferedFile<W>&, size_t, const SortConfig&                    \
+    );                                                                      \
+    template SortStats sortRecords<W>(                                      \
+        const PageSource<W>&,                                               \
+        const RecordSink<W>&,                                               \
+        size_t,                                                             \
+        const SortConfig&,                                                  \
+        const ProgressCallback&                                             \
+    );
+FOR_EACH_RECORD_WIDTH(INSTANTIATE_SORTER)
+#undef INSTANTIATE_SORTER
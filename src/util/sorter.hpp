@@ -0,0 +1,148 @@
+#ifndef SORTER_HPP
+#define SORTER_HPP
+
+#include <cstddef>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "fence_index.hpp"
+#include "file_buffering.hpp"
+#include "metrics.hpp"
+#include "sort_config.hpp"
+#include "temp_file.hpp"
+
+// Sorted runs in a file, as the index of the first page of every run and the
+// number of pages all runs take together
+struct RunLayout {
+    std::vector<size_t> runStarts;
+    size_t pageCount = 0;
+};
+
+// Side outputs of the phase that writes the sorted file
+template <size_t RecordLen>
+struct FinalOutputs {
+    BasicFenceIndex<RecordLen>* index = nullptr;
+    // Gets "<count> <record>" for every distinct record with DedupMode::COUNT
+    std::ostream* counts = nullptr;
+};
+
+// Sidecar file with the counts of DedupMode::COUNT
+std::string countsPath(const std::string& fileName);
+
+// Sorts the file in place, first into runs of bufferCount pages, then by
+// merging bufferCount - 1 runs at a time until a single run remains. With
+// PageFormat::VARIABLE the runs are written to a temporary file, as a sorted
+// run can take more pages than it was read from. With config.indexStride set
+// the phase that writes the sorted file also writes its fence index. Unless
+// the runs are in a format of their own, DedupMode::UNIQUE writes them in
+// PageFormat::PREFIX, since runs without duplicates do not fill whole pages.
+template <size_t RecordLen>
+SortStats sortFile(BasicBufferedFile<RecordLen>& f, const SortConfig& config);
+
+// Merges files that are each sorted into the empty file `f`, taking every
+// input file as one run. More than bufferCount - 1 inputs are merged in
+// groups first, then their runs are cascaded like in sortFile. Throws
+// std::runtime_error when an input turns out not to be sorted. The side
+// outputs of the config are written like in sortFile.
+template <size_t RecordLen>
+SortStats mergeFiles(
+    const std::vector<BasicBufferedFile<RecordLen>*>& inputs,
+    BasicBufferedFile<RecordLen>& f,
+    const SortConfig& config
+);
+
+// Reads f once to tell whether its records are in `order`, as mergeFiles
+// needs its inputs to be
+template <size_t RecordLen>
+bool isSorted(BasicBufferedFile<RecordLen>& f, const RecordOrder& order);
+
+// Sorts a copy of `in` in a temporary file of the same page format, for an
+// input of mergeFiles that is not sorted. `in` is only read. Only the order
+// and the resources of the config apply to the copy, its side outputs, dedup,
+// limit and checkpoints are left to the merge.
+template <size_t RecordLen>
+std::unique_ptr<BasicTempFile<RecordLen>> sortIntoTempFile(
+    BasicBufferedFile<RecordLen>& in, const SortConfig& config
+);
+
+// Sorts a file whose first `sortedPages` pages are sorted already and have
+// had records appended after them. Only the appended pages are made into
+// runs, which are merged with the sorted pages as one more run. That reads
+// and writes the sorted pages once, plus a copy back into f as the merge can
+// not write over pages it has yet to read. The last sorted page of a fixed
+// file is sorted with the appended ones, as it may end in padding. With no
+// sorted pages this is sortFile.
+template <size_t RecordLen>
+SortStats sortAppended(
+    BasicBufferedFile<RecordLen>& f,
+    size_t sortedPages,
+    const SortConfig& config
+);
+
+// Where a sort stands, reported after run generation and after every merge
+// phase
+struct SortProgress {
+    // Merge phases completed so far
+    size_t phaseCount = 0;
+    // Runs left to merge, 1 once the sort is done
+    size_t runCount = 0;
+    // I/O of every file of the process so far
+    IoSnapshot io;
+};
+using ProgressCallback = std::function<void(const SortProgress&)>;
+
+// Fills the page it is given with the next records of the input, any number
+// of them, and returns false once the input is exhausted
+template <size_t RecordLen>
+using PageSource = std::function<bool(std::vector<BasicRecord<RecordLen>>&)>;
+// Gets every sorted record in order
+template <size_t RecordLen>
+using RecordSink = std::function<void(const BasicRecord<RecordLen>&)>;
+
+// Sorts the records of `source` and hands them to `sink`, so neither has to
+// be a file. The runs, of recordsPerPage record pages, go to temporary files
+// and are merged until at most bufferCount - 1 remain. The last merge hands
+// every record on as soon as it is merged. The runs hold exactly the records
+// of the source, in PageFormat::PREFIX unless config.runFormat says
+// otherwise. Throws std::invalid_argument for an index or DedupMode::COUNT,
+// which need a sorted file, and for fixed runs, whose padding would be handed
+// on as records.
+template <size_t RecordLen>
+SortStats sortRecords(
+    const PageSource<RecordLen>& source,
+    const RecordSink<RecordLen>& sink,
+    size_t recordsPerPage,
+    const SortConfig& config,
+    const ProgressCallback& progress = {}
+);
+
+// Reads `in` bufferCount pages at a time from `firstPage` on and writes every
+// chunk to `out` as a sorted run. `in` and `out` may be the same file with
+// PageFormat::FIXED. `finalOutputs` is only given when the single run is the
+// sorted file.
+template <size_t RecordLen>
+RunLayout createRuns(
+    BasicBufferedFile<RecordLen>& in,
+    BasicBufferedFile<RecordLen>& out,
+    const SortConfig& config,
+    SortStats& stats,
+    const FinalOutputs<RecordLen>* finalOutputs = nullptr,
+    size_t firstPage = 0
+);
+
+// Merges the runs of `runFile` until a single one remains, which ends up in
+// `f`. `runFile` may be `f` itself. The last phase writes `finalOutputs`.
+template <size_t RecordLen>
+void mergeRuns(
+    BasicBufferedFile<RecordLen>& f,
+    BasicBufferedFile<RecordLen>& runFile,
+    RunLayout runs,
+    const SortConfig& config,
+    SortStats& stats,
+    const FinalOutputs<RecordLen>* finalOutputs = nullptr
+);
+
+#endif  // !SORTER_HPP
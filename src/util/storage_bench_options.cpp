@@ -0,0 +1,161 @@
+#include "storage_bench_options.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+StorageBenchOptions::StorageBenchOptions(int argc, char** argv)
+    : scriptName(argv[0]) {
+    parse(argc, argv);
+    checkConstraints();
+}
+
+void StorageBenchOptions::parse(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        parseArgument(argv[i], i, argc, argv);
+    }
+}
+
+void StorageBenchOptions::parseArgument(
+    const std::string& arg, int& i, int argc, char** argv
+) {
+    if (arg.starts_with('-')) {
+        handleFlag(arg, i, argc, argv);
+    } else {
+        std::cerr << "Error: Unexpected argument '" << arg << "'\n";
+        printHelpAndExit();
+    }
+}
+
+void StorageBenchOptions::handleFlag(
+    const std::string& flag, int& i, int argc, char** argv
+) {
+    if ((flag == "-h") || (flag == "--help")) {
+        printHelpAndExit(0);
+    } else if ((flag == "-r") || (flag == "--records")) {
+        recordCount = parseSize(i, argc, argv);
+    } else if ((flag == "-b") || (flag == "--blocking-factors")) {
+        blockingFactors = parseSizeList(i, argc, argv);
+    } else if ((flag == "-w") || (flag == "--record-widths")) {
+        recordWidths = parseSizeList(i, argc, argv);
+    } else if (flag == "--stride") {
+        stride = parseSize(i, argc, argv);
+    } else if (flag == "--iterations") {
+        minIterations = parseSize(i, argc, argv);
+    } else if (flag == "--format") {
+        parseFormat(i, argc, argv);
+    } else if (flag == "--filter") {
+        filter = getVal(i, argc, argv);
+    } else if (flag == "--dir") {
+        workDir = getVal(i, argc, argv);
+    } else {
+        std::cerr << "Error: Unknown argument '" << flag << "'\n";
+        printHelpAndExit();
+    }
+}
+
+std::string StorageBenchOptions::getVal(int& i, int argc, char** argv) {
+    if (i + 1 >= argc) {
+        std::cerr << "Error: " << argv[i] << " requires a value.\n";
+        printHelpAndExit();
+    }
+    return argv[++i];
+}
+
+size_t StorageBenchOptions::parseSize(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    try {
+        return std::stoul(val);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+    return 0;
+}
+
+std::vector<size_t> StorageBenchOptions::parseSizeList(
+    int& i, int argc, char** argv
+) {
+    auto val = getVal(i, argc, argv);
+    std::vector<size_t> values;
+    std::stringstream ss(val);
+    std::string item;
+    try {
+        while (std::getline(ss, item, ',')) {
+            values.push_back(std::stoul(item));
+        }
+    } catch (const std::exception& e) {
+        values.clear();
+    }
+    if (values.empty()) {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+    return values;
+}
+
+void StorageBenchOptions::parseFormat(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    if (val == "csv") {
+        format = Format::CSV;
+    } else if (val == "json") {
+        format = Format::JSON;
+    } else {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+}
+
+void StorageBenchOptions::checkConstraints() const {
+    if (recordCount == 0 || stride == 0 || minIterations == 0) {
+        std::cerr << "Error: --records, --stride and --iterations must be at "
+                     "least 1."
+                  << std::endl;
+        printHelpAndExit();
+    }
+
+    if (std::ranges::find(blockingFactors, 0) != blockingFactors.end()) {
+        std::cerr << "Error: Every blocking factor must be at least 1."
+                  << std::endl;
+        printHelpAndExit();
+    }
+
+    for (size_t w : recordWidths) {
+        if (!isSupportedRecordWidth(w)) {
+            std::cerr << "Error: Unsupported record width " << w << std::endl;
+            printHelpAndExit();
+        }
+    }
+}
+
+void StorageBenchOptions::printHelpAndExit(int exitCode) const {
+    // clang-format off
+    std::cout <<
+        "Usage: " << scriptName << " [options]\n\n"
+        "Times the individual BufferedFile and Buffer operations and reports\n"
+        "ns per record and MB/s for each. Lists are comma separated.\n\n"
+        "Options:\n"
+        "\t-h, --help\t\tShow this help message\n\n"
+        "\t-r, --records <count>\n"
+        "\t\tRecords in the benchmarked file (default: 100000).\n\n"
+        "\t-b, --blocking-factors <list>\n"
+        "\t\tBlocking factors (default: 1,10,100,1000).\n\n"
+        "\t-w, --record-widths <list>\n"
+        "\t\tRecord widths (default: 30).\n\n"
+        "\t--stride <pages>\n"
+        "\t\tPage step of the strided access patterns (default: 7).\n\n"
+        "\t--iterations <count>\n"
+        "\t\tMinimum repetitions, the fastest one is reported (default: 3).\n\n"
+        "\t--filter <text>\n"
+        "\t\tOnly run benchmarks whose name contains <text>.\n\n"
+        "\t--format <csv|json>\n"
+        "\t\tOutput format (default: csv).\n\n"
+        "\t--dir <directory>\n"
+        "\t\tWhere the benchmarked files are created (default: temp/bench).\n";
+    // clang-format on
+    exit(exitCode);
+}
@@ -0,0 +1,61 @@
+#ifndef STORAGE_BENCH_OPTIONS_HPP
+#define STORAGE_BENCH_OPTIONS_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "record.hpp"
+
+class StorageBenchOptions {
+   public:
+    enum class Format { CSV, JSON };
+
+    StorageBenchOptions(int argc, char** argv);
+
+    size_t getRecordCount() const { return recordCount; }
+    const std::vector<size_t>& getBlockingFactors() const {
+        return blockingFactors;
+    }
+    const std::vector<size_t>& getRecordWidths() const { return recordWidths; }
+    size_t getStride() const { return stride; }
+    size_t getMinIterations() const { return minIterations; }
+    Format getFormat() const { return format; }
+    const std::string& getFilter() const { return filter; }
+    const std::string& getWorkDir() const { return workDir; }
+
+   private:
+    void parse(int argc, char** argv);
+    void parseArgument(const std::string& arg, int& i, int argc, char** argv);
+    void handleFlag(const std::string& flag, int& i, int argc, char** argv);
+
+    /**
+     * Tries to get the next argument
+     *
+     * Returns it as string
+     *
+     * If the argument is missing, exits with a error message:
+     * `"Error: " << argv[i] << " requires a value.\n"`
+     */
+    std::string getVal(int& i, int argc, char** argv);
+
+    size_t parseSize(int& i, int argc, char** argv);
+    // Parses a comma separated list of positive numbers, e.g. `10,50,100`
+    std::vector<size_t> parseSizeList(int& i, int argc, char** argv);
+    void parseFormat(int& i, int argc, char** argv);
+
+    void checkConstraints() const;
+    void printHelpAndExit(int exitCode = 1) const;
+
+    size_t recordCount = 100000;
+    std::vector<size_t> blockingFactors = {1, 10, 100, 1000};
+    std::vector<size_t> recordWidths = {Record::maxLen};
+    size_t stride = 7;
+    size_t minIterations = 3;
+    Format format = Format::CSV;
+    std::string filter;
+    std::string workDir = "temp/bench";
+    std::string scriptName;
+};
+
+#endif  // !STORAGE_BENCH_OPTIONS_HPP
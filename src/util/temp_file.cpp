@@ -1,20 +1,151 @@
 #include "temp_file.hpp"
 
+#include <unistd.h>
+
+#include <cstdint>
+#include <exception>
 #include <filesystem>
 #include <format>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include "error.hpp"
+
+// Shared by every record width so that temp files never share a name
+static std::mutex placementMutex;
+static size_t counter = 0;
+static std::vector<std::filesystem::path> directories = {"temp"};
+static TempPlacement placement = TempPlacement::ROUND_ROBIN;
+// Index of the directory the last file went to
+static size_t lastDirectory = -1;
+
+std::optional<TempPlacement> parseTempPlacement(std::string_view name) {
+    if (name == "round-robin") {
+        return TempPlacement::ROUND_ROBIN;
+    }
+    if (name == "free-space") {
+        return TempPlacement::FREE_SPACE;
+    }
+    return std::nullopt;
+}
 
-size_t TempFile::counter = 0;
+std::string_view tempPlacementName(TempPlacement placement) {
+    switch (placement) {
+        case TempPlacement::ROUND_ROBIN:
+            return "round-robin";
+        case TempPlacement::FREE_SPACE:
+            return "free-space";
+    }
+    return "unknown";
+}
+
+void setTempDirectories(
+    std::vector<std::filesystem::path> dirs, TempPlacement newPlacement
+) {
+    if (dirs.empty()) {
+        THROW_FORMATTED(
+            std::invalid_argument, "At least one temp directory is needed"
+        );
+    }
+    std::lock_guard lock(placementMutex);
+    directories = std::move(dirs);
+    placement = newPlacement;
+    lastDirectory = -1;
+}
+
+// The directory itself if it exists, otherwise the closest of its parents
+// that does, where it would be created
+static std::filesystem::path existingAncestor(std::filesystem::path dir) {
+    std::error_code error;
+    while (!std::filesystem::exists(dir, error)) {
+        auto parent = dir.parent_path();
+        if (parent.empty() || parent == dir) {
+            return ".";
+        }
+        dir = std::move(parent);
+    }
+    return dir;
+}
 
-std::string TempFile::generate_path() {
-    const std::filesystem::path dir = "temp";
+// Index of the directory the next file goes to
+static size_t nextDirectory() {
+    if (placement == TempPlacement::ROUND_ROBIN || directories.size() == 1) {
+        return (lastDirectory + 1) % directories.size();
+    }
+
+    size_t best = -1;
+    std::uintmax_t bestFree = 0;
+    for (size_t i = 0; i < directories.size(); i++) {
+        if (i == lastDirectory) {
+            continue;
+        }
+        // NOTE: A directory that does not exist yet is only created once it
+        // is chosen, until then it has the space of the parent it goes into
+        std::error_code error;
+        auto info =
+            std::filesystem::space(existingAncestor(directories[i]), error);
+        if (error) {
+            continue;
+        }
+        if (best == static_cast<size_t>(-1) || info.available > bestFree) {
+            best = i;
+            bestFree = info.available;
+        }
+    }
+    return best != static_cast<size_t>(-1)
+               ? best
+               : (lastDirectory + 1) % directories.size();
+}
+
+static std::string generateTempPath() {
+    std::lock_guard lock(placementMutex);
+    lastDirectory = nextDirectory();
+    const std::filesystem::path& dir = directories[lastDirectory];
 
     std::filesystem::create_directories(dir);
-    return (dir / std::format("tempFile{}", counter++));
+    return (dir / std::format("tempFile-{}-{}", ::getpid(), counter++));
 }
 
-TempFile::TempFile() : filePath(generate_path()), file(filePath) {}
-TempFile::~TempFile() { std::filesystem::remove(filePath); }
+template <size_t RecordLen>
+BasicTempFile<RecordLen>::BasicTempFile(
+    size_t recordsPerPage, PageFormat format, bool keepOnFailure
+)
+    : BasicTempFile(
+          generateTempPath(), recordsPerPage, format, keepOnFailure
+      ) {}
 
-TempFile::operator BufferedFile&() { return file; }
+template <size_t RecordLen>
+BasicTempFile<RecordLen>::BasicTempFile(
+    const std::filesystem::path& path,
+    size_t recordsPerPage,
+    PageFormat format,
+    bool keepOnFailure
+)
+    : filePath(path),
+      file(filePath, recordsPerPage, format, "temp"),
+      keepOnFailure(keepOnFailure),
+      uncaughtExceptions(std::uncaught_exceptions()) {}
+
+template <size_t RecordLen>
+BasicTempFile<RecordLen>::~BasicTempFile() {
+    if (keepOnFailure && std::uncaught_exceptions() > uncaughtExceptions) {
+        return;
+    }
+    std::filesystem::remove(filePath);
+}
+
+template <size_t RecordLen>
+BasicTempFile<RecordLen>::operator BasicBufferedFile<RecordLen>&() {
+    return file;
+}
+
+template <size_t RecordLen>
+std::string BasicTempFile<RecordLen>::getFileName() {
+    return filePath;
+}
 
-std::string TempFile::getFileName() { return filePath; }
+#define INSTANTIATE_TEMP_FILE(W) template class BasicTempFile<W>;
+FOR_EACH_RECORD_WIDTH(INSTANTIATE_TEMP_FILE)
+#undef INSTANTIATE_TEMP_FILE
@@ -1,23 +1,74 @@
 #ifndef TEMP_FILE_HPP
 #define TEMP_FILE_HPP
 
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
 #include "file_buffering.hpp"
 
-class TempFile {
+// How temporary files are spread over the spill directories
+enum class TempPlacement {
+    // Every new file goes to the next directory in turn
+    ROUND_ROBIN,
+    // Every new file goes to the directory with the most free space, other
+    // than the one the file before it went to
+    FREE_SPACE,
+};
+
+std::optional<TempPlacement> parseTempPlacement(std::string_view name);
+std::string_view tempPlacementName(TempPlacement placement);
+
+// Directories temporary files are created in, only "temp" unless set. Files
+// created one after the other never share a directory when there are several,
+// so with one directory per device a merge phase reads from one device while
+// it writes to another. Names hold the process id, so concurrent sorts can
+// share directories.
+void setTempDirectories(
+    std::vector<std::filesystem::path> dirs,
+    TempPlacement placement = TempPlacement::ROUND_ROBIN
+);
+
+// A file that is removed once it goes out of scope. With `keepOnFailure` it
+// is left behind when an exception unwinds it, so a sort that failed can be
+// resumed from its checkpoint.
+template <size_t RecordLen>
+class BasicTempFile {
    public:
-    TempFile();
-    ~TempFile();
+    // A new file in the next temporary directory
+    BasicTempFile(
+        size_t recordsPerPage,
+        PageFormat format = PageFormat::FIXED,
+        bool keepOnFailure = false
+    );
+    // Takes over the existing file at `path`, e.g. the runs of a checkpoint
+    BasicTempFile(
+        const std::filesystem::path& path,
+        size_t recordsPerPage,
+        PageFormat format,
+        bool keepOnFailure = false
+    );
+    ~BasicTempFile();
 
-    operator BufferedFile&();
+    operator BasicBufferedFile<RecordLen>&();
     std::string getFileName();
 
    private:
-    static size_t counter;
-
     const std::filesystem::path filePath;
-    BufferedFile file;
-
-    static std::string generate_path();
+    BasicBufferedFile<RecordLen> file;
+    const bool keepOnFailure;
+    // Exceptions in flight when the file was created, the destructor runs
+    // during unwinding if there are more
+    const int uncaughtExceptions;
 };
 
+#define DECLARE_TEMP_FILE(W) extern template class BasicTempFile<W>;
+FOR_EACH_RECORD_WIDTH(DECLARE_TEMP_FILE)
+#undef DECLARE_TEMP_FILE
+
+using TempFile = BasicTempFile<Record::maxLen>;
+
 #endif  // !TEMP_FILE_HPP
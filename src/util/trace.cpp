@@ -0,0 +1,122 @@
+#include "trace.hpp"
+
+#include <unistd.h>
+
+#include <format>
+#include <memory>
+#include <ostream>
+
+Tracer& Tracer::instance() {
+    static Tracer tracer;
+    return tracer;
+}
+
+void Tracer::start() {
+    {
+        std::lock_guard lock(mutex);
+        for (auto& t : threads) {
+            t->events.clear();
+        }
+        epoch = std::chrono::steady_clock::now();
+    }
+    enabled.store(true, std::memory_order_release);
+}
+
+void Tracer::stop() { enabled.store(false, std::memory_order_release); }
+
+int64_t Tracer::now() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - epoch
+    )
+        .count();
+}
+
+auto Tracer::threadBuffer() -> ThreadBuffer& {
+    struct Holder {
+        ThreadBuffer* buffer = nullptr;
+        ~Holder() {
+            if (buffer != nullptr) {
+                Tracer::instance().releaseThreadBuffer(*buffer);
+            }
+        }
+    };
+    thread_local Holder holder;
+
+    if (holder.buffer == nullptr) {
+        std::lock_guard lock(mutex);
+        for (auto& t : threads) {
+            if (!t->inUse) {
+                t->inUse = true;
+                holder.buffer = t.get();
+                return *holder.buffer;
+            }
+        }
+        auto buffer = std::make_shared<ThreadBuffer>();
+        buffer->trackId = threads.size();
+        threads.push_back(buffer);
+        holder.buffer = buffer.get();
+    }
+    return *holder.buffer;
+}
+
+void Tracer::releaseThreadBuffer(ThreadBuffer& buffer) {
+    std::lock_guard lock(mutex);
+    buffer.inUse = false;
+}
+
+void Tracer::record(const Event& event) {
+    threadBuffer().events.push_back(event);
+}
+
+void Tracer::setThreadName(const char* name) { threadBuffer().name = name; }
+
+void Tracer::writeJson(std::ostream& os) const {
+    std::lock_guard lock(mutex);
+    int pid = getpid();
+    bool first = true;
+
+    auto separator = [&]() -> const char* {
+        const char* s = first ? "\n" : ",\n";
+        first = false;
+        return s;
+    };
+
+    os << "{\"traceEvents\": [";
+    for (const auto& t : threads) {
+        // The first thread to trace anything is the one driving the sort
+        const char* name = t->name != nullptr ? t->name
+                           : t->trackId == 0  ? "main"
+                                              : "worker";
+        os << separator()
+           << std::format(
+                  "{{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": {}, "
+                  "\"tid\": {}, \"args\": {{\"name\": \"{} {}\"}}}}",
+                  pid,
+                  t->trackId,
+                  name,
+                  t->trackId
+              );
+
+        for (const auto& e : t->events) {
+            // Timestamps are in microseconds
+            os << separator()
+               << std::format(
+                      "{{\"name\": \"{}\", \"cat\": \"sort\", \"ph\": \"X\", "
+                      "\"pid\": {}, \"tid\": {}, \"ts\": {:.3f}, "
+                      "\"dur\": {:.3f}",
+                      e.name,
+                      pid,
+                      t->trackId,
+                      e.startNs / 1e3,
+                      e.durationNs / 1e3
+                  );
+            if (e.argName != nullptr) {
+                os << std::format(
+                    ", \"args\": {{\"{}\": {}}}", e.argName, e.argValue
+                );
+            }
+            os << "}";
+        }
+    }
+    os << "\n], \"displayTimeUnit\": \"ms\"}\n";
+}
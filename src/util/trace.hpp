@@ -0,0 +1,112 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Timeline of a sort in the Chrome trace event format, open the file at
+// https://ui.perfetto.dev or in chrome://tracing.
+//
+// Spans are only compiled in when ENABLE_TRACING is defined (cmake
+// -DENABLE_TRACING=ON). Otherwise TRACE_SPAN and friends expand to nothing, so
+// the hot loops pay nothing for them. When compiled in, a span costs a single
+// relaxed load until Tracer::start() is called.
+
+class Tracer {
+   public:
+    // Names and argument names must be string literals, only the pointer is
+    // kept
+    struct Event {
+        const char* name;
+        const char* argName;
+        uint64_t argValue;
+        int64_t startNs;
+        int64_t durationNs;
+    };
+
+    static Tracer& instance();
+
+    void start();
+    void stop();
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    // Nanoseconds since start()
+    int64_t now() const;
+
+    // Appends an event to the buffer of the calling thread
+    void record(const Event& event);
+    // Name of the calling thread's track in the timeline
+    void setThreadName(const char* name);
+
+    // Must not be called while other threads still record
+    void writeJson(std::ostream& os) const;
+
+   private:
+    Tracer() = default;
+
+    // Every thread writes to its own buffer, so recording takes no lock.
+    // Once a thread exits its buffer is handed to the next new thread, so
+    // short lived workers share a few tracks instead of one each.
+    struct ThreadBuffer {
+        size_t trackId;
+        bool inUse = true;
+        const char* name = nullptr;
+        std::vector<Event> events;
+    };
+
+    ThreadBuffer& threadBuffer();
+    void releaseThreadBuffer(ThreadBuffer& buffer);
+
+    std::atomic<bool> enabled = false;
+    std::chrono::steady_clock::time_point epoch;
+
+    mutable std::mutex mutex;
+    // Kept alive after the threads exit so their events can still be written
+    std::vector<std::shared_ptr<ThreadBuffer>> threads;
+};
+
+// Records a span from its construction to its destruction
+class TraceSpan {
+   public:
+    TraceSpan(const char* name) : TraceSpan(name, nullptr, 0) {}
+    TraceSpan(const char* name, const char* argName, uint64_t argValue) {
+        if (Tracer::instance().isEnabled()) {
+            event = {name, argName, argValue, Tracer::instance().now(), 0};
+        }
+    }
+    ~TraceSpan() {
+        if (event.name != nullptr) {
+            event.durationNs = Tracer::instance().now() - event.startNs;
+            Tracer::instance().record(event);
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+   private:
+    Tracer::Event event{};
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+
+#ifdef ENABLE_TRACING
+// Traces the rest of the enclosing scope
+#define TRACE_SPAN(name) TraceSpan TRACE_CONCAT(_traceSpan, __LINE__)(name)
+// Same as TRACE_SPAN with one numeric argument shown in the span details
+#define TRACE_SPAN_ARG(name, argName, argValue) \
+    TraceSpan TRACE_CONCAT(_traceSpan, __LINE__)(name, argName, argValue)
+#define TRACE_THREAD_NAME(name) Tracer::instance().setThreadName(name)
+#else
+#define TRACE_SPAN(name) ((void)0)
+#define TRACE_SPAN_ARG(name, argName, argValue) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+#endif
+
+#endif  // !TRACE_HPP
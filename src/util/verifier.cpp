@@ -0,0 +1,354 @@
+#include "verifier.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "diagnostics.hpp"
+#include "error.hpp"
+#include "page_format.hpp"
+#include "record.hpp"
+
+// splitmix64 finalizer
+static uint64_t mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+// A second hash that does not share collisions with hashRecord
+static uint64_t hashRecordMixed(std::string_view record) {
+    uint64_t hash = 0x9e3779b97f4a7c15ull;
+    for (unsigned char c : record) {
+        hash = mix(hash ^ c);
+    }
+    return hash;
+}
+
+void MultisetHash::add(std::string_view record) {
+    count++;
+    sum += hashRecord(record);
+    mixedSum += hashRecordMixed(record);
+}
+
+MultisetHash& MultisetHash::operator+=(const MultisetHash& other) {
+    count += other.count;
+    sum += other.sum;
+    mixedSum += other.mixedSum;
+    return *this;
+}
+
+static bool isPadding(const char* record, size_t width) {
+    return std::all_of(record, record + width, [](char c) { return c == 0; });
+}
+
+namespace {
+
+// What one thread found in its part of the file
+struct ChunkResult {
+    // First and last record of the chunk, if it holds any
+    std::string first;
+    std::string last;
+    size_t recordCount = 0;
+    // Index within the chunk of the first record that comes before the one
+    // before it
+    std::optional<size_t> firstUnsorted;
+    MultisetHash hash;
+};
+
+// Scans the records of one chunk, given one at a time in file order
+template <typename Less>
+class ChunkScanner {
+   public:
+    ChunkScanner(bool checkOrder, Less less)
+        : checkOrder(checkOrder), less(less) {}
+
+    // `record` must stay valid until the next record is added
+    void add(std::string_view record) {
+        if (result.recordCount == 0) {
+            result.first.assign(record);
+        } else if (checkOrder && !result.firstUnsorted.has_value() &&
+                   less(record, previous)) {
+            result.firstUnsorted = result.recordCount;
+        }
+        previous = record;
+        result.recordCount++;
+        result.hash.add(record);
+    }
+
+    ChunkResult finish() {
+        result.last.assign(previous);
+        return std::move(result);
+    }
+
+   private:
+    bool checkOrder;
+    Less less;
+    std::string_view previous;
+    ChunkResult result;
+};
+
+// Memory mapping of a whole file, unmapped once it goes out of scope
+class MappedFile {
+   public:
+    explicit MappedFile(const std::string& fileName) {
+        int fd = ::open(fileName.c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::string reason = std::strerror(errno);
+            THROW_FORMATTED(
+                std::runtime_error, "Opening {} failed: {}", fileName, reason
+            );
+        }
+
+        struct stat st{};
+        if (::fstat(fd, &st) != 0) {
+            std::string reason = std::strerror(errno);
+            ::close(fd);
+            THROW_FORMATTED(
+                std::runtime_error,
+                "Reading size of {} failed: {}",
+                fileName,
+                reason
+            );
+        }
+        size = st.st_size;
+        if (size == 0) {
+            ::close(fd);
+            return;
+        }
+
+        void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            std::string reason = std::strerror(errno);
+            THROW_FORMATTED(
+                std::runtime_error, "Mapping {} failed: {}", fileName, reason
+            );
+        }
+        ::madvise(mapping, size, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(mapping);
+    }
+
+    ~MappedFile() {
+        if (data != nullptr) {
+            ::munmap(const_cast<char*>(data), size);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data = nullptr;
+    size_t size = 0;
+};
+
+// Runs `scan(chunk)` for chunks 0 to chunkCount - 1 on a thread each
+template <typename Scan>
+std::vector<ChunkResult> scanChunks(size_t chunkCount, Scan scan) {
+    std::vector<ChunkResult> chunks(chunkCount);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < chunkCount; t++) {
+        threads.emplace_back([&, t]() { chunks[t] = scan(t); });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    return chunks;
+}
+
+// Chunks are in file order, so the first violation found is the first one in
+// the file. A chunk boundary can only break the order between the last
+// record of one chunk and the first one of the next.
+template <typename Less>
+void mergeChunks(
+    const std::vector<ChunkResult>& chunks,
+    bool checkOrder,
+    Less less,
+    ScanResult& result
+) {
+    const std::string* previousLast = nullptr;
+    for (const auto& c : chunks) {
+        if (c.recordCount == 0) {
+            continue;
+        }
+        if (checkOrder && !result.firstUnsorted.has_value()) {
+            if (previousLast != nullptr && less(c.first, *previousLast)) {
+                result.firstUnsorted = result.recordCount;
+            } else if (c.firstUnsorted.has_value()) {
+                result.firstUnsorted = result.recordCount + *c.firstUnsorted;
+            }
+        }
+        previousLast = &c.last;
+        result.recordCount += c.recordCount;
+        result.hash += c.hash;
+    }
+}
+
+template <typename Less>
+ScanResult scanFixedFile(
+    const std::string& fileName,
+    size_t recordWidth,
+    size_t recordsPerPage,
+    size_t threadCount,
+    bool checkOrder,
+    Less less
+) {
+    MappedFile file(fileName);
+    if (file.size % recordWidth != 0) {
+        THROW_FORMATTED(
+            std::runtime_error,
+            "{} holds {} bytes, which is not a whole number of {} byte records",
+            fileName,
+            file.size,
+            recordWidth
+        );
+    }
+    ScanResult result;
+    const size_t fileRecords = file.size / recordWidth;
+    if (fileRecords == 0) {
+        return result;
+    }
+    auto record = [&](size_t i) { return file.data + i * recordWidth; };
+
+    // NOTE: Empty records anywhere else are records like any other
+    size_t recordCount = fileRecords;
+    size_t lastPage = (fileRecords - 1) / recordsPerPage * recordsPerPage;
+    while (recordCount > lastPage &&
+           isPadding(record(recordCount - 1), recordWidth)) {
+        recordCount--;
+    }
+
+    threadCount = std::clamp<size_t>(threadCount, 1, fileRecords);
+    size_t perThread = (recordCount + threadCount - 1) / threadCount;
+    auto chunks = scanChunks(threadCount, [&](size_t t) {
+        size_t begin = std::min(t * perThread, recordCount);
+        size_t end = std::min(begin + perThread, recordCount);
+        ChunkScanner scanner(checkOrder, less);
+        for (size_t i = begin; i < end; i++) {
+            scanner.add({record(i), recordWidth});
+        }
+        return scanner.finish();
+    });
+    mergeChunks(chunks, checkOrder, less, result);
+
+    for (size_t i = recordCount; i < fileRecords; i++) {
+        result.hash.add({record(i), recordWidth});
+        result.paddingCount++;
+    }
+    // NOTE: A last page that ends early is padded when the sorter reads it
+    const std::string empty(recordWidth, '\0');
+    for (size_t i = fileRecords; i < lastPage + recordsPerPage; i++) {
+        result.hash.add(empty);
+        result.paddingCount++;
+    }
+    return result;
+}
+
+// Decodes the pages of a variable or prefix file, which holds no padding
+template <size_t RecordLen, typename Less>
+ScanResult scanPagedFile(
+    const std::string& fileName,
+    size_t recordsPerPage,
+    PageFormat format,
+    size_t threadCount,
+    bool checkOrder,
+    Less less
+) {
+    MappedFile file(fileName);
+    const size_t pageSize = recordsPerPage * RecordLen;
+    const PageCodec<RecordLen> codec(format, pageSize);
+    if (file.size % pageSize != 0) {
+        THROW_FORMATTED(
+            std::runtime_error,
+            "{} holds {} bytes, which is not a whole number of {} byte pages",
+            fileName,
+            file.size,
+            pageSize
+        );
+    }
+    ScanResult result;
+    const size_t pageCount = file.size / pageSize;
+    if (pageCount == 0) {
+        return result;
+    }
+
+    threadCount = std::clamp<size_t>(threadCount, 1, pageCount);
+    size_t perThread = (pageCount + threadCount - 1) / threadCount;
+    auto chunks = scanChunks(threadCount, [&](size_t t) {
+        size_t begin = std::min(t * perThread, pageCount);
+        size_t end = std::min(begin + perThread, pageCount);
+        ChunkScanner scanner(checkOrder, less);
+        std::vector<char> bytes;
+        std::vector<BasicRecord<RecordLen>> page;
+        std::vector<BasicRecord<RecordLen>> previousPage;
+        for (size_t p = begin; p < end; p++) {
+            const char* pageData = file.data + p * pageSize;
+            bytes.assign(pageData, pageData + pageSize);
+            // NOTE: The scanner still holds the last record of the page before
+            std::swap(page, previousPage);
+            codec.decode(bytes, page);
+            for (const auto& r : page) {
+                scanner.add(r.data());
+            }
+        }
+        return scanner.finish();
+    });
+    mergeChunks(chunks, checkOrder, less, result);
+    return result;
+}
+
+}  // namespace
+
+ScanResult scanRecordFile(
+    const std::string& fileName,
+    size_t recordWidth,
+    size_t recordsPerPage,
+    PageFormat format,
+    size_t threadCount,
+    bool checkOrder,
+    const RecordOrder& order
+) {
+    if (recordsPerPage == 0) {
+        THROW_FORMATTED(
+            std::invalid_argument, "A page must hold at least one record"
+        );
+    }
+    if (format == PageFormat::FIXED) {
+        return dispatchRecordOrder(order, [&]<typename Less>() {
+            return scanFixedFile(
+                fileName,
+                recordWidth,
+                recordsPerPage,
+                threadCount,
+                checkOrder,
+                Less{}
+            );
+        });
+    }
+    return dispatchRecordWidth(recordWidth, [&]<size_t RecordLen>() {
+        return dispatchRecordOrder(order, [&]<typename Less>() {
+            return scanPagedFile<RecordLen>(
+                fileName,
+                recordsPerPage,
+                format,
+                threadCount,
+                checkOrder,
+                Less{}
+            );
+        });
+    });
+}
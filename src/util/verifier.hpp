@@ -0,0 +1,59 @@
+#ifndef VERIFIER_HPP
+#define VERIFIER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "page_format.hpp"
+#include "record_order.hpp"
+
+// Hash of a multiset of records, the same whatever order the records come in.
+// Two files with equal hashes hold the same records with overwhelming
+// probability.
+struct MultisetHash {
+    uint64_t count = 0;
+    // Two sums of independent hashes of every record, wrapping around
+    uint64_t sum = 0;
+    uint64_t mixedSum = 0;
+
+    void add(std::string_view record);
+    MultisetHash& operator+=(const MultisetHash& other);
+    bool operator==(const MultisetHash& other) const = default;
+};
+
+struct ScanResult {
+    // Records that are not padding
+    size_t recordCount = 0;
+    // Records made only of '\0' that end the last page
+    size_t paddingCount = 0;
+    // Index of the first record that comes before the one before it
+    std::optional<size_t> firstUnsorted;
+    // Every record, the padding included
+    MultisetHash hash;
+};
+
+// Reads a file of records through a memory mapping, split in threadCount
+// chunks, with `checkOrder` checking that they are in `order`. In the fixed
+// format only the records made of '\0' that end the last page of
+// recordsPerPage records are padding, the order check skips them, and so are
+// the records a last page that ends early lacks. Empty records anywhere else
+// are checked like any other. The hash takes every record and the padding:
+// the sorter sorts the padding of a fixed file with its records, so after an
+// in place sort it is where the order puts it. Files in another format are
+// decoded page by page through a PageCodec and hold no padding. Throws
+// std::runtime_error if the file can not be mapped, does not hold a whole
+// number of records or pages or holds a corrupt page.
+ScanResult scanRecordFile(
+    const std::string& fileName,
+    size_t recordWidth,
+    size_t recordsPerPage,
+    PageFormat format,
+    size_t threadCount,
+    bool checkOrder,
+    const RecordOrder& order = {}
+);
+
+#endif  // !VERIFIER_HPP
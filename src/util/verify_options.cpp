@@ -0,0 +1,170 @@
+#include "verify_options.hpp"
+
+#include <iostream>
+#include <string>
+
+VerifyOptions::VerifyOptions(int argc, char** argv) : scriptName(argv[0]) {
+    parse(argc, argv);
+    checkRequired();
+}
+
+void VerifyOptions::parse(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        parseArgument(argv[i], i, argc, argv);
+    }
+}
+
+void VerifyOptions::parseArgument(
+    const std::string& arg, int& i, int argc, char** argv
+) {
+    if (arg.starts_with('-')) {
+        handleFlag(arg, i, argc, argv);
+    } else if (fileName.empty()) {
+        fileName = arg;
+    } else {
+        std::cerr << "Error: Only one file name can be given, got '" << arg
+                  << "' after '" << fileName << "'\n";
+        printHelpAndExit();
+    }
+}
+
+void VerifyOptions::handleFlag(
+    const std::string& flag, int& i, int argc, char** argv
+) {
+    if ((flag == "-h") || (flag == "--help")) {
+        printHelpAndExit(0);
+    } else if ((flag == "-i") || (flag == "--input")) {
+        inputFileName = getVal(i, argc, argv);
+    } else if ((flag == "-w") || (flag == "--record-width")) {
+        parseRecordWidth(i, argc, argv);
+    } else if ((flag == "-b") || (flag == "--blockingFactor")) {
+        parseBlockingFactor(i, argc, argv);
+    } else if (flag == "--page-format") {
+        parsePageFormat(i, argc, argv);
+    } else if ((flag == "-t") || (flag == "--threads")) {
+        parseThreadCount(i, argc, argv);
+    } else if (flag == "--order") {
+        parseOrder(i, argc, argv);
+    } else {
+        std::cerr << "Error: Unknown argument '" << flag << "'\n";
+        printHelpAndExit();
+    }
+}
+
+std::string VerifyOptions::getVal(int& i, int argc, char** argv) {
+    if (i + 1 >= argc) {
+        std::cerr << "Error: " << argv[i] << " requires a value.\n";
+        printHelpAndExit();
+    }
+    return argv[++i];
+}
+
+void VerifyOptions::parseRecordWidth(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    try {
+        recordWidth = std::stoul(val);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+}
+
+void VerifyOptions::parseBlockingFactor(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    try {
+        blockingFactor = std::stoul(val);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+}
+
+void VerifyOptions::parsePageFormat(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    auto format = ::parsePageFormat(val);
+    if (!format.has_value()) {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+    pageFormat = *format;
+}
+
+void VerifyOptions::parseThreadCount(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    try {
+        threadCount = std::stoul(val);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+}
+
+void VerifyOptions::parseOrder(int& i, int argc, char** argv) {
+    auto val = getVal(i, argc, argv);
+    auto parsed = parseRecordOrder(val);
+    if (!parsed.has_value()) {
+        std::cerr << "Error: Invalid value for " << argv[i - 1] << ": " << val
+                  << std::endl;
+        printHelpAndExit();
+    }
+    order = *parsed;
+}
+
+void VerifyOptions::checkRequired() const {
+    if (fileName.empty()) {
+        std::cerr << "Error: A file name must be provided." << std::endl;
+        printHelpAndExit();
+    }
+
+    if (blockingFactor == 0) {
+        std::cerr << "Error: The blocking factor must be at least 1."
+                  << std::endl;
+        printHelpAndExit();
+    }
+
+    if (threadCount == 0) {
+        std::cerr << "Error: The thread count must be at least 1."
+                  << std::endl;
+        printHelpAndExit();
+    }
+
+    if (!isSupportedRecordWidth(recordWidth)) {
+        std::cerr << "Error: Unsupported record width " << recordWidth
+                  << std::endl;
+        printHelpAndExit();
+    }
+}
+
+void VerifyOptions::printHelpAndExit(int exitCode) const {
+    // clang-format off
+    std::cout <<
+        "Usage: " << scriptName << " [options] <fileName>\n\n"
+        "Checks that a file is sorted and, given the input, that it holds\n"
+        "exactly the records of the input. Exits with 0 when it does, 1 when\n"
+        "it does not and 2 on errors.\n\n"
+        "Options:\n"
+        "\t-h, --help\tShow this help message\n\n"
+        "\t-i, --input <file>\n"
+        "\t\tThe file before sorting, enables the permutation check\n\n"
+        "\t-w, --record-width <value>\n"
+        "\t\tRecord width in bytes (16, 30 or 64, default: 30)\n\n"
+        "\t-b, --blockingFactor <value>\n"
+        "\t\tRecords per page, as given to sort_files. The records made\n"
+        "\t\tof '\\0' that end the last page are padding (default: 10)\n\n"
+        "\t--page-format <fixed|variable|prefix>\n"
+        "\t\tLayout of the pages of both files, as given to sort_files\n"
+        "\t\t(default: fixed)\n\n"
+        "\t-t, --threads <value>\n"
+        "\t\tThreads scanning each file (default: all cores)\n\n"
+        "\t--order <ascending|descending>[,numeric][,ignore-case]\n"
+        "\t\tThe order the file was sorted in, as given to sort_files\n"
+        "\t\t(default: ascending)\n\n"
+        "Arguments:\n"
+        "\t<fileName>\tRequired: Path to the sorted file\n";
+    // clang-format on
+    exit(exitCode);
+}
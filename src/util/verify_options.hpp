@@ -0,0 +1,60 @@
+#ifndef VERIFY_OPTIONS_HPP
+#define VERIFY_OPTIONS_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <thread>
+
+#include "page_format.hpp"
+#include "record.hpp"
+#include "record_order.hpp"
+
+class VerifyOptions {
+   public:
+    VerifyOptions(int argc, char** argv);
+
+    const std::string& getFileName() const { return fileName; }
+    // Empty when only the order should be checked
+    const std::string& getInputFileName() const { return inputFileName; }
+    size_t getRecordWidth() const { return recordWidth; }
+    size_t getBlockingFactor() const { return blockingFactor; }
+    PageFormat getPageFormat() const { return pageFormat; }
+    size_t getThreadCount() const { return threadCount; }
+    const RecordOrder& getOrder() const { return order; }
+
+   private:
+    void parse(int argc, char** argv);
+    void parseArgument(const std::string& arg, int& i, int argc, char** argv);
+    void handleFlag(const std::string& flag, int& i, int argc, char** argv);
+
+    /**
+     * Tries to get the next argument
+     *
+     * Returns it as string
+     *
+     * If the argument is missing, exits with a error message:
+     * `"Error: " << argv[i] << " requires a value.\n"`
+     */
+    std::string getVal(int& i, int argc, char** argv);
+
+    void parseRecordWidth(int& i, int argc, char** argv);
+    void parseBlockingFactor(int& i, int argc, char** argv);
+    void parsePageFormat(int& i, int argc, char** argv);
+    void parseThreadCount(int& i, int argc, char** argv);
+    void parseOrder(int& i, int argc, char** argv);
+
+    void checkRequired() const;
+    void printHelpAndExit(int exitCode = 2) const;
+
+    std::string fileName;
+    std::string inputFileName;
+    size_t recordWidth = Record::maxLen;
+    size_t blockingFactor = 10;
+    PageFormat pageFormat = PageFormat::FIXED;
+    size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+    RecordOrder order;
+    std::string scriptName;
+};
+
+#endif  // !VERIFY_OPTIONS_HPP
@@ -0,0 +1,65 @@
+#include <exception>
+#include <format>
+#include <iostream>
+#include <verifier.hpp>
+#include <verify_options.hpp>
+
+static void printHash(const std::string& label, const MultisetHash& hash) {
+    std::cout << std::format(
+        "{} hash: count={} sum={:016x} mixed={:016x}\n",
+        label,
+        hash.count,
+        hash.sum,
+        hash.mixedSum
+    );
+}
+
+int main(int argc, char** argv) {
+    VerifyOptions options(argc, argv);
+
+    try {
+        ScanResult output = scanRecordFile(
+            options.getFileName(),
+            options.getRecordWidth(),
+            options.getBlockingFactor(),
+            options.getPageFormat(),
+            options.getThreadCount(),
+            true,
+            options.getOrder()
+        );
+        bool ok = !output.firstUnsorted.has_value();
+
+        std::cout << "Records: " << output.recordCount << '\n';
+        std::cout << "Padding: " << output.paddingCount << '\n';
+        if (ok) {
+            std::cout << "Sorted: yes\n";
+        } else {
+            std::cout << "Sorted: no, record " << *output.firstUnsorted
+                      << " is out of order\n";
+        }
+        printHash("Output", output.hash);
+
+        if (!options.getInputFileName().empty()) {
+            ScanResult input = scanRecordFile(
+                options.getInputFileName(),
+                options.getRecordWidth(),
+                options.getBlockingFactor(),
+                options.getPageFormat(),
+                options.getThreadCount(),
+                false
+            );
+            printHash("Input", input.hash);
+
+            bool permutation = input.hash == output.hash;
+            std::cout << "Permutation of input: "
+                      << (permutation ? "yes" : "no") << '\n';
+            ok = ok && permutation;
+        }
+
+        std::cout << std::flush;
+        return ok ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 2;
+    }
+}
@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "checkpoint.hpp"
+#include "sorter.hpp"
+#include "test_util.hpp"
+
+namespace {
+
+using Record = BasicRecord<30>;
+using BufferedFile = BasicBufferedFile<30>;
+
+// Writes the runs of `records` to `runFile` and a checkpoint of the sort of
+// `fileName` right after run generation, as a sort killed in its first merge
+// phase would leave them
+Checkpoint interruptedSort(
+    const std::string& fileName,
+    const std::string& runFile,
+    const std::vector<Record>& records
+) {
+    writeRecords<30>(fileName, records, 10);
+    std::filesystem::remove(runFile);
+    BufferedFile in(fileName, 10);
+    BufferedFile runs(runFile, 10);
+    SortStats stats;
+    Checkpoint checkpoint;
+    checkpoint.recordWidth = 30;
+    checkpoint.recordsPerPage = 10;
+    checkpoint.runs = createRuns(in, runs, smallConfig(), stats);
+    checkpoint.runCount = stats.runCount;
+    checkpoint.runFile = runFile;
+    checkpoint.workFiles = {runFile};
+    runs.flush();
+    checkpoint.save(checkpointPath(fileName));
+    return checkpoint;
+}
+
+void testSaveAndLoad() {
+    Checkpoint checkpoint;
+    checkpoint.recordWidth = 30;
+    checkpoint.recordsPerPage = 10;
+    checkpoint.pageFormat = PageFormat::VARIABLE;
+    checkpoint.runFormat = PageFormat::PREFIX;
+    checkpoint.order.descending = true;
+    checkpoint.order.numeric = true;
+    checkpoint.runCount = 34;
+    checkpoint.phaseCount = 2;
+    checkpoint.runFile = "temp/runs";
+    checkpoint.runs.runStarts = {0, 9, 18};
+    checkpoint.runs.pageCount = 25;
+    checkpoint.workFiles = {"temp/runs", "temp/other"};
+    checkpoint.save("temp/saved.ckpt");
+    auto loaded = Checkpoint::load("temp/saved.ckpt");
+    CHECK(loaded.has_value());
+    CHECK_EQ(loaded->recordWidth, size_t(30));
+    CHECK_EQ(loaded->recordsPerPage, size_t(10));
+    CHECK(loaded->pageFormat == PageFormat::VARIABLE);
+    CHECK(loaded->runFormat == PageFormat::PREFIX);
+    CHECK(loaded->order == checkpoint.order);
+    CHECK_EQ(loaded->runCount, size_t(34));
+    CHECK_EQ(loaded->phaseCount, size_t(2));
+    CHECK_EQ(loaded->runFile, checkpoint.runFile);
+    CHECK(loaded->runs.runStarts == checkpoint.runs.runStarts);
+    CHECK_EQ(loaded->runs.pageCount, size_t(25));
+    CHECK(loaded->workFiles == checkpoint.workFiles);
+    std::filesystem::remove("temp/saved.ckpt");
+    CHECK(!Checkpoint::load("temp/saved.ckpt").has_value());
+}
+
+void testResumeMergesTheRuns() {
+    auto records = randomRecords<30>(997, 13);
+    interruptedSort("temp/resumed", "temp/resumed.runs", records);
+    // NOTE: The runs are all that is left of the input, a sort that starts
+    // over would sort this instead
+    std::vector<Record> garbage(1000, Record("zz"));
+    writeRecords<30>("temp/resumed", garbage, 10);
+
+    auto config = smallConfig();
+    config.checkpoint = true;
+    config.resume = true;
+    SortStats stats;
+    {
+        BufferedFile f("temp/resumed", 10);
+        stats = sortFile(f, config);
+    }
+    CHECK(stats.phaseCount > 0);
+    CHECK_EQ(stats.runCount, size_t(34));
+
+    // NOTE: The padding of the last page is sorted like any record
+    records.resize(1000, Record::empty);
+    std::ranges::sort(records);
+    CHECK(readRecords<30>("temp/resumed", 10) == records);
+    CHECK(!std::filesystem::exists(checkpointPath("temp/resumed")));
+    CHECK(!std::filesystem::exists("temp/resumed.runs"));
+    std::filesystem::remove("temp/resumed");
+}
+
+void testResumeWithoutCheckpointSorts() {
+    auto records = randomRecords<30>(200, 17);
+    writeRecords<30>("temp/fresh", records, 10);
+    auto config = smallConfig();
+    config.checkpoint = true;
+    config.resume = true;
+    {
+        BufferedFile f("temp/fresh", 10);
+        sortFile(f, config);
+    }
+    std::ranges::sort(records);
+    CHECK(readRecords<30>("temp/fresh", 10) == records);
+    CHECK(!std::filesystem::exists(checkpointPath("temp/fresh")));
+    std::filesystem::remove("temp/fresh");
+}
+
+void testResumeNeedsTheSameSort() {
+    auto records = randomRecords<30>(300, 19);
+    interruptedSort("temp/mismatch", "temp/mismatch.runs", records);
+    auto config = smallConfig();
+    config.checkpoint = true;
+    config.resume = true;
+    config.order.descending = true;
+    {
+        BufferedFile f("temp/mismatch", 10);
+        CHECK_THROWS(sortFile(f, config), std::invalid_argument);
+    }
+    config.order.descending = false;
+    {
+        BufferedFile f("temp/mismatch", 20);
+        CHECK_THROWS(sortFile(f, config), std::invalid_argument);
+    }
+    std::filesystem::remove("temp/mismatch");
+    std::filesystem::remove("temp/mismatch.runs");
+    std::filesystem::remove(checkpointPath("temp/mismatch"));
+}
+
+}  // namespace
+
+int main() {
+    return runTests({
+        {"save_and_load", testSaveAndLoad},
+        {"resume_merges_the_runs", testResumeMergesTheRuns},
+        {"resume_without_checkpoint_sorts", testResumeWithoutCheckpointSorts},
+        {"resume_needs_the_same_sort", testResumeNeedsTheSameSort},
+    });
+}
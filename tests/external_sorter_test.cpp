@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "external_sorter.hpp"
+#include "metrics.hpp"
+#include "test_util.hpp"
+
+namespace {
+
+using Record = BasicRecord<30>;
+
+// Three pages of 10 records, so the sort takes several runs and phases
+ExternalSorterOptions smallOptions() {
+    ExternalSorterOptions options;
+    options.memoryBudget = 3 * 10 * 30;
+    options.recordsPerPage = 10;
+    return options;
+}
+
+std::vector<Record> sortToVector(ExternalSorter& sorter) {
+    std::vector<Record> sorted;
+    sorter.sort([&](const Record& r) { sorted.push_back(r); });
+    return sorted;
+}
+
+void testRecordCountIsKept() {
+    // NOTE: None of them fill the last page of the last run
+    for (size_t count : {1, 9, 11, 29, 4993}) {
+        auto records = randomRecords<30>(count, count);
+        ExternalSorter sorter(smallOptions());
+        size_t next = 0;
+        sorter.addProducer([&](Record& r) {
+            if (next == records.size()) {
+                return false;
+            }
+            r = records[next++];
+            return true;
+        });
+        auto sorted = sortToVector(sorter);
+        CHECK_EQ(sorted.size(), count);
+        CHECK(sorted == sortedCopy(records));
+    }
+}
+
+void testEmptyRecordsAreKept() {
+    auto records = randomRecords<30>(4993, 7);
+    for (size_t i = 0; i < records.size(); i += 500) {
+        records[i] = Record::empty;
+    }
+    std::string bytes;
+    for (const auto& r : records) {
+        bytes.append(r.data());
+    }
+    std::istringstream in(bytes);
+    ExternalSorter sorter(smallOptions());
+    sorter.addStream(in);
+    auto sorted = sortToVector(sorter);
+    CHECK_EQ(sorted.size(), records.size());
+    CHECK(sorted == sortedCopy(records));
+}
+
+void testLinesKeepEmptyLines() {
+    std::istringstream in("b\na\n\nc");
+    std::ostringstream out;
+    ExternalSorter sorter(smallOptions());
+    sorter.addStream(in, StreamFormat::LINES);
+    sorter.sort(out, StreamFormat::LINES);
+    CHECK_EQ(out.str(), std::string("\na\nb\nc\n"));
+}
+
+void testFilePaddingIsSkipped() {
+    // NOTE: Empty records within the file are records, only the ones that
+    // end its last page are padding
+    auto records = randomRecords<30>(95, 11);
+    records[0] = Record::empty;
+    records[42] = Record::empty;
+    writeRecords<30>("temp/padded", records, 10);
+    CHECK_EQ(readRecords<30>("temp/padded", 10).size(), size_t(100));
+
+    ExternalSorter sorter(smallOptions());
+    sorter.addFile("temp/padded");
+    sorter.sortTo("temp/padded_out");
+    auto sorted = readRecords<30>("temp/padded_out", 10);
+    sorted.resize(records.size());
+    CHECK(sorted == sortedCopy(records));
+    std::filesystem::remove("temp/padded");
+    std::filesystem::remove("temp/padded_out");
+}
+
+void testUniqueAndLimitKeepCounts() {
+    auto records = randomRecords<30>(2003, 3, 2, 3);
+    auto expected = sortedCopy(records);
+    auto last = std::ranges::unique(expected);
+    expected.erase(last.begin(), last.end());
+
+    auto options = smallOptions();
+    options.dedup = DedupMode::UNIQUE;
+    ExternalSorter unique(options);
+    size_t next = 0;
+    unique.addProducer([&](Record& r) {
+        if (next == records.size()) {
+            return false;
+        }
+        r = records[next++];
+        return true;
+    });
+    CHECK(sortToVector(unique) == expected);
+
+    options = smallOptions();
+    options.limit = 13;
+    ExternalSorter limited(options);
+    next = 0;
+    limited.addProducer([&](Record& r) {
+        if (next == records.size()) {
+            return false;
+        }
+        r = records[next++];
+        return true;
+    });
+    auto all = sortedCopy(records);
+    CHECK(sortToVector(limited) ==
+          std::vector<Record>(all.begin(), all.begin() + 13));
+}
+
+void testFixedRunsAreRejected() {
+    auto options = smallOptions();
+    options.runFormat = PageFormat::FIXED;
+    ExternalSorter sorter(options);
+    std::istringstream in("a\n");
+    sorter.addStream(in, StreamFormat::LINES);
+    CHECK_THROWS(sortToVector(sorter), std::invalid_argument);
+}
+
+void testMetricsDoNotPileUp() {
+    auto records = randomRecords<30>(499, 37);
+    auto sortOnce = [&]() {
+        ExternalSorter sorter(smallOptions());
+        size_t next = 0;
+        sorter.addProducer([&](Record& r) {
+            if (next == records.size()) {
+                return false;
+            }
+            r = records[next++];
+            return true;
+        });
+        sortToVector(sorter);
+        return Metrics::instance().getPhases().size();
+    };
+    size_t phases = sortOnce();
+    // NOTE: The temporary files are closed, their I/O is still counted
+    IoSnapshot io = Metrics::instance().totals();
+    CHECK(phases > 1);
+    CHECK(io.pageWrites > 0);
+    for (size_t i = 0; i < 20; i++) {
+        CHECK_EQ(sortOnce(), phases);
+    }
+    CHECK_EQ(Metrics::instance().totals().pageWrites, io.pageWrites);
+    Metrics::instance().reset();
+    CHECK(Metrics::instance().totals().empty());
+}
+
+void testJsonEscapesNames() {
+    Metrics::instance().reset();
+    Metrics::instance().beginPhase("a\"b\\c\nd\te\rf\x01g\x1f");
+    Metrics::instance().endPhase();
+    std::ostringstream json;
+    Metrics::instance().writeJson(json);
+    Metrics::instance().reset();
+    CHECK(
+        json.str().find("\"a\\\"b\\\\c\\nd\\te\\rf\\u0001g\\u001f\"") !=
+        std::string::npos
+    );
+}
+
+}  // namespace
+
+int main() {
+    return runTests({
+        {"record_count_is_kept", testRecordCountIsKept},
+        {"empty_records_are_kept", testEmptyRecordsAreKept},
+        {"lines_keep_empty_lines", testLinesKeepEmptyLines},
+        {"file_padding_is_skipped", testFilePaddingIsSkipped},
+        {"unique_and_limit_keep_counts", testUniqueAndLimitKeepCounts},
+        {"fixed_runs_are_rejected", testFixedRunsAreRejected},
+        {"metrics_do_not_pile_up", testMetricsDoNotPileUp},
+        {"json_escapes_names", testJsonEscapesNames},
+    });
+}
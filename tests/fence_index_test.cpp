@@ -0,0 +1,90 @@
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fence_index.hpp"
+#include "test_util.hpp"
+
+namespace {
+
+using Record = BasicRecord<30>;
+using FenceIndex = BasicFenceIndex<30>;
+using Range = std::pair<size_t, size_t>;
+
+// Index of pages that start with `firstRecords`, one of them per page
+FenceIndex indexOf(
+    const std::vector<std::string>& firstRecords, size_t stride
+) {
+    FenceIndex index(stride);
+    for (size_t i = 0; i < firstRecords.size(); i++) {
+        index.addPage(i, Record(firstRecords[i]));
+    }
+    return index;
+}
+
+void testPointQueries() {
+    auto index = indexOf({"a", "c", "c", "e", "g"}, 1);
+    CHECK(index.pagesFor(Record("b"), Record("b")) == Range(0, 1));
+    CHECK(index.pagesFor(Record("d"), Record("d")) == Range(2, 3));
+    CHECK(index.pagesFor(Record("h"), Record("h")) == Range(4, 5));
+    CHECK(index.pagesFor(Record("0"), Record("0")) == Range(0, 0));
+    // NOTE: Records equal to "c" at the end of page 0 are left to the caller
+    CHECK(index.pagesFor(Record("c"), Record("c")) == Range(2, 3));
+    CHECK(index.pagesFor(Record("e"), Record("e")) == Range(3, 4));
+}
+
+void testRangeQueries() {
+    auto index = indexOf({"a", "c", "c", "e", "g"}, 1);
+    CHECK(index.pagesFor(Record("b"), Record("d")) == Range(0, 3));
+    CHECK(index.pagesFor(Record("a"), Record("z")) == Range(0, 5));
+}
+
+void testStrideBoundsPointQueries() {
+    std::vector<std::string> firstRecords;
+    for (char c = 'a'; c <= 'x'; c++) {
+        firstRecords.emplace_back(1, c);
+    }
+    for (size_t stride : {1, 2, 4, 5}) {
+        auto index = indexOf(firstRecords, stride);
+        for (const auto& key : firstRecords) {
+            for (const auto& probe : {key, key + "m"}) {
+                Record r(probe);
+                auto [first, last] = index.pagesFor(r, r);
+                CHECK(first < last);
+                CHECK(last - first <= stride);
+                size_t page = key[0] - 'a';
+                CHECK(first <= page && page < last);
+            }
+        }
+    }
+}
+
+void testSaveAndLoad() {
+    auto index = indexOf({"a", "c", "c", "e", "g"}, 2);
+    index.save("temp/index.idx", 10, PageFormat::PREFIX);
+    CHECK_EQ(readFenceIndexRecordWidth("temp/index.idx"), size_t(30));
+    auto loaded = FenceIndex::load("temp/index.idx");
+    CHECK_EQ(loaded.recordsPerPage, size_t(10));
+    CHECK(loaded.format == PageFormat::PREFIX);
+    CHECK_EQ(loaded.index.getStride(), size_t(2));
+    CHECK_EQ(loaded.index.getPageCount(), size_t(5));
+    CHECK_EQ(loaded.index.getFences().size(), size_t(3));
+    CHECK(
+        loaded.index.pagesFor(Record("d"), Record("d")) ==
+        index.pagesFor(Record("d"), Record("d"))
+    );
+    std::filesystem::remove("temp/index.idx");
+}
+
+}  // namespace
+
+int main() {
+    return runTests({
+        {"point_queries", testPointQueries},
+        {"range_queries", testRangeQueries},
+        {"stride_bounds_point_queries", testStrideBoundsPointQueries},
+        {"save_and_load", testSaveAndLoad},
+    });
+}
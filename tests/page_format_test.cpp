@@ -0,0 +1,122 @@
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include "page_format.hpp"
+#include "test_util.hpp"
+
+namespace {
+
+using Record = BasicRecord<30>;
+
+// As many of `records` as fit in a page of `codec`, from `first` on
+std::vector<Record> fillPage(
+    const PageCodec<30>& codec,
+    const std::vector<Record>& records,
+    size_t& first
+) {
+    std::vector<Record> page;
+    size_t used = 0;
+    while (first < records.size()) {
+        const Record* previous = page.empty() ? nullptr : &page.back();
+        size_t cost = codec.recordCost(records[first], previous);
+        if (used + cost > codec.capacity()) {
+            break;
+        }
+        used += cost;
+        page.push_back(records[first++]);
+    }
+    return page;
+}
+
+void testFormatNames() {
+    for (auto format :
+         {PageFormat::FIXED, PageFormat::VARIABLE, PageFormat::PREFIX}) {
+        CHECK(parsePageFormat(pageFormatName(format)) == format);
+    }
+    CHECK(!parsePageFormat("slotted").has_value());
+}
+
+void testFixedPagesArePadded() {
+    PageCodec<30> codec(PageFormat::FIXED, 4 * 30);
+    std::vector<char> bytes;
+    codec.encode({"a", "b"}, bytes);
+    CHECK_EQ(bytes.size(), size_t(4 * 30));
+    std::vector<Record> page;
+    codec.decode(bytes, page);
+    CHECK(page == std::vector<Record>({"a", "b", Record::empty, Record::empty})
+    );
+}
+
+void testRoundTrip() {
+    auto records = randomRecords<30>(2000, 29);
+    records[10] = Record::empty;
+    records[11] = Record(30, 'z');
+    std::ranges::sort(records.begin() + 1000, records.end());
+    for (auto format : {PageFormat::VARIABLE, PageFormat::PREFIX}) {
+        PageCodec<30> codec(format, 10 * 30);
+        std::vector<Record> decoded;
+        size_t next = 0;
+        while (next < records.size()) {
+            size_t first = next;
+            auto page = fillPage(codec, records, next);
+            CHECK(!page.empty());
+            if (page.empty()) {
+                break;
+            }
+            std::vector<char> bytes;
+            codec.encode(page, bytes);
+            CHECK_EQ(bytes.size(), size_t(10 * 30));
+            CHECK_EQ(codec.recordCountFromHeader(bytes.data()), next - first);
+            std::vector<Record> out;
+            codec.decode(bytes, out);
+            decoded.insert(decoded.end(), out.begin(), out.end());
+        }
+        CHECK(decoded == records);
+    }
+}
+
+void testPrefixSharesPrefixes() {
+    // NOTE: Sorted neighbours share all but their last byte
+    std::vector<Record> records;
+    for (char c = 'a'; c <= 'z'; c++) {
+        records.emplace_back(std::string(29, 'p') + c);
+    }
+    PageCodec<30> prefix(PageFormat::PREFIX, 10 * 30);
+    PageCodec<30> variable(PageFormat::VARIABLE, 10 * 30);
+    size_t next = 0;
+    CHECK_EQ(fillPage(prefix, records, next).size(), records.size());
+    next = 0;
+    CHECK(fillPage(variable, records, next).size() < 10);
+}
+
+void testInvalidPages() {
+    CHECK_THROWS(
+        PageCodec<30>(PageFormat::VARIABLE, 30), std::invalid_argument
+    );
+    CHECK_THROWS(
+        PageCodec<30>(PageFormat::PREFIX, 1 << 17), std::invalid_argument
+    );
+
+    PageCodec<30> codec(PageFormat::VARIABLE, 2 * 30);
+    std::vector<char> bytes;
+    CHECK_THROWS(
+        codec.encode({Record(30, 'a'), Record(30, 'b')}, bytes),
+        std::length_error
+    );
+    bytes.assign(2 * 30, '\xff');
+    std::vector<Record> page;
+    CHECK_THROWS(codec.decode(bytes, page), std::runtime_error);
+}
+
+}  // namespace
+
+int main() {
+    return runTests({
+        {"format_names", testFormatNames},
+        {"fixed_pages_are_padded", testFixedPagesArePadded},
+        {"round_trip", testRoundTrip},
+        {"prefix_shares_prefixes", testPrefixSharesPrefixes},
+        {"invalid_pages", testInvalidPages},
+    });
+}
@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "record_order.hpp"
+#include "sorter.hpp"
+#include "test_util.hpp"
+
+namespace {
+
+using Record = BasicRecord<30>;
+using BufferedFile = BasicBufferedFile<30>;
+
+std::vector<Record> recordsOf(const std::vector<std::string>& texts) {
+    return {texts.begin(), texts.end()};
+}
+
+// Sorts `records` in a file in `order` and returns what it holds afterwards
+std::vector<Record> sortInFile(
+    const std::vector<Record>& records, const RecordOrder& order
+) {
+    writeRecords<30>("temp/ordered", records, 10, PageFormat::VARIABLE);
+    auto config = smallConfig();
+    config.order = order;
+    {
+        BufferedFile f("temp/ordered", 10, PageFormat::VARIABLE);
+        sortFile(f, config);
+    }
+    auto sorted = readRecords<30>("temp/ordered", 10, PageFormat::VARIABLE);
+    std::filesystem::remove("temp/ordered");
+    return sorted;
+}
+
+void testNames() {
+    auto order = parseRecordOrder("descending,numeric,ignore-case");
+    CHECK(order.has_value());
+    CHECK(order->descending && order->numeric && order->ignoreCase);
+    CHECK_EQ(recordOrderName(*order), "descending,numeric,ignore-case");
+    CHECK(parseRecordOrder("ascending") == RecordOrder{});
+    CHECK(parseRecordOrder("numeric")->numeric);
+    CHECK(!parseRecordOrder("desc").has_value());
+    CHECK(!parseRecordOrder("ascending,").has_value());
+    for (bool descending : {false, true}) {
+        for (bool numeric : {false, true}) {
+            for (bool ignoreCase : {false, true}) {
+                RecordOrder o{descending, numeric, ignoreCase};
+                CHECK(parseRecordOrder(recordOrderName(o)) == o);
+            }
+        }
+    }
+}
+
+void testCompare() {
+    auto compare = compareRecordText<true, true>;
+    auto compareBytes = compareRecordText<false, false>;
+    auto compareCaseless = compareRecordText<false, true>;
+    CHECK(compare("9", "10") < 0);
+    CHECK(compare("a007", "A7") == 0);
+    CHECK(compare("a7b", "a7") > 0);
+    CHECK(compareBytes("9", "10") > 0);
+    CHECK(compareCaseless("B", "a") > 0);
+    // NOTE: Records equal in the order still have an order of their bytes
+    RecordLess<false, true, true> less;
+    CHECK(less(Record("A7"), Record("a007")));
+    CHECK(!less(Record("a007"), Record("A7")));
+}
+
+void testSortOrders() {
+    auto records = recordsOf({"b10", "B9", "a", "b9", "100", "9", "A", "010"});
+    RecordOrder descending{.descending = true};
+    CHECK(
+        sortInFile(records, descending) ==
+        recordsOf({"b9", "b10", "a", "B9", "A", "9", "100", "010"})
+    );
+    RecordOrder numeric{.numeric = true};
+    CHECK(
+        sortInFile(records, numeric) ==
+        recordsOf({"9", "010", "100", "A", "B9", "a", "b9", "b10"})
+    );
+    RecordOrder ignoreCase{.ignoreCase = true};
+    CHECK(
+        sortInFile(records, ignoreCase) ==
+        recordsOf({"010", "100", "9", "A", "a", "b10", "B9", "b9"})
+    );
+    RecordOrder both{.numeric = true, .ignoreCase = true};
+    CHECK(
+        sortInFile(records, both) ==
+        recordsOf({"9", "010", "100", "A", "a", "B9", "b9", "b10"})
+    );
+}
+
+void testSortsAreInOrder() {
+    // NOTE: Many pages, so runs are merged in the order too
+    auto records = randomRecords<30>(3001, 23, 16, 6);
+    for (const char* name : {"descending", "ascending,numeric",
+                             "descending,ignore-case",
+                             "descending,numeric,ignore-case"}) {
+        auto order = *parseRecordOrder(name);
+        auto sorted = sortInFile(records, order);
+        dispatchRecordOrder(order, [&]<typename Less>() {
+            auto expected = records;
+            std::ranges::sort(expected, Less{});
+            CHECK(sorted == expected);
+        });
+    }
+}
+
+}  // namespace
+
+int main() {
+    return runTests({
+        {"names", testNames},
+        {"compare", testCompare},
+        {"sort_orders", testSortOrders},
+        {"sorts_are_in_order", testSortsAreInOrder},
+    });
+}
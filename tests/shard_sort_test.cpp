@@ -0,0 +1,124 @@
+#include <cstddef>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "shard_sort.hpp"
+#include "sorter.hpp"
+#include "test_util.hpp"
+
+namespace {
+
+using Record = BasicRecord<30>;
+using BufferedFile = BasicBufferedFile<30>;
+
+// Workers run the sort_files built along with the test, SORT_FILES_PATH
+ShardConfig shardConfig(const SortConfig& config) {
+    ShardConfig shards;
+    shards.shardCount = 3;
+    shards.samplesPerShard = 8;
+    shards.workerCommand = {
+        SORT_FILES_PATH,
+        "-l",
+        "-n",
+        std::to_string(config.bufferCount),
+        "-b",
+        std::to_string(config.blockingFactor),
+        "--order",
+        recordOrderName(config.order),
+    };
+    if (config.dedup == DedupMode::UNIQUE) {
+        shards.workerCommand.push_back("--unique");
+    }
+    return shards;
+}
+
+// Records with duplicates and empty records within them. 997 of them leave
+// a last page of 7 records, padded with 3 more empty ones.
+std::vector<Record> inputRecords() {
+    auto records = randomRecords<30>(997, 43, 10, 3);
+    for (size_t i = 0; i < records.size(); i += 101) {
+        records[i] = Record::empty;
+    }
+    return records;
+}
+
+// Sorts the records once by shards and once by sortFile and checks that
+// both files end up the same
+void checkShardedSort(const SortConfig& config) {
+    auto records = inputRecords();
+    writeRecords<30>("temp/sharded", records, 10);
+    writeRecords<30>("temp/unsharded", records, 10);
+    SortStats sharded;
+    SortStats unsharded;
+    {
+        BufferedFile f("temp/sharded", 10);
+        sharded = sortSharded(f, config, shardConfig(config));
+    }
+    {
+        BufferedFile f("temp/unsharded", 10);
+        unsharded = sortFile(f, config);
+    }
+    CHECK(fileBytes("temp/sharded") == fileBytes("temp/unsharded"));
+    if (config.dedup != DedupMode::NONE || config.limit.has_value()) {
+        CHECK_EQ(sharded.outputCount, unsharded.outputCount);
+    }
+    std::filesystem::remove("temp/sharded");
+    std::filesystem::remove("temp/unsharded");
+}
+
+void testSortsLikeSortFile() {
+    for (bool descending : {false, true}) {
+        auto config = smallConfig();
+        config.order.descending = descending;
+        checkShardedSort(config);
+    }
+}
+
+void testUnique() {
+    for (bool descending : {false, true}) {
+        auto config = smallConfig();
+        config.order.descending = descending;
+        config.dedup = DedupMode::UNIQUE;
+        checkShardedSort(config);
+    }
+}
+
+void testLimit() {
+    // NOTE: In the descending order the empty records and the padding come
+    // last, so workers have to keep more than the limit for them
+    for (bool descending : {false, true}) {
+        for (size_t limit : {5, 137, 996}) {
+            auto config = smallConfig();
+            config.order.descending = descending;
+            config.limit = limit;
+            checkShardedSort(config);
+            config.dedup = DedupMode::UNIQUE;
+            checkShardedSort(config);
+        }
+    }
+}
+
+void testFailedWorker() {
+    writeRecords<30>("temp/failing", inputRecords(), 10);
+    auto config = smallConfig();
+    auto shards = shardConfig(config);
+    shards.workerCommand.push_back("--no-such-option");
+    {
+        BufferedFile f("temp/failing", 10);
+        CHECK_THROWS(sortSharded(f, config, shards), std::runtime_error);
+    }
+    std::filesystem::remove("temp/failing");
+}
+
+}  // namespace
+
+int main() {
+    return runTests({
+        {"sorts_like_sort_file", testSortsLikeSortFile},
+        {"unique", testUnique},
+        {"limit", testLimit},
+        {"failed_worker", testFailedWorker},
+    });
+}
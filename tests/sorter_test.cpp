@@ -0,0 +1,415 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "sorter.hpp"
+#include "test_util.hpp"
+
+namespace {
+
+using Record = BasicRecord<30>;
+using BufferedFile = BasicBufferedFile<30>;
+
+// Sorts `records` in a file of `format` and returns what it holds afterwards
+std::vector<Record> sortRecordsInFile(
+    const std::vector<Record>& records,
+    PageFormat format,
+    const SortConfig& config
+) {
+    writeRecords<30>("temp/sorted", records, 10, format);
+    {
+        BufferedFile f("temp/sorted", 10, format);
+        sortFile(f, config);
+    }
+    auto sorted = readRecords<30>("temp/sorted", 10, format);
+    std::filesystem::remove("temp/sorted");
+    return sorted;
+}
+
+void testRunFormats() {
+    auto records = randomRecords<30>(997, 5);
+    for (PageFormat runs : {PageFormat::VARIABLE, PageFormat::PREFIX}) {
+        auto config = smallConfig();
+        config.runFormat = runs;
+        CHECK(sortRecordsInFile(records, PageFormat::VARIABLE, config) ==
+              sortedCopy(records));
+    }
+}
+
+void testFixedRunsNeedFixedPages() {
+    auto config = smallConfig();
+    config.runFormat = PageFormat::FIXED;
+    CHECK_THROWS(
+        sortRecordsInFile({"b", "a"}, PageFormat::VARIABLE, config),
+        std::invalid_argument
+    );
+}
+
+// NOTE: The padding of a fixed file is sorted like any record, so the inputs
+// fill whole pages
+void testUniqueKeepsDistinctRecords() {
+    auto records = randomRecords<30>(1000, 13, 2, 3);
+    auto expected = sortedCopy(records);
+    auto last = std::ranges::unique(expected);
+    expected.erase(last.begin(), last.end());
+
+    auto config = smallConfig();
+    config.dedup = DedupMode::UNIQUE;
+    writeRecords<30>("temp/unique", records, 10);
+    SortStats stats;
+    {
+        BufferedFile f("temp/unique", 10);
+        stats = sortFile(f, config);
+    }
+    CHECK_EQ(stats.outputCount, expected.size());
+    auto sorted = readRecords<30>("temp/unique", 10);
+    CHECK_EQ(sorted.size(), (expected.size() + 9) / 10 * 10);
+    sorted.resize(expected.size());
+    CHECK(sorted == expected);
+    std::filesystem::remove("temp/unique");
+}
+
+void testCountWritesOccurrences() {
+    std::vector<Record> records;
+    for (size_t i = 0; i < 100; i++) {
+        records.emplace_back(std::to_string(i % 7));
+    }
+    auto config = smallConfig();
+    config.dedup = DedupMode::COUNT;
+    writeRecords<30>("temp/counted", records, 10);
+    {
+        BufferedFile f("temp/counted", 10);
+        sortFile(f, config);
+    }
+    std::ifstream counts(countsPath("temp/counted"));
+    std::string line;
+    std::vector<std::string> lines;
+    while (std::getline(counts, line)) {
+        lines.push_back(line);
+    }
+    CHECK(lines == std::vector<std::string>({
+                       "15 0",
+                       "15 1",
+                       "14 2",
+                       "14 3",
+                       "14 4",
+                       "14 5",
+                       "14 6",
+                   }));
+    std::filesystem::remove("temp/counted");
+    std::filesystem::remove(countsPath("temp/counted"));
+}
+
+void testLimitKeepsSmallestRecords() {
+    auto records = randomRecords<30>(1000, 17);
+    auto all = sortedCopy(records);
+    // NOTE: 7 records fit in the buffers and take the heap, 37 do not
+    for (size_t limit : {7, 37}) {
+        auto config = smallConfig();
+        config.limit = limit;
+        writeRecords<30>("temp/limited", records, 10);
+        SortStats stats;
+        {
+            BufferedFile f("temp/limited", 10);
+            stats = sortFile(f, config);
+        }
+        CHECK_EQ(stats.outputCount, limit);
+        auto sorted = readRecords<30>("temp/limited", 10);
+        sorted.resize(limit);
+        CHECK(sorted == std::vector<Record>(all.begin(), all.begin() + limit));
+    }
+    std::filesystem::remove("temp/limited");
+}
+
+void testIndexNeedsTheByteOrder() {
+    auto records = randomRecords<30>(100, 41);
+    auto config = smallConfig();
+    config.indexStride = 1;
+    config.order.descending = true;
+    CHECK_THROWS(
+        sortRecordsInFile(records, PageFormat::FIXED, config),
+        std::invalid_argument
+    );
+    CHECK(!std::filesystem::exists(fenceIndexPath("temp/sorted")));
+    config.order = {};
+    CHECK(sortRecordsInFile(records, PageFormat::FIXED, config) ==
+          sortedCopy(records));
+    CHECK(std::filesystem::exists(fenceIndexPath("temp/sorted")));
+    std::filesystem::remove(fenceIndexPath("temp/sorted"));
+}
+
+void testPipelineWritesTheSameFile() {
+    // NOTE: The fixed runs are written over the input the reader still reads
+    auto records = randomRecords<30>(1993, 29);
+    for (PageFormat format : {PageFormat::FIXED, PageFormat::VARIABLE}) {
+        std::string files[2];
+        for (bool pipelined : {false, true}) {
+            auto config = smallConfig();
+            config.pipelined = pipelined;
+            config.threadCount = 2;
+            if (format == PageFormat::VARIABLE) {
+                config.runFormat = PageFormat::PREFIX;
+            }
+            writeRecords<30>("temp/pipelined", records, 10, format);
+            SortStats stats;
+            {
+                BufferedFile f("temp/pipelined", 10, format);
+                stats = sortFile(f, config);
+            }
+            CHECK(stats.runCount > 3);
+            files[pipelined] = fileBytes("temp/pipelined");
+        }
+        CHECK(!files[0].empty());
+        CHECK(files[0] == files[1]);
+    }
+    std::filesystem::remove("temp/pipelined");
+}
+
+void testPipelineFailureReachesTheCaller() {
+    // NOTE: A thread blocked on a queue would never be joined, so ctest's
+    // timeout fails the test instead. Failing after a few pages leaves
+    // batches in every stage.
+    for (size_t failAfter : {0, 1, 5, 40}) {
+        auto config = smallConfig();
+        config.pipelined = true;
+        auto records = randomRecords<30>(10, 31);
+        size_t pages = 0;
+        PageSource<30> source = [&](std::vector<Record>& page) {
+            if (pages++ == failAfter) {
+                throw std::runtime_error("source failed");
+            }
+            page = records;
+            return true;
+        };
+        CHECK_THROWS(
+            sortRecords<30>(source, [](const Record&) {}, 10, config),
+            std::runtime_error
+        );
+    }
+}
+
+void testFixedRunsCanNotShrink() {
+    auto config = smallConfig();
+    config.runFormat = PageFormat::FIXED;
+    config.dedup = DedupMode::UNIQUE;
+    CHECK_THROWS(
+        sortRecordsInFile({"b", "a"}, PageFormat::FIXED, config),
+        std::invalid_argument
+    );
+    // NOTE: A limit that fits in the buffers writes no runs at all
+    config.dedup = DedupMode::NONE;
+    config.limit = 37;
+    CHECK_THROWS(
+        sortRecordsInFile(
+            randomRecords<30>(100, 19), PageFormat::FIXED, config
+        ),
+        std::invalid_argument
+    );
+}
+
+// Writes every part of `records` to a sorted file of its own and returns the
+// names of the files
+std::vector<std::string> writeSortedParts(
+    const std::vector<Record>& records, size_t partCount
+) {
+    std::vector<std::string> fileNames;
+    for (size_t part = 0; part < partCount; part++) {
+        std::vector<Record> partRecords;
+        for (size_t i = part; i < records.size(); i += partCount) {
+            partRecords.push_back(records[i]);
+        }
+        fileNames.push_back(std::format("temp/part{}", part));
+        writeRecords<30>(
+            fileNames.back(),
+            sortedCopy(partRecords),
+            10,
+            PageFormat::VARIABLE
+        );
+    }
+    return fileNames;
+}
+
+// Merges the files into "temp/merged" and returns what it holds afterwards
+std::vector<Record> mergeIntoFile(
+    const std::vector<std::string>& fileNames, const SortConfig& config
+) {
+    std::vector<std::unique_ptr<BufferedFile>> opened;
+    std::vector<BufferedFile*> inputs;
+    for (const auto& name : fileNames) {
+        opened.push_back(
+            std::make_unique<BufferedFile>(name, 10, PageFormat::VARIABLE)
+        );
+        inputs.push_back(opened.back().get());
+    }
+    std::filesystem::remove("temp/merged");
+    {
+        BufferedFile f("temp/merged", 10, PageFormat::VARIABLE);
+        mergeFiles(inputs, f, config);
+    }
+    auto merged = readRecords<30>("temp/merged", 10, PageFormat::VARIABLE);
+    std::filesystem::remove("temp/merged");
+    return merged;
+}
+
+void testMergeCascadesManyInputs() {
+    // NOTE: With 3 buffers only 2 inputs are merged at a time
+    auto records = randomRecords<30>(1201, 37);
+    auto fileNames = writeSortedParts(records, 7);
+    CHECK(mergeIntoFile(fileNames, smallConfig()) == sortedCopy(records));
+    for (const auto& name : fileNames) {
+        std::filesystem::remove(name);
+    }
+}
+
+void testMergeRejectsUnsortedInputs() {
+    auto records = randomRecords<30>(500, 41);
+    auto fileNames = writeSortedParts(records, 4);
+    writeRecords<30>(fileNames[2], records, 10, PageFormat::VARIABLE);
+    CHECK_THROWS(mergeIntoFile(fileNames, smallConfig()), std::runtime_error);
+    for (const auto& name : fileNames) {
+        std::filesystem::remove(name);
+    }
+    std::filesystem::remove("temp/merged");
+}
+
+void testSortedCopyLeavesTheInput() {
+    auto records = randomRecords<30>(997, 43);
+    writeRecords<30>("temp/unsorted", records, 10, PageFormat::VARIABLE);
+    std::string before = fileBytes("temp/unsorted");
+    {
+        BufferedFile in("temp/unsorted", 10, PageFormat::VARIABLE);
+        CHECK(!isSorted(in, RecordOrder{}));
+        auto copy = sortIntoTempFile(in, smallConfig());
+        BufferedFile& sorted = *copy;
+        CHECK(isSorted(sorted, RecordOrder{}));
+        CHECK_EQ(sorted.getRecordCount(), records.size());
+        CHECK(
+            readRecords<30>(copy->getFileName(), 10, PageFormat::VARIABLE) ==
+            sortedCopy(records)
+        );
+    }
+    CHECK(fileBytes("temp/unsorted") == before);
+    std::filesystem::remove("temp/unsorted");
+}
+
+// Writes the sorted `prefix` to `fileName` and appends the pages of `appended`
+// after it, as a sorted file that had records added would hold them. Returns
+// the number of pages of the prefix.
+size_t writeAppendedFile(
+    const std::string& fileName,
+    const std::vector<Record>& prefix,
+    const std::vector<Record>& appended,
+    PageFormat format
+) {
+    writeRecords<30>(fileName, sortedCopy(prefix), 10, format);
+    BufferedFile f(fileName, 10, format);
+    size_t sortedPages = f.getPageCount();
+    for (size_t i = 0; i < appended.size(); i += 10) {
+        size_t end = std::min(i + 10, appended.size());
+        std::vector<Record> page(appended.begin() + i, appended.begin() + end);
+        f.writePage(f.getPageCount(), page);
+    }
+    return sortedPages;
+}
+
+void testAppendedSortsLikeSortFile() {
+    // NOTE: 97 records leave the last page of the prefix partial, with fixed
+    // pages it ends in padding that sorts before the records
+    auto appended = randomRecords<30>(433, 47);
+    for (PageFormat format : {PageFormat::FIXED, PageFormat::VARIABLE}) {
+        for (size_t prefixCount : {0, 97, 100, 601}) {
+            auto prefix = randomRecords<30>(prefixCount, 53);
+            size_t sortedPages = writeAppendedFile(
+                "temp/appended", prefix, appended, format
+            );
+            writeAppendedFile("temp/resorted", prefix, appended, format);
+            {
+                BufferedFile f("temp/appended", 10, format);
+                sortAppended(f, sortedPages, smallConfig());
+            }
+            {
+                BufferedFile f("temp/resorted", 10, format);
+                sortFile(f, smallConfig());
+            }
+            CHECK(fileBytes("temp/appended") == fileBytes("temp/resorted"));
+        }
+    }
+    std::filesystem::remove("temp/appended");
+    std::filesystem::remove("temp/resorted");
+}
+
+// Whether the file system of temp/ can punch holes, which a sort that
+// releases consumed pages needs
+bool canPunchHoles() {
+    writeRecords<30>("temp/holes", randomRecords<30>(10000, 59), 10);
+    int fd = ::open("temp/holes", O_RDWR);
+    CHECK(fd >= 0);
+    int result = ::fallocate(
+        fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, 65536, 65536
+    );
+    int error = errno;
+    ::close(fd);
+    std::filesystem::remove("temp/holes");
+    return result == 0 || error != EOPNOTSUPP;
+}
+
+void testReleasingWritesTheSameFile() {
+    if (!canPunchHoles()) {
+        std::cout << "SKIP releasing_writes_the_same_file, temp/ can "
+                     "not punch holes"
+                  << std::endl;
+        return;
+    }
+    // NOTE: Runs of fixed files are written over the input, so both the
+    // runs and the input have pages released
+    auto records = randomRecords<30>(5003, 61);
+    for (PageFormat format : {PageFormat::FIXED, PageFormat::VARIABLE}) {
+        std::string files[2];
+        for (bool releasing : {false, true}) {
+            auto config = smallConfig();
+            config.releaseConsumed = releasing;
+            writeRecords<30>("temp/released", records, 10, format);
+            {
+                BufferedFile f("temp/released", 10, format);
+                sortFile(f, config);
+            }
+            files[releasing] = fileBytes("temp/released");
+        }
+        CHECK(!files[0].empty());
+        CHECK(files[0] == files[1]);
+    }
+    std::filesystem::remove("temp/released");
+}
+
+}  // namespace
+
+int main() {
+    return runTests({
+        {"run_formats", testRunFormats},
+        {"fixed_runs_need_fixed_pages", testFixedRunsNeedFixedPages},
+        {"unique_keeps_distinct_records", testUniqueKeepsDistinctRecords},
+        {"count_writes_occurrences", testCountWritesOccurrences},
+        {"limit_keeps_smallest_records", testLimitKeepsSmallestRecords},
+        {"fixed_runs_can_not_shrink", testFixedRunsCanNotShrink},
+        {"index_needs_the_byte_order", testIndexNeedsTheByteOrder},
+        {"pipeline_writes_the_same_file", testPipelineWritesTheSameFile},
+        {"pipeline_failure_reaches_the_caller",
+         testPipelineFailureReachesTheCaller},
+        {"merge_cascades_many_inputs", testMergeCascadesManyInputs},
+        {"merge_rejects_unsorted_inputs", testMergeRejectsUnsortedInputs},
+        {"sorted_copy_leaves_the_input", testSortedCopyLeavesTheInput},
+        {"appended_sorts_like_sort_file", testAppendedSortsLikeSortFile},
+        {"releasing_writes_the_same_file", testReleasingWritesTheSameFile},
+    });
+}
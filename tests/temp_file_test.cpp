@@ -0,0 +1,76 @@
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "temp_file.hpp"
+#include "test_util.hpp"
+
+namespace {
+
+using TempFile = BasicTempFile<30>;
+
+const std::filesystem::path FIRST = "temp/placement/first";
+const std::filesystem::path SECOND = "temp/placement/second";
+
+// Directory of every one of `count` temporary files created one after the
+// other, all kept open
+std::vector<std::filesystem::path> placeFiles(
+    TempPlacement placement, size_t count
+) {
+    std::filesystem::remove_all("temp/placement");
+    setTempDirectories({FIRST, SECOND}, placement);
+    std::vector<std::unique_ptr<TempFile>> files;
+    std::vector<std::filesystem::path> dirs;
+    for (size_t i = 0; i < count; i++) {
+        files.push_back(std::make_unique<TempFile>(10));
+        dirs.push_back(
+            std::filesystem::path(files.back()->getFileName()).parent_path()
+        );
+        // NOTE: Measuring the free space must not create the other one
+        if (i == 0) {
+            CHECK(
+                std::filesystem::exists(FIRST) !=
+                std::filesystem::exists(SECOND)
+            );
+        }
+    }
+    setTempDirectories({"temp"});
+    std::filesystem::remove_all("temp/placement");
+    return dirs;
+}
+
+void testRoundRobinAlternates() {
+    auto dirs = placeFiles(TempPlacement::ROUND_ROBIN, 5);
+    std::vector<std::filesystem::path> expected{
+        FIRST, SECOND, FIRST, SECOND, FIRST
+    };
+    CHECK(dirs == expected);
+}
+
+void testFreeSpaceAlternates() {
+    auto dirs = placeFiles(TempPlacement::FREE_SPACE, 5);
+    for (size_t i = 1; i < dirs.size(); i++) {
+        CHECK(dirs[i] == FIRST || dirs[i] == SECOND);
+        CHECK(dirs[i] != dirs[i - 1]);
+    }
+}
+
+void testPlacementNames() {
+    for (auto placement :
+         {TempPlacement::ROUND_ROBIN, TempPlacement::FREE_SPACE}) {
+        CHECK(parseTempPlacement(tempPlacementName(placement)) == placement);
+    }
+    CHECK(!parseTempPlacement("random").has_value());
+}
+
+}  // namespace
+
+int main() {
+    return runTests({
+        {"round_robin_alternates", testRoundRobinAlternates},
+        {"free_space_alternates", testFreeSpaceAlternates},
+        {"placement_names", testPlacementNames},
+    });
+}
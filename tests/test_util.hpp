@@ -0,0 +1,171 @@
+#ifndef TEST_UTIL_HPP
+#define TEST_UTIL_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "buffer.hpp"
+#include "file_buffering.hpp"
+#include "page_format.hpp"
+#include "record.hpp"
+#include "sort_config.hpp"
+
+// Checks that failed so far, the test program fails if there are any
+inline size_t failedChecks = 0;
+
+// Reports the condition with its line if it does not hold, the test goes on
+#define CHECK(cond)                                                  \
+    do {                                                             \
+        if (!(cond)) {                                               \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #cond \
+                      << ") failed" << std::endl;                    \
+            failedChecks++;                                          \
+        }                                                            \
+    } while (false)
+
+// Like CHECK, also printing both values
+#define CHECK_EQ(a, b)                                                   \
+    do {                                                                 \
+        auto valueA = (a);                                               \
+        auto valueB = (b);                                               \
+        if (!(valueA == valueB)) {                                       \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK_EQ(" #a \
+                      << ", " #b ") failed: " << valueA                  \
+                      << " != " << valueB << std::endl;                  \
+            failedChecks++;                                              \
+        }                                                                \
+    } while (false)
+
+// Checks that `expr` throws `Exception`
+#define CHECK_THROWS(expr, Exception)                                  \
+    do {                                                               \
+        bool thrown = false;                                           \
+        try {                                                          \
+            expr;                                                      \
+        } catch (const Exception&) {                                   \
+            thrown = true;                                             \
+        }                                                              \
+        if (!thrown) {                                                 \
+            std::cerr << __FILE__ << ":" << __LINE__                   \
+                      << ": CHECK_THROWS(" #expr ", " #Exception       \
+                      << ") did not throw" << std::endl;               \
+            failedChecks++;                                            \
+        }                                                              \
+    } while (false)
+
+struct TestCase {
+    std::string_view name;
+    std::function<void()> run;
+};
+
+// Runs every test with the temporary files in "temp" of the working
+// directory and returns the exit status of the test program. A test that
+// throws fails, the others still run.
+inline int runTests(const std::vector<TestCase>& tests) {
+    std::filesystem::create_directories("temp");
+    for (const auto& test : tests) {
+        size_t failedBefore = failedChecks;
+        try {
+            test.run();
+        } catch (const std::exception& e) {
+            std::cerr << test.name << " threw: " << e.what() << std::endl;
+            failedChecks++;
+        }
+        std::cout << (failedChecks == failedBefore ? "PASS " : "FAIL ")
+                  << test.name << std::endl;
+    }
+    return failedChecks == 0 ? 0 : 1;
+}
+
+// A sort of three buffers of 10 record pages without logs, so a few hundred
+// records already take several runs and merge phases
+inline SortConfig smallConfig() {
+    SortConfig config;
+    config.bufferCount = 3;
+    config.blockingFactor = 10;
+    config.logging = false;
+    return config;
+}
+
+template <size_t RecordLen>
+std::vector<BasicRecord<RecordLen>> sortedCopy(
+    std::vector<BasicRecord<RecordLen>> records
+) {
+    std::ranges::sort(records);
+    return records;
+}
+
+// `count` records of random digits and letters of 1 to maxLength bytes, the
+// same for every seed. A small alphabet and length give duplicates.
+template <size_t RecordLen>
+std::vector<BasicRecord<RecordLen>> randomRecords(
+    size_t count,
+    unsigned seed,
+    size_t alphabetSize = 36,
+    size_t maxLength = RecordLen
+) {
+    static constexpr std::string_view alphabet =
+        "0123456789abcdefghijklmnopqrstuvwxyz";
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<size_t> length(1, maxLength);
+    std::uniform_int_distribution<size_t> symbol(0, alphabetSize - 1);
+    std::vector<BasicRecord<RecordLen>> records;
+    for (size_t i = 0; i < count; i++) {
+        std::string s(length(gen), ' ');
+        for (auto& c : s) {
+            c = alphabet[symbol(gen)];
+        }
+        records.emplace_back(s);
+    }
+    return records;
+}
+
+// Replaces the content of `fileName` with `records`
+template <size_t RecordLen>
+void writeRecords(
+    const std::string& fileName,
+    const std::vector<BasicRecord<RecordLen>>& records,
+    size_t recordsPerPage,
+    PageFormat format = PageFormat::FIXED
+) {
+    std::filesystem::remove(fileName);
+    BasicBufferedFile<RecordLen> f(fileName, recordsPerPage, format);
+    BasicBuffer<RecordLen> out(f.pages());
+    for (const auto& r : records) {
+        out.append(r);
+    }
+}
+
+// Every byte of `fileName`, to compare files that should be the same
+inline std::string fileBytes(const std::string& fileName) {
+    std::ifstream in(fileName, std::ios::binary);
+    return {std::istreambuf_iterator<char>(in), {}};
+}
+
+// Every record of every page of `fileName`, the padding of fixed pages
+// included
+template <size_t RecordLen>
+std::vector<BasicRecord<RecordLen>> readRecords(
+    const std::string& fileName,
+    size_t recordsPerPage,
+    PageFormat format = PageFormat::FIXED
+) {
+    BasicBufferedFile<RecordLen> f(fileName, recordsPerPage, format);
+    std::vector<BasicRecord<RecordLen>> records;
+    for (std::vector<BasicRecord<RecordLen>> page : f.pages()) {
+        records.insert(records.end(), page.begin(), page.end());
+    }
+    return records;
+}
+
+#endif  // !TEST_UTIL_HPP
@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "sorter.hpp"
+#include "test_util.hpp"
+#include "verifier.hpp"
+
+namespace {
+
+using Record = BasicRecord<30>;
+
+// Writes the records one after the other, without pages, like create_files
+void writeRaw(const std::string& fileName, const std::vector<Record>& records) {
+    std::ofstream out(fileName, std::ios::binary | std::ios::trunc);
+    for (const auto& r : records) {
+        out.write(r.data().data(), 30);
+    }
+}
+
+ScanResult scanFixed(
+    const std::string& fileName,
+    size_t recordsPerPage,
+    size_t threadCount,
+    bool checkOrder,
+    const RecordOrder& order = {}
+) {
+    return scanRecordFile(
+        fileName,
+        30,
+        recordsPerPage,
+        PageFormat::FIXED,
+        threadCount,
+        checkOrder,
+        order
+    );
+}
+
+void testTrailingPaddingIsSkipped() {
+    writeRecords<30>("temp/verified", {"a", "b", "c"}, 10);
+    auto result = scanFixed("temp/verified", 10, 2, true);
+    CHECK_EQ(result.recordCount, size_t(3));
+    CHECK_EQ(result.paddingCount, size_t(7));
+    CHECK(!result.firstUnsorted.has_value());
+    std::filesystem::remove("temp/verified");
+}
+
+void testInnerEmptyRecordsAreChecked() {
+    // NOTE: Only the last page ends in padding, not the first one
+    std::vector<Record> records = {"a", "b", Record::empty, "c"};
+    writeRecords<30>("temp/verified", records, 2);
+    auto result = scanFixed("temp/verified", 2, 1, true);
+    CHECK_EQ(result.recordCount, size_t(4));
+    CHECK_EQ(result.paddingCount, size_t(0));
+    CHECK(result.firstUnsorted == std::optional<size_t>(2));
+
+    writeRecords<30>("temp/verified", {"b", "a", Record::empty}, 2);
+    result = scanFixed(
+        "temp/verified", 2, 1, true, *parseRecordOrder("descending")
+    );
+    CHECK_EQ(result.recordCount, size_t(2));
+    CHECK(!result.firstUnsorted.has_value());
+    std::filesystem::remove("temp/verified");
+}
+
+void testSortedFileIsPermutation() {
+    // NOTE: The input ends within a page, the sort pads it
+    auto records = randomRecords<30>(1003, 23);
+    writeRaw("temp/verified_in", records);
+    writeRaw("temp/verified", records);
+    {
+        BasicBufferedFile<30> f("temp/verified", 10);
+        SortConfig config;
+        config.bufferCount = 3;
+        config.logging = false;
+        sortFile(f, config);
+    }
+    for (size_t threads : {1, 3, 8}) {
+        auto output = scanFixed("temp/verified", 10, threads, true);
+        auto input = scanFixed("temp/verified_in", 10, threads, false);
+        CHECK(!output.firstUnsorted.has_value());
+        CHECK(output.hash == input.hash);
+    }
+
+    records.push_back(records.front());
+    writeRaw("temp/verified_in", records);
+    auto output = scanFixed("temp/verified", 10, 2, true);
+    auto input = scanFixed("temp/verified_in", 10, 2, false);
+    CHECK(!(output.hash == input.hash));
+    std::filesystem::remove("temp/verified");
+    std::filesystem::remove("temp/verified_in");
+}
+
+void testUnsortedAcrossChunks() {
+    std::vector<Record> records;
+    for (size_t i = 0; i < 100; i++) {
+        records.emplace_back(std::format("{:03}", i == 60 ? 0 : i));
+    }
+    writeRaw("temp/verified", records);
+    for (size_t threads : {1, 2, 7}) {
+        auto result = scanFixed("temp/verified", 10, threads, true);
+        CHECK(result.firstUnsorted == std::optional<size_t>(60));
+    }
+    std::filesystem::remove("temp/verified");
+}
+
+void testPagedFiles() {
+    auto records = randomRecords<30>(1003, 31);
+    records[500] = Record::empty;
+    for (auto format : {PageFormat::VARIABLE, PageFormat::PREFIX}) {
+        writeRecords<30>("temp/verified_in", records, 10, format);
+        auto sorted = records;
+        std::ranges::sort(sorted);
+        writeRecords<30>("temp/verified", sorted, 10, format);
+        for (size_t threads : {1, 4}) {
+            auto output = scanRecordFile(
+                "temp/verified", 30, 10, format, threads, true
+            );
+            auto input = scanRecordFile(
+                "temp/verified_in", 30, 10, format, threads, false
+            );
+            CHECK_EQ(output.recordCount, records.size());
+            CHECK_EQ(output.paddingCount, size_t(0));
+            CHECK(!output.firstUnsorted.has_value());
+            CHECK(output.hash == input.hash);
+            auto unsorted = scanRecordFile(
+                "temp/verified_in", 30, 10, format, threads, true
+            );
+            CHECK(unsorted.firstUnsorted.has_value());
+        }
+    }
+    std::filesystem::remove("temp/verified");
+    std::filesystem::remove("temp/verified_in");
+}
+
+}  // namespace
+
+int main() {
+    return runTests({
+        {"trailing_padding_is_skipped", testTrailingPaddingIsSkipped},
+        {"inner_empty_records_are_checked", testInnerEmptyRecordsAreChecked},
+        {"sorted_file_is_permutation", testSortedFileIsPermutation},
+        {"unsorted_across_chunks", testUnsortedAcrossChunks},
+        {"paged_files", testPagedFiles},
+    });
+}